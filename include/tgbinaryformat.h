@@ -0,0 +1,156 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGBINARYFORMAT_H
+#define TGBINARYFORMAT_H
+
+#include "tgglobal.h"
+#include <stdint.h>
+#include <cstring>
+#include <sstream>
+
+namespace tg{
+
+// Layout of the binary data file. The file starts with a FileHeader, followed by the track table,
+// the sequence table, one SegmentTrackEntry per sequence and track, the arrays of each segment
+// track and the string blob. Offsets are relative to the start of the file, string offsets are
+// relative to the string blob. All sections are 8 byte aligned and stored in the byte order of
+// the machine that wrote the file, so a mapped file is used as is.
+//
+// Each segment track stores its positions and lengths sorted in track order, a string reference
+// for each segment's data and the interval index over the segments.
+class BinaryFormat{
+
+public:
+    static const uint32_t VERSION         = 1;
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static const size_t   MAGIC_SIZE      = 8;
+
+    class StringRef{
+    public:
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    class FileHeader{
+    public:
+        char     magic[MAGIC_SIZE];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t fileSize;
+        uint64_t trackCount;
+        uint64_t sequenceCount;
+        uint64_t tracksOffset;
+        uint64_t sequencesOffset;
+        uint64_t segmentTracksOffset;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+
+    class TrackEntry{
+    public:
+        StringRef type;
+        StringRef name;
+    };
+
+    class SequenceEntry{
+    public:
+        StringRef path;
+        StringRef decoder;
+        int64_t   length;
+        uint32_t  type;
+        uint32_t  reserved;
+    };
+
+    class SegmentTrackEntry{
+    public:
+        uint64_t count;
+        uint64_t positionsOffset;
+        uint64_t lengthsOffset;
+        uint64_t dataOffset;
+        uint64_t indexOffset;
+        uint64_t indexLeaves;
+    };
+
+public:
+    static const char* magic();
+    static bool isBinary(const char* data, size_t size);
+
+    static const FileHeader& header(const char* data, size_t size);
+    template<typename T> static const T* section(const char* data, size_t size, uint64_t offset, uint64_t count);
+    static std::string string(const char* data, const FileHeader& header, const StringRef& ref);
+
+    static StringRef appendString(std::string& blob, const std::string& value);
+};
+
+inline const char* BinaryFormat::magic(){
+    return "TEGROUND";
+}
+
+inline bool BinaryFormat::isBinary(const char* data, size_t size){
+    return size >= sizeof(FileHeader) && std::memcmp(data, magic(), MAGIC_SIZE) == 0;
+}
+
+inline const BinaryFormat::FileHeader& BinaryFormat::header(const char* data, size_t size){
+    if ( !isBinary(data, size) )
+        throw Exception("Data is not in the binary data file format.");
+
+    const FileHeader& fileHeader = *reinterpret_cast<const FileHeader*>(data);
+    if ( fileHeader.byteOrder != BYTE_ORDER_MARK )
+        throw Exception("Binary data file was written with a different byte order.");
+    if ( fileHeader.version != VERSION ){
+        std::stringstream errorStream;
+        errorStream << "Unsupported binary data file version: " << fileHeader.version;
+        throw Exception(errorStream.str());
+    }
+    if ( fileHeader.fileSize != size )
+        throw Exception("Binary data file is truncated.");
+    if ( fileHeader.stringsOffset > size || fileHeader.stringsSize > size - fileHeader.stringsOffset )
+        throw Exception("Binary data file is corrupted: string blob out of bounds.");
+
+    return fileHeader;
+}
+
+template<typename T> inline const T* BinaryFormat::section(
+        const char* data,
+        size_t size,
+        uint64_t offset,
+        uint64_t count)
+{
+    if ( offset % 8 != 0 || offset > size || count > (size - offset) / sizeof(T) )
+        throw Exception("Binary data file is corrupted: section out of bounds.");
+    return reinterpret_cast<const T*>(data + offset);
+}
+
+inline std::string BinaryFormat::string(const char* data, const FileHeader& header, const StringRef& ref){
+    if ( ref.offset > header.stringsSize || ref.length > header.stringsSize - ref.offset )
+        throw Exception("Binary data file is corrupted: string out of bounds.");
+    return std::string(data + header.stringsOffset + ref.offset, static_cast<size_t>(ref.length));
+}
+
+inline BinaryFormat::StringRef BinaryFormat::appendString(std::string& blob, const std::string& value){
+    StringRef ref;
+    ref.offset = blob.size();
+    ref.length = value.size();
+    blob.append(value);
+    return ref;
+}
+
+} // namespace
+
+#endif // TGBINARYFORMAT_H
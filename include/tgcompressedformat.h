@@ -0,0 +1,150 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGCOMPRESSEDFORMAT_H
+#define TGCOMPRESSEDFORMAT_H
+
+#include "tgglobal.h"
+#include <stdint.h>
+#include <cstring>
+#include <sstream>
+
+namespace tg{
+
+// Layout of the compressed data file, meant for archiving and transfer. The file starts with the
+// magic, followed by varint encoded values: the version, the track table (type and name of each
+// track), the data dictionary, and the sequences (path, decoder, type, length, then the segments
+// of each track). Strings are a varint length followed by their bytes.
+//
+// Segments are stored in track order as the position delta from the previous segment, the length
+// and the index of their data in the dictionary, which holds each distinct data string once.
+// Signed values are zigzag encoded, so small negative values stay small.
+class CompressedFormat{
+
+public:
+    static const uint64_t VERSION    = 1;
+    static const size_t   MAGIC_SIZE = 8;
+
+    // Reads values in sequence, throwing if the data ends before a value does
+    class Reader{
+    public:
+        Reader(const char* data, size_t size);
+
+        uint64_t number();
+        int64_t signedNumber();
+        std::string string();
+        bool atEnd() const;
+
+    private:
+        const unsigned char* m_it;
+        const unsigned char* m_end;
+    };
+
+public:
+    static const char* magic();
+    static bool isCompressed(const char* data, size_t size);
+    static Reader reader(const char* data, size_t size);
+
+    static void appendNumber(std::string& out, uint64_t value);
+    static void appendSignedNumber(std::string& out, int64_t value);
+    static void appendString(std::string& out, const std::string& value);
+};
+
+inline const char* CompressedFormat::magic(){
+    return "TEGRNDZ\n";
+}
+
+inline bool CompressedFormat::isCompressed(const char *data, size_t size){
+    return size >= MAGIC_SIZE && std::memcmp(data, magic(), MAGIC_SIZE) == 0;
+}
+
+// Returns a reader positioned after the magic and the version
+inline CompressedFormat::Reader CompressedFormat::reader(const char *data, size_t size){
+    if ( !isCompressed(data, size) )
+        throw Exception("Data is not in the compressed data file format.");
+
+    Reader result(data + MAGIC_SIZE, size - MAGIC_SIZE);
+    uint64_t version = result.number();
+    if ( version != VERSION ){
+        std::stringstream errorStream;
+        errorStream << "Unsupported compressed data file version: " << version;
+        throw Exception(errorStream.str());
+    }
+    return result;
+}
+
+inline void CompressedFormat::appendNumber(std::string &out, uint64_t value){
+    while ( value >= 0x80 ){
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+inline void CompressedFormat::appendSignedNumber(std::string &out, int64_t value){
+    appendNumber(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+inline void CompressedFormat::appendString(std::string &out, const std::string &value){
+    appendNumber(out, value.size());
+    out.append(value);
+}
+
+// CompressedFormat::Reader
+// ------------------------
+
+inline CompressedFormat::Reader::Reader(const char *data, size_t size)
+    : m_it(reinterpret_cast<const unsigned char*>(data))
+    , m_end(reinterpret_cast<const unsigned char*>(data) + size)
+{
+}
+
+inline uint64_t CompressedFormat::Reader::number(){
+    uint64_t value = 0;
+    for ( unsigned int shift = 0; shift < 64; shift += 7 ){
+        if ( m_it == m_end )
+            throw Exception("Compressed data file is truncated.");
+        unsigned char byte = *m_it++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ( !(byte & 0x80) )
+            return value;
+    }
+    throw Exception("Compressed data file is corrupted: number too long.");
+}
+
+inline int64_t CompressedFormat::Reader::signedNumber(){
+    uint64_t value = number();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline std::string CompressedFormat::Reader::string(){
+    uint64_t length = number();
+    if ( length > static_cast<uint64_t>(m_end - m_it) )
+        throw Exception("Compressed data file is truncated.");
+    std::string result(reinterpret_cast<const char*>(m_it), static_cast<size_t>(length));
+    m_it += length;
+    return result;
+}
+
+inline bool CompressedFormat::Reader::atEnd() const{
+    return m_it == m_end;
+}
+
+} // namespace
+
+#endif // TGCOMPRESSEDFORMAT_H
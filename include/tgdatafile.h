@@ -24,15 +24,53 @@
 #include "tgtrackheader.h"
 #include "tgtrack.h"
 #include "tgsegmenttrack.h"
+#include "tgbinaryformat.h"
+#include "tgcompressedformat.h"
+#include "tgmappedfile.h"
+#include "tgyamlreader.h"
+#include "tgyamlwriter.h"
+#include "tgsequenceloader.h"
+#include "tgjournalformat.h"
 #include <vector>
+#include <map>
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
 
 #include <iostream>
 
 namespace tg{
 
-class DataFile{
+// Const access to a DataFile from several threads is safe once buildIndexes() was called and as
+// long as no thread modifies the file, its sequences or their tracks. Lazily loaded sequences can
+// be accessed from several threads as well, the first access to their tracks loads them.
+//
+// With an open journal, the edits made through the file and to the segments of its tracks are
+// appended to the journal of the data file, which readFrom() replays over the file's contents.
+//
+// A shard directory holds a manifest with the tracks and sequences, and the tracks of each
+// sequence in a shard file of its own. Shards are loaded on first access, and only the shards of
+// sequences edited since they were read or written are written again.
+class DataFile : private TrackListener{
 
 public:
+    enum Format{
+        FORMAT_AUTO,
+        FORMAT_YAML,
+        FORMAT_BINARY,
+        FORMAT_COMPRESSED,
+        FORMAT_SHARDED
+    };
+
+    enum LoadMode{
+        LOAD_ALL,
+        LOAD_STREAMING,
+        LOAD_LAZY,
+        LOAD_PARALLEL
+    };
+
     typedef std::vector<Sequence*>::iterator          SequenceIterator;
     typedef std::vector<Sequence*>::const_iterator    SequenceConstIterator;
 
@@ -43,12 +81,39 @@ public:
     DataFile();
     ~DataFile();
 
-    bool readFrom(const std::string& path);
-    bool writeTo(const std::string& path);
+    bool readFrom(const std::string& path, Format format = FORMAT_AUTO, LoadMode mode = LOAD_ALL);
+    bool writeTo(const std::string& path, Format format = FORMAT_AUTO);
 
     void read(const cv::FileNode& node);
     void write(cv::FileStorage& fs) const;
 
+    void readYaml(std::istream& in);
+    void writeYaml(std::ostream& out) const;
+
+    void readBinary(const char* data, size_t size);
+    void writeBinary(std::ostream& out) const;
+
+    void readCompressed(const char* data, size_t size);
+    void writeCompressed(std::ostream& out) const;
+
+    static const char* binaryExtension();
+    static const char* compressedExtension();
+    static const char* manifestName();
+
+    const std::string& shardDirectory() const;
+    void markShardDirty(const Sequence* seq);
+
+    bool openJournal(const std::string& path);
+    void closeJournal();
+    bool isJournalOpen() const;
+    bool compactJournal();
+
+    const std::string& cacheDirectory() const;
+    void setCacheDirectory(const std::string& path);
+    std::string cachePath(const std::string& path) const;
+
+    void buildIndexes() const;
+
     // Track Handlers
     // --------------
 
@@ -85,6 +150,47 @@ public:
     SequenceConstIterator sequencesEnd() const;
 
 private:
+    void readYaml(std::istream& in, YamlSequenceLoader* loader, ShardSequenceLoader* shards = 0);
+    void readYamlTracks(YamlReader& reader);
+    void readYamlSequence(YamlReader& reader, YamlSequenceLoader* loader, ShardSequenceLoader* shards);
+
+    void writeYaml(std::ostream& out, const std::vector<std::string>* shards) const;
+    void writeYamlTracks(YamlWriter& writer, const Sequence* seq) const;
+
+    void readBinary(const char* data, size_t size, BinarySequenceLoader* loader);
+
+    void loadSequences();
+
+    bool readYamlFile(const std::string& path, LoadMode mode);
+    bool readBinaryFile(const std::string& path, LoadMode mode);
+    bool readCached(const std::string& path, LoadMode mode);
+
+    bool readShards(const std::string& directory, LoadMode mode);
+    bool writeShards(const std::string& directory);
+    void closeShards();
+    void setShardsDirty();
+    static bool isShardDirectory(const std::string& path);
+    static bool replaceFile(const std::string& from, const std::string& to);
+
+    void updateListeners();
+
+    static Format formatFromPath(const std::string& path);
+
+    void replayJournal(const std::string& path, const std::string& dataPath);
+    void replayRecord(const std::vector<std::string>& fields);
+    SegmentTrack* journalTrack(const std::vector<std::string>& fields, size_t count);
+    size_t journalSequence(const std::string& field) const;
+
+    size_t trackSequenceIndex(const Track* track) const;
+    void writeJournal(const std::string& record);
+    bool truncateJournal();
+
+    void segmentInserted(const Track* track, size_t index, const Segment* segment);
+    void segmentRemoved(const Track* track, size_t index);
+    void segmentCoordsAssigned(const Track* track, size_t index, VideoTime position, VideoTime length);
+    void segmentDataAssigned(const Track* track, size_t index, const std::string& data);
+    void segmentsCleared(const Track* track);
+
     // prevent copy
     DataFile(const DataFile&);
     DataFile& operator =(const DataFile&);
@@ -92,44 +198,188 @@ private:
     // fields
     std::vector<Sequence*>    m_sequences;
     std::vector<TrackHeader*> m_tracks;
+    SequenceLoader*           m_loader;
+    std::string               m_journalPath;
+    std::ofstream             m_journal;
+    std::string               m_cacheDirectory;
+
+    class Shard{
+    public:
+        Shard() : isDirty(false){}
+
+        std::string name;
+        bool        isDirty;
+    };
+
+    std::string                      m_shardDirectory;
+    std::map<const Sequence*, Shard> m_shards;
+    std::vector<std::string>         m_staleShards;
+
+    // sequence index of the tracks seen by the listener, checked on each lookup
+    mutable std::map<const Track*, size_t> m_trackSequences;
+
+    class SequenceLoading : public cv::ParallelLoopBody{
+    public:
+        SequenceLoading(const std::vector<Sequence*>& sequences, std::vector<std::string>& errors)
+            : m_sequences(sequences)
+            , m_errors(errors)
+        {}
+
+        void operator()(const cv::Range& range) const;
+
+    private:
+        const std::vector<Sequence*>& m_sequences;
+        std::vector<std::string>&     m_errors;
+    };
 };
 
-inline DataFile::DataFile(){
+inline DataFile::DataFile()
+    : m_loader(0)
+{
     TrackHeader::registerType<SegmentTrack>("Segment");
 }
 
 inline DataFile::~DataFile(){
+    closeJournal();
+    closeShards();
     clearSequences();
     clearTracks();
 }
 
-inline bool DataFile::readFrom(const std::string& path){
-    try{
-        cv::FileStorage fs(path, cv::FileStorage::READ | cv::FileStorage::FORMAT_YAML);
-        if ( !fs.isOpened() )
+// Reads the file in the given format. With FORMAT_AUTO the binary and compressed formats are
+// detected from the file's contents, otherwise the file is read as yaml.
+//
+// LOAD_ALL reads yaml files through cv::FileStorage. LOAD_STREAMING reads them with the streaming
+// reader instead, without keeping the document in memory, see readYamlFile(). Other formats are
+// read the same with both modes.
+//
+// With LOAD_LAZY only the track headers and the sequence properties are read, and the file is kept
+// open to load the tracks of each sequence on first access. Errors in a sequence's tracks are
+// thrown on that access. Compressed files are always read completely.
+//
+// LOAD_PARALLEL reads the same tables, then loads the tracks of all sequences on worker threads.
+//
+// With a cache directory, yaml files are read from their binary snapshot in the cache, see
+// cacheDirectory().
+//
+// With FORMAT_SHARDED, or FORMAT_AUTO and a directory holding a manifest, the path is read as a
+// shard directory, where LOAD_LAZY loads each shard on first access.
+//
+// If the file has a journal, its records are replayed once the file is read, loading the tracks
+// of the sequences they edit.
+inline bool DataFile::readFrom(const std::string& path, Format format, LoadMode mode){
+    if ( format == FORMAT_SHARDED || (format == FORMAT_AUTO && isShardDirectory(path)) ){
+        if ( !readShards(path, mode) )
             return false;
-        read(fs["TeGround"]);
-        fs.release();
-    } catch ( cv::Exception& e ){
-        throw tg::Exception(e.what());
+        replayJournal(path + JournalFormat::extension(), path);
+        return true;
+    }
+
+    if ( format != FORMAT_YAML ){
+        if ( format != FORMAT_COMPRESSED && readBinaryFile(path, mode) ){
+            replayJournal(path + JournalFormat::extension(), path);
+            return true;
+        }
+
+        MappedFile file;
+        if ( !file.open(path) )
+            return false;
+        if ( format != FORMAT_BINARY && CompressedFormat::isCompressed(file.data(), file.size()) ){
+            readCompressed(file.data(), file.size());
+            replayJournal(path + JournalFormat::extension(), path);
+            return true;
+        }
+        if ( format == FORMAT_BINARY )
+            throw Exception("File is not a binary data file: " + path);
+        if ( format == FORMAT_COMPRESSED )
+            throw Exception("File is not a compressed data file: " + path);
+    }
+
+    if ( !m_cacheDirectory.empty() ){
+        if ( !readCached(path, mode) )
+            return false;
+        replayJournal(path + JournalFormat::extension(), path);
+        return true;
     }
 
+    if ( !readYamlFile(path, mode) )
+        return false;
+
+    replayJournal(path + JournalFormat::extension(), path);
     return true;
 }
 
-inline bool DataFile::writeTo(const std::string& path){
-    cv::FileStorage fs(path, cv::FileStorage::WRITE | cv::FileStorage::FORMAT_YAML);
-    if ( !fs.isOpened() )
+// Writes the file in the given format. With FORMAT_AUTO, paths ending in binaryExtension() are
+// written in the binary format, paths ending in compressedExtension() in the compressed format,
+// shard directories as shards, and any other path is written as yaml.
+//
+// With FORMAT_SHARDED the path is an existing directory.
+//
+// Writing over the file the journal is open for saves the journaled edits in the file, so the
+// journal is emptied as by compactJournal(). The shards of a directory are not replaced at once,
+// so its journal is emptied after they were written.
+inline bool DataFile::writeTo(const std::string& path, Format format){
+    bool savesJournal = isJournalOpen() && path == m_journalPath;
+    if ( format == FORMAT_AUTO )
+        format = isShardDirectory(path) ? FORMAT_SHARDED : formatFromPath(path);
+    if ( format == FORMAT_SHARDED )
+        return writeShards(path) && (!savesJournal || truncateJournal());
+
+    // sequences that are not loaded yet may be read from the path while writing, so the file is
+    // replaced only once it was written completely
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if ( !out.is_open() )
+            return false;
+        try{
+            if ( format == FORMAT_BINARY )
+                writeBinary(out);
+            else if ( format == FORMAT_COMPRESSED )
+                writeCompressed(out);
+            else
+                writeYaml(out);
+        } catch ( ... ){
+            out.close();
+            std::remove(tempPath.c_str());
+            throw;
+        }
+        out.close();
+        if ( out.fail() ){
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    // writing loaded every sequence, and the loader may keep the data file open
+    delete m_loader;
+    m_loader = 0;
+
+    // the journal records the hash of the new file first, so if the file is replaced but the
+    // journal is not emptied, its records are skipped when replaying
+    if ( savesJournal ){
+        MappedFile written;
+        if ( !written.open(tempPath) ){
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        std::stringstream record;
+        record << static_cast<char>(JournalFormat::COMPACTED) << ' '
+               << JournalFormat::hash(written.data(), written.size());
+        writeJournal(record.str());
+    }
+
+    if ( !replaceFile(tempPath, path) )
         return false;
-    write(fs);
-    fs.release();
-    return true;
+    return !savesJournal || truncateJournal();
 }
 
 inline void DataFile::read(const cv::FileNode &node){
 
     // Clear State
 
+    closeJournal();
+    closeShards();
     clearSequences();
     clearTracks();
 
@@ -188,6 +438,161 @@ inline void DataFile::read(const cv::FileNode &node){
     }
 }
 
+// Reads the yaml layout written by write() while parsing, without loading the document in memory.
+// Tracks need to be placed before Sequences, and the header of each sequence track before its
+// segments, as write() places them.
+inline void DataFile::readYaml(std::istream& in){
+    readYaml(in, 0);
+}
+
+// Given a loader, the tracks of each sequence are skipped and loaded from the loader's file on
+// first access. The file takes ownership of the loader.
+inline void DataFile::readYaml(std::istream &in, YamlSequenceLoader *loader, ShardSequenceLoader *shards){
+
+    // Clear State
+
+    closeJournal();
+    closeShards();
+    clearSequences();
+    clearTracks();
+    m_loader = shards ? static_cast<SequenceLoader*>(shards) : loader;
+
+    YamlReader reader(in);
+    if ( reader.next() != YamlReader::MAPPING_START )
+        reader.error("\'TeGround\' not found.");
+
+    bool hasRoot = false;
+    while ( reader.next() == YamlReader::SCALAR ){
+        if ( reader.value() != "TeGround" || hasRoot ){
+            reader.skip(reader.next());
+            continue;
+        }
+        hasRoot = true;
+
+        if ( reader.next() != YamlReader::MAPPING_START )
+            reader.error("\'TeGround\' is not a mapping.");
+
+        bool hasTracks    = false;
+        bool hasSequences = false;
+        while ( reader.next() == YamlReader::SCALAR ){
+            if ( reader.value() == "Tracks" ){
+                readYamlTracks(reader);
+                hasTracks = true;
+            } else if ( reader.value() == "Sequences" ){
+                if ( !hasTracks )
+                    reader.error("\'Tracks\' need to be placed before \'Sequences\'.");
+                if ( reader.next() != YamlReader::SEQUENCE_START )
+                    reader.error("\'Sequences\' is not an iterable type.");
+                while ( reader.next() == YamlReader::MAPPING_START )
+                    readYamlSequence(reader, loader, shards);
+                hasSequences = true;
+            } else {
+                reader.skip(reader.next());
+            }
+        }
+
+        if ( !hasTracks )
+            reader.error("\'Tracks\' is not an iterable type.");
+        if ( !hasSequences )
+            reader.error("\'Sequences\' is not an iterable type.");
+    }
+
+    if ( !hasRoot )
+        reader.error("\'TeGround\' not found.");
+}
+
+inline void DataFile::readYamlTracks(YamlReader& reader){
+    if ( reader.next() != YamlReader::SEQUENCE_START )
+        reader.error("\'Tracks\' is not an iterable type.");
+
+    YamlReader::Event event;
+    while ( (event = reader.next()) == YamlReader::MAPPING_START ){
+        std::string trackName = "";
+        std::string trackType = "";
+        while ( reader.next() == YamlReader::SCALAR ){
+            if ( reader.value() == "Name" )
+                trackName = reader.readScalar("Track.Name");
+            else if ( reader.value() == "Type" )
+                trackType = reader.readScalar("Track.Type");
+            else
+                reader.skip(reader.next());
+        }
+
+        if ( !TrackHeader::hasType(trackType) )
+            throw Exception("Type does not exist when parsing file: " + trackType);
+        if ( trackType != "Segment" )
+            throw Exception("Type is not supported by the yaml reader: " + trackType);
+
+        TrackHeader* theader = new TrackHeader(trackType);
+        theader->setName(trackName);
+        m_tracks.push_back(theader);
+    }
+    if ( event != YamlReader::SEQUENCE_END )
+        reader.error("\'Tracks\' contains a value that is not a track.");
+}
+
+// In a shard manifest, sequences give their shard instead of their tracks
+inline void DataFile::readYamlSequence(YamlReader& reader, YamlSequenceLoader* loader, ShardSequenceLoader* shards){
+    std::string path    = "";
+    std::string decoder = "";
+    std::string type    = "";
+    VideoTime   length  = 0;
+
+    Sequence* seq = 0;
+    while ( reader.next() == YamlReader::SCALAR ){
+        std::string key = reader.value();
+        if ( shards && key == "Shard" ){
+            if ( seq )
+                reader.error("\'Sequence.Shard\' is given twice.");
+
+            std::string shard = reader.readScalar("Sequence.Shard");
+            seq = new Sequence(path, decoder, Sequence::typeFromString(type), length);
+            m_sequences.push_back(seq);
+            seq->setLoader(shards, shards->addSequence(shard));
+            m_shards[seq].name = shard;
+
+        } else if ( !shards && key == "Tracks" ){
+            if ( seq )
+                reader.error("\'Sequence.Tracks\' is given twice.");
+
+            // the loader resumes from the line of the key
+            std::streamoff tracksOffset = reader.lineOffset();
+            size_t tracksLine           = reader.lineNumber();
+            if ( reader.next() != YamlReader::SEQUENCE_START )
+                reader.error("\'Sequence.Tracks\' is not an iterable type.");
+
+            seq = new Sequence(path, decoder, Sequence::typeFromString(type), length);
+            m_sequences.push_back(seq);
+
+            if ( loader ){
+                seq->setLoader(loader, loader->addSequence(tracksOffset, tracksLine));
+                reader.skip(YamlReader::SEQUENCE_START);
+            } else {
+                YamlSequenceLoader::readTracks(reader, seq, m_tracks);
+            }
+
+        } else if ( key == "Path" || key == "Decoder" || key == "Type" || key == "Length" ){
+            if ( seq )
+                reader.error("\'Sequence." + key + "\' needs to be placed before the sequence's tracks.");
+            if ( key == "Path" )
+                path = reader.readScalar("Sequence.Path");
+            else if ( key == "Decoder" )
+                decoder = reader.readScalar("Sequence.Decoder");
+            else if ( key == "Type" )
+                type = reader.readScalar("Sequence.Type");
+            else
+                length = static_cast<VideoTime>(reader.readNumber("Sequence.Length"));
+        } else {
+            reader.skip(reader.next());
+        }
+    }
+
+    if ( !seq && shards )
+        reader.error("\'Sequence.Shard\' not found.");
+    if ( !seq )
+        reader.error("\'Sequence.Tracks\' is not an iterable type.");
+}
+
 inline void DataFile::write(cv::FileStorage &fs) const{
     fs << "TeGround" << "{";
 
@@ -224,6 +629,982 @@ inline void DataFile::write(cv::FileStorage &fs) const{
     fs << "}";
 }
 
+// Writes the layout of write() as the data is traversed, with integer numbers. Nothing besides
+// the stream's buffer is held in memory.
+inline void DataFile::writeYaml(std::ostream &out) const{
+    writeYaml(out, 0);
+}
+
+// Given the shard of each sequence, writes a shard manifest
+inline void DataFile::writeYaml(std::ostream &out, const std::vector<std::string>* shards) const{
+    YamlWriter writer(out);
+    writer.startMapping("TeGround");
+
+    writer.startSequence("Tracks");
+    for ( TrackHeaderConstIterator it = tracksBegin(); it != tracksEnd(); ++it )
+        (*it)->write(writer);
+    writer.endSequence();
+
+    writer.startSequence("Sequences");
+    for ( SequenceConstIterator it = sequencesBegin(); it != sequencesEnd(); ++it ){
+        const Sequence* seq = *it;
+
+        writer.startMapping();
+        writer.write("Path", seq->path());
+        writer.write("Type", Sequence::typeToString(seq->type()));
+        writer.write("Length", seq->length());
+        writer.write("Decoder", seq->decoder());
+        if ( shards )
+            writer.write("Shard", (*shards)[it - sequencesBegin()]);
+        else
+            writeYamlTracks(writer, seq);
+
+        writer.endMapping();
+    }
+    writer.endSequence();
+
+    writer.endMapping();
+}
+
+inline void DataFile::writeYamlTracks(YamlWriter &writer, const Sequence *seq) const{
+    writer.startSequence("Tracks");
+    for ( Sequence::TrackConstIterator trackIt = seq->tracksBegin(); trackIt != seq->tracksEnd(); ++trackIt ){
+        size_t index = trackIndex((*trackIt)->header());
+        if ( index == m_tracks.size() )
+            throw Exception("Failed to find index for track: " + (*trackIt)->header()->name());
+        (*trackIt)->write(writer, index);
+    }
+    writer.endSequence();
+}
+
+inline void DataFile::readBinary(const char* data, size_t size){
+    readBinary(data, size, 0);
+}
+
+// Given a loader, the segment tracks are created on first access. The loader needs to hold the data,
+// and the file takes ownership of it.
+inline void DataFile::readBinary(const char *data, size_t size, BinarySequenceLoader *loader){
+    const BinaryFormat::FileHeader& header = BinaryFormat::header(data, size);
+
+    const BinaryFormat::TrackEntry* trackEntries =
+        BinaryFormat::section<BinaryFormat::TrackEntry>(data, size, header.tracksOffset, header.trackCount);
+    const BinaryFormat::SequenceEntry* sequenceEntries =
+        BinaryFormat::section<BinaryFormat::SequenceEntry>(data, size, header.sequencesOffset, header.sequenceCount);
+    if ( header.trackCount > 0 && header.sequenceCount > (uint64_t)(-1) / header.trackCount )
+        throw Exception("Binary data file is corrupted: too many segment tracks.");
+    const BinaryFormat::SegmentTrackEntry* segmentTrackEntries =
+        BinaryFormat::section<BinaryFormat::SegmentTrackEntry>(
+            data, size, header.segmentTracksOffset, header.sequenceCount * header.trackCount
+        );
+
+    // Clear State
+
+    closeJournal();
+    closeShards();
+    clearSequences();
+    clearTracks();
+    m_loader = loader;
+
+    // Tracks
+
+    for ( uint64_t i = 0; i < header.trackCount; ++i ){
+        std::string trackType = BinaryFormat::string(data, header, trackEntries[i].type);
+        if ( trackType != "Segment" )
+            throw Exception("Type is not supported by the binary format: " + trackType);
+        appendTrack(trackType, BinaryFormat::string(data, header, trackEntries[i].name));
+    }
+
+    // Sequences
+
+    for ( uint64_t i = 0; i < header.sequenceCount; ++i ){
+        const BinaryFormat::SequenceEntry& sequenceEntry = sequenceEntries[i];
+
+        Sequence* seq = new Sequence(
+            BinaryFormat::string(data, header, sequenceEntry.path),
+            BinaryFormat::string(data, header, sequenceEntry.decoder),
+            sequenceEntry.type == Sequence::Image ? Sequence::Image : Sequence::Video,
+            sequenceEntry.length
+        );
+        m_sequences.push_back(seq);
+
+        if ( loader )
+            seq->setLoader(loader, static_cast<size_t>(i));
+        else
+            BinarySequenceLoader::readTracks(data, size, seq, static_cast<size_t>(i), m_tracks);
+    }
+}
+
+inline void DataFile::writeBinary(std::ostream& out) const{
+    BinaryFormat::FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BinaryFormat::magic(), BinaryFormat::MAGIC_SIZE);
+    header.version       = BinaryFormat::VERSION;
+    header.byteOrder     = BinaryFormat::BYTE_ORDER_MARK;
+    header.trackCount    = m_tracks.size();
+    header.sequenceCount = m_sequences.size();
+
+    // Layout tables
+
+    uint64_t offset = sizeof(BinaryFormat::FileHeader);
+    header.tracksOffset = offset;
+    offset += header.trackCount * sizeof(BinaryFormat::TrackEntry);
+    header.sequencesOffset = offset;
+    offset += header.sequenceCount * sizeof(BinaryFormat::SequenceEntry);
+    header.segmentTracksOffset = offset;
+    offset += header.sequenceCount * header.trackCount * sizeof(BinaryFormat::SegmentTrackEntry);
+
+    std::string strings;
+
+    std::vector<BinaryFormat::TrackEntry> trackEntries(m_tracks.size());
+    for ( size_t i = 0; i < m_tracks.size(); ++i ){
+        if ( m_tracks[i]->type() != "Segment" )
+            throw Exception("Type is not supported by the binary format: " + m_tracks[i]->type());
+        trackEntries[i].type = BinaryFormat::appendString(strings, m_tracks[i]->type());
+        trackEntries[i].name = BinaryFormat::appendString(strings, m_tracks[i]->name());
+    }
+
+    std::vector<BinaryFormat::SequenceEntry> sequenceEntries(m_sequences.size());
+    std::vector<BinaryFormat::SegmentTrackEntry> segmentTrackEntries(m_sequences.size() * m_tracks.size());
+    for ( size_t i = 0; i < m_sequences.size(); ++i ){
+        const Sequence* seq = m_sequences[i];
+
+        BinaryFormat::SequenceEntry& sequenceEntry = sequenceEntries[i];
+        sequenceEntry.path     = BinaryFormat::appendString(strings, seq->path());
+        sequenceEntry.decoder  = BinaryFormat::appendString(strings, seq->decoder());
+        sequenceEntry.length   = seq->length();
+        sequenceEntry.type     = seq->type();
+        sequenceEntry.reserved = 0;
+
+        // Layout segment arrays
+
+        for ( size_t t = 0; t < m_tracks.size(); ++t ){
+            const SegmentTrack* track = static_cast<const SegmentTrack*>(seq->track(m_tracks[t]));
+            if ( !track )
+                throw Exception("Sequence \'" + seq->path() + "\' has no track: " + m_tracks[t]->name());
+            BinaryFormat::SegmentTrackEntry& trackEntry = segmentTrackEntries[i * m_tracks.size() + t];
+
+            size_t leaves = 1;
+            while ( leaves < track->totalSegments() )
+                leaves <<= 1;
+
+            trackEntry.count           = track->totalSegments();
+            trackEntry.positionsOffset = offset;
+            offset += trackEntry.count * sizeof(VideoTime);
+            trackEntry.lengthsOffset   = offset;
+            offset += trackEntry.count * sizeof(VideoTime);
+            trackEntry.dataOffset      = offset;
+            offset += trackEntry.count * sizeof(BinaryFormat::StringRef);
+            trackEntry.indexOffset     = offset;
+            trackEntry.indexLeaves     = leaves;
+            offset += 2 * leaves * sizeof(VideoTime);
+        }
+    }
+
+    // Segment data goes at the end of the string blob
+
+    std::vector<BinaryFormat::StringRef> segmentData;
+    for ( size_t i = 0; i < m_sequences.size(); ++i ){
+        for ( size_t t = 0; t < m_tracks.size(); ++t ){
+            const SegmentTrack* track = static_cast<const SegmentTrack*>(m_sequences[i]->track(m_tracks[t]));
+            for ( SegmentTrack::SegmentConstIterator it = track->begin(); it != track->end(); ++it )
+                segmentData.push_back(BinaryFormat::appendString(strings, (*it)->data()));
+        }
+    }
+
+    header.stringsOffset = offset;
+    header.stringsSize   = strings.size();
+    header.fileSize      = offset + strings.size();
+
+    // Write
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if ( !trackEntries.empty() )
+        out.write(reinterpret_cast<const char*>(&trackEntries[0]), trackEntries.size() * sizeof(BinaryFormat::TrackEntry));
+    if ( !sequenceEntries.empty() )
+        out.write(
+            reinterpret_cast<const char*>(&sequenceEntries[0]),
+            sequenceEntries.size() * sizeof(BinaryFormat::SequenceEntry)
+        );
+    if ( !segmentTrackEntries.empty() )
+        out.write(
+            reinterpret_cast<const char*>(&segmentTrackEntries[0]),
+            segmentTrackEntries.size() * sizeof(BinaryFormat::SegmentTrackEntry)
+        );
+
+    std::vector<VideoTime> values;
+    std::vector<BinaryFormat::StringRef>::const_iterator dataIt = segmentData.begin();
+    for ( size_t i = 0; i < m_sequences.size(); ++i ){
+        for ( size_t t = 0; t < m_tracks.size(); ++t ){
+            const SegmentTrack* track = static_cast<const SegmentTrack*>(m_sequences[i]->track(m_tracks[t]));
+            size_t count = track->totalSegments();
+
+            values.resize(count);
+            for ( size_t s = 0; s < count; ++s )
+                values[s] = track->segmentPosition(s);
+            if ( count > 0 )
+                out.write(reinterpret_cast<const char*>(&values[0]), count * sizeof(VideoTime));
+
+            for ( size_t s = 0; s < count; ++s )
+                values[s] = track->segmentLength(s);
+            if ( count > 0 ){
+                out.write(reinterpret_cast<const char*>(&values[0]), count * sizeof(VideoTime));
+                out.write(reinterpret_cast<const char*>(&*dataIt), count * sizeof(BinaryFormat::StringRef));
+                dataIt += count;
+            }
+
+            IntervalIndex index;
+            index.resize(count);
+            for ( size_t s = 0; s < count; ++s )
+                index.setInterval(s, track->segmentPosition(s), track->segmentLength(s));
+            index.update();
+            out.write(reinterpret_cast<const char*>(&index.maxEnds()[0]), index.maxEnds().size() * sizeof(VideoTime));
+        }
+    }
+
+    out.write(strings.data(), strings.size());
+}
+
+// Decodes each segment track in a single pass, appending its segments in track order
+inline void DataFile::readCompressed(const char *data, size_t size){
+    CompressedFormat::Reader reader = CompressedFormat::reader(data, size);
+
+    // Clear State
+
+    closeJournal();
+    closeShards();
+    clearSequences();
+    clearTracks();
+
+    // Tracks
+
+    uint64_t trackCount = reader.number();
+    for ( uint64_t i = 0; i < trackCount; ++i ){
+        std::string trackType = reader.string();
+        if ( trackType != "Segment" )
+            throw Exception("Type is not supported by the compressed format: " + trackType);
+        appendTrack(trackType, reader.string());
+    }
+
+    // Data dictionary
+
+    uint64_t dictionarySize = reader.number();
+    if ( dictionarySize > size )
+        throw Exception("Compressed data file is corrupted: dictionary too large.");
+    std::vector<std::string> dictionary(static_cast<size_t>(dictionarySize));
+    for ( size_t i = 0; i < dictionary.size(); ++i )
+        dictionary[i] = reader.string();
+
+    // Sequences
+
+    uint64_t sequenceCount = reader.number();
+    for ( uint64_t i = 0; i < sequenceCount; ++i ){
+        std::string path    = reader.string();
+        std::string decoder = reader.string();
+        uint64_t type       = reader.number();
+        VideoTime length    = reader.signedNumber();
+
+        Sequence* seq = new Sequence(path, decoder, type == Sequence::Image ? Sequence::Image : Sequence::Video, length);
+        m_sequences.push_back(seq);
+
+        for ( size_t t = 0; t < m_tracks.size(); ++t ){
+            SegmentTrack* track = static_cast<SegmentTrack*>(seq->appendTrack(m_tracks[t]));
+
+            uint64_t count = reader.number();
+            if ( count > size )
+                throw Exception("Compressed data file is corrupted: too many segments.");
+            track->reserveSegments(static_cast<size_t>(count));
+
+            VideoTime position = 0;
+            for ( uint64_t s = 0; s < count; ++s ){
+                position += reader.signedNumber();
+                VideoTime segmentLength = reader.signedNumber();
+                uint64_t dataIndex      = reader.number();
+                if ( dataIndex >= dictionary.size() )
+                    throw Exception("Compressed data file is corrupted: data index out of bounds.");
+                track->loadSegment(position, segmentLength, dictionary[static_cast<size_t>(dataIndex)]);
+            }
+        }
+    }
+
+    if ( !reader.atEnd() )
+        throw Exception("Compressed data file is corrupted: data after the last sequence.");
+}
+
+// Writes the tables and the dictionary, then the segments of one track at a time
+inline void DataFile::writeCompressed(std::ostream &out) const{
+    std::string buffer(CompressedFormat::magic(), CompressedFormat::MAGIC_SIZE);
+    CompressedFormat::appendNumber(buffer, CompressedFormat::VERSION);
+
+    CompressedFormat::appendNumber(buffer, m_tracks.size());
+    for ( TrackHeaderConstIterator it = tracksBegin(); it != tracksEnd(); ++it ){
+        if ( (*it)->type() != "Segment" )
+            throw Exception("Type is not supported by the compressed format: " + (*it)->type());
+        CompressedFormat::appendString(buffer, (*it)->type());
+        CompressedFormat::appendString(buffer, (*it)->name());
+    }
+
+    // Data dictionary, in order of first use
+
+    std::map<std::string, uint64_t> dictionary;
+    std::vector<const std::string*> dictionaryEntries;
+    for ( SequenceConstIterator it = sequencesBegin(); it != sequencesEnd(); ++it ){
+        for ( size_t t = 0; t < m_tracks.size(); ++t ){
+            const SegmentTrack* track = static_cast<const SegmentTrack*>((*it)->track(m_tracks[t]));
+            if ( !track )
+                throw Exception("Sequence \'" + (*it)->path() + "\' has no track: " + m_tracks[t]->name());
+            for ( SegmentTrack::SegmentConstIterator segmIt = track->begin(); segmIt != track->end(); ++segmIt ){
+                std::pair<std::map<std::string, uint64_t>::iterator, bool> inserted =
+                    dictionary.insert(std::make_pair((*segmIt)->data(), dictionaryEntries.size()));
+                if ( inserted.second )
+                    dictionaryEntries.push_back(&inserted.first->first);
+            }
+        }
+    }
+
+    CompressedFormat::appendNumber(buffer, dictionaryEntries.size());
+    for ( size_t i = 0; i < dictionaryEntries.size(); ++i )
+        CompressedFormat::appendString(buffer, *dictionaryEntries[i]);
+
+    // Sequences
+
+    CompressedFormat::appendNumber(buffer, m_sequences.size());
+    for ( SequenceConstIterator it = sequencesBegin(); it != sequencesEnd(); ++it ){
+        const Sequence* seq = *it;
+        CompressedFormat::appendString(buffer, seq->path());
+        CompressedFormat::appendString(buffer, seq->decoder());
+        CompressedFormat::appendNumber(buffer, seq->type());
+        CompressedFormat::appendSignedNumber(buffer, seq->length());
+
+        for ( size_t t = 0; t < m_tracks.size(); ++t ){
+            const SegmentTrack* track = static_cast<const SegmentTrack*>(seq->track(m_tracks[t]));
+            CompressedFormat::appendNumber(buffer, track->totalSegments());
+
+            VideoTime position = 0;
+            for ( SegmentTrack::SegmentConstIterator segmIt = track->begin(); segmIt != track->end(); ++segmIt ){
+                CompressedFormat::appendSignedNumber(buffer, (*segmIt)->position() - position);
+                CompressedFormat::appendSignedNumber(buffer, (*segmIt)->length());
+                CompressedFormat::appendNumber(buffer, dictionary.find((*segmIt)->data())->second);
+                position = (*segmIt)->position();
+            }
+
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+
+    out.write(buffer.data(), buffer.size());
+}
+
+inline const char* DataFile::binaryExtension(){
+    return ".tgb";
+}
+
+inline const char* DataFile::compressedExtension(){
+    return ".tgc";
+}
+
+inline const char* DataFile::manifestName(){
+    return "manifest.yml";
+}
+
+// Returns the shard directory the file was last read from or written to
+inline const std::string &DataFile::shardDirectory() const{
+    return m_shardDirectory;
+}
+
+// Marks the shard of the sequence for writing, for edits the file is not notified of, such as
+// Segment::setData() instead of SegmentTrack::assignSegmentData()
+inline void DataFile::markShardDirty(const Sequence *seq){
+    std::map<const Sequence*, Shard>::iterator it = m_shards.find(seq);
+    if ( it != m_shards.end() )
+        it->second.isDirty = true;
+}
+
+inline bool DataFile::readShards(const std::string &directory, LoadMode mode){
+    std::ifstream in((directory + "/" + manifestName()).c_str(), std::ios::in | std::ios::binary);
+    if ( !in.is_open() )
+        return false;
+
+    readYaml(in, 0, new ShardSequenceLoader(m_tracks, directory));
+    m_shardDirectory = directory;
+    updateListeners();
+
+    if ( mode == LOAD_PARALLEL ){
+        loadSequences();
+    } else if ( mode == LOAD_ALL || mode == LOAD_STREAMING ){
+        for ( SequenceIterator it = sequencesBegin(); it != sequencesEnd(); ++it )
+            (*it)->totalTracks();
+        delete m_loader;
+        m_loader = 0;
+    }
+    return true;
+}
+
+// Writes the shards that changed, then the manifest. Each file is replaced once it was written
+// completely, and shards of removed sequences are deleted last, so the manifest only refers to
+// complete shards. New shards are named after the hash of their sequence's path.
+inline bool DataFile::writeShards(const std::string &directory){
+    bool isSameDirectory = directory == m_shardDirectory;
+
+    std::set<std::string> names;
+    for ( std::map<const Sequence*, Shard>::const_iterator it = m_shards.begin(); it != m_shards.end(); ++it )
+        names.insert(it->second.name);
+
+    std::vector<std::string> shards(m_sequences.size());
+    for ( size_t i = 0; i < m_sequences.size(); ++i ){
+        const Sequence* seq = m_sequences[i];
+
+        std::map<const Sequence*, Shard>::const_iterator shardIt = m_shards.find(seq);
+        if ( shardIt != m_shards.end() ){
+            shards[i] = shardIt->second.name;
+            if ( isSameDirectory && !shardIt->second.isDirty )
+                continue;
+        } else {
+            std::stringstream name;
+            name << std::hex << std::setw(16) << std::setfill('0')
+                 << JournalFormat::hash(seq->path().data(), seq->path().size()) << std::dec;
+            std::string base = name.str();
+            for ( int suffix = 1; names.count(name.str() + ".yml") > 0; ++suffix ){
+                name.str("");
+                name << base << '-' << suffix;
+            }
+            shards[i] = name.str() + ".yml";
+            names.insert(shards[i]);
+        }
+
+        std::string path = directory + "/" + shards[i];
+        std::ofstream out((path + ".tmp").c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if ( !out.is_open() )
+            return false;
+        {
+            YamlWriter writer(out);
+            writer.write("Path", seq->path());
+            writeYamlTracks(writer, seq);
+        }
+        out.close();
+        if ( out.fail() || !replaceFile(path + ".tmp", path) )
+            return false;
+    }
+
+    std::string manifestPath = directory + "/" + manifestName();
+    std::ofstream out((manifestPath + ".tmp").c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if ( !out.is_open() )
+        return false;
+    writeYaml(out, &shards);
+    out.close();
+    if ( out.fail() || !replaceFile(manifestPath + ".tmp", manifestPath) )
+        return false;
+
+    if ( isSameDirectory ){
+        std::set<std::string> written(shards.begin(), shards.end());
+        for ( std::vector<std::string>::iterator it = m_staleShards.begin(); it != m_staleShards.end(); ++it )
+            if ( written.count(*it) == 0 )
+                std::remove((directory + "/" + *it).c_str());
+    }
+
+    m_shards.clear();
+    for ( size_t i = 0; i < m_sequences.size(); ++i )
+        m_shards[m_sequences[i]].name = shards[i];
+    m_staleShards.clear();
+    m_shardDirectory = directory;
+    updateListeners();
+    return true;
+}
+
+inline void DataFile::closeShards(){
+    m_shardDirectory = "";
+    m_shards.clear();
+    m_staleShards.clear();
+    updateListeners();
+}
+
+inline void DataFile::setShardsDirty(){
+    for ( std::map<const Sequence*, Shard>::iterator it = m_shards.begin(); it != m_shards.end(); ++it )
+        it->second.isDirty = true;
+}
+
+inline bool DataFile::isShardDirectory(const std::string &path){
+    std::ifstream in((path + "/" + manifestName()).c_str(), std::ios::in | std::ios::binary);
+    return in.is_open();
+}
+
+// Renames the file over the destination, which some platforms need removed first
+inline bool DataFile::replaceFile(const std::string &from, const std::string &to){
+    if ( std::rename(from.c_str(), to.c_str()) == 0 )
+        return true;
+    std::remove(to.c_str());
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+// The file listens to the edits of its tracks while it has a journal or a shard directory
+inline void DataFile::updateListeners(){
+    TrackListener* listener = isJournalOpen() || !m_shardDirectory.empty() ? this : 0;
+    for ( TrackHeaderIterator it = tracksBegin(); it != tracksEnd(); ++it )
+        (*it)->setListener(listener);
+}
+
+// Opens the journal of the data file at the given path for appending. The file needs to hold the
+// contents of the data file with its journal replayed, as readFrom() leaves it.
+inline bool DataFile::openJournal(const std::string &path){
+    closeJournal();
+
+    std::string journalPath = path + JournalFormat::extension();
+    bool isEmpty = true;
+    {
+        std::ifstream in(journalPath.c_str(), std::ios::in | std::ios::binary);
+        isEmpty = !in.is_open() || in.peek() == std::ifstream::traits_type::eof();
+    }
+
+    m_journal.clear();
+    m_journal.open(journalPath.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+    if ( !m_journal.is_open() )
+        return false;
+    m_journalPath = path;
+
+    if ( isEmpty )
+        writeJournal(JournalFormat::header());
+
+    updateListeners();
+    return true;
+}
+
+inline void DataFile::closeJournal(){
+    if ( !isJournalOpen() )
+        return;
+
+    m_journal.close();
+    m_journalPath = "";
+    updateListeners();
+}
+
+inline bool DataFile::isJournalOpen() const{
+    return m_journal.is_open();
+}
+
+// Writes the file over its data file and empties the journal. The data file is replaced only once
+// it was written completely, and the journal records the hash of the new data file beforehand, so
+// an interrupted compaction leaves a pair that replays to the same contents.
+//
+// Shard directories are not compacted, since their shards are not replaced at once.
+inline bool DataFile::compactJournal(){
+    if ( !isJournalOpen() || isShardDirectory(m_journalPath) )
+        return false;
+    return writeTo(m_journalPath, formatFromPath(m_journalPath));
+}
+
+// Empties the journal, which is closed if it cannot be opened again
+inline bool DataFile::truncateJournal(){
+    std::string journalPath = m_journalPath + JournalFormat::extension();
+    m_journal.close();
+    m_journal.clear();
+    m_journal.open(journalPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if ( !m_journal.is_open() ){
+        m_journalPath = "";
+        updateListeners();
+        return false;
+    }
+    writeJournal(JournalFormat::header());
+    return true;
+}
+
+// The cache keeps a binary snapshot of each yaml file read through it, named after the hash and
+// size of the file's contents, so edited files get a new snapshot. On a cache miss the yaml file
+// is read completely and its snapshot written, a snapshot is read with the given load mode. The
+// directory needs to exist, and an empty path disables the cache.
+inline const std::string &DataFile::cacheDirectory() const{
+    return m_cacheDirectory;
+}
+
+inline void DataFile::setCacheDirectory(const std::string &path){
+    m_cacheDirectory = path;
+}
+
+// Returns the path of the snapshot for the file's current contents, or an empty string if the
+// cache is disabled or the file cannot be read
+inline std::string DataFile::cachePath(const std::string &path) const{
+    if ( m_cacheDirectory.empty() )
+        return "";
+
+    MappedFile source;
+    if ( !source.open(path) )
+        return "";
+
+    std::stringstream result;
+    result << m_cacheDirectory << '/' << std::hex << std::setw(16) << std::setfill('0')
+           << JournalFormat::hash(source.data(), source.size()) << std::dec << '-' << source.size()
+           << binaryExtension();
+    return result.str();
+}
+
+// The streaming reader covers Segment tracks in the block and single line flow layout written by
+// writeYaml(). Files it rejects, as with other track types, are read through cv::FileStorage with
+// the tracks of all sequences loaded, whatever the load mode.
+inline bool DataFile::readYamlFile(const std::string &path, LoadMode mode){
+    if ( mode != LOAD_ALL ){
+        std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+        if ( !in.is_open() )
+            return false;
+
+        try{
+            if ( mode == LOAD_STREAMING ){
+                readYaml(in, 0);
+            } else {
+                readYaml(in, new YamlSequenceLoader(m_tracks, path));
+                if ( mode == LOAD_PARALLEL )
+                    loadSequences();
+            }
+            return true;
+        } catch ( tg::Exception& ){
+        }
+    }
+
+    try{
+        cv::FileStorage fs(path, cv::FileStorage::READ | cv::FileStorage::FORMAT_YAML);
+        if ( !fs.isOpened() )
+            return false;
+        read(fs["TeGround"]);
+        fs.release();
+    } catch ( cv::Exception& e ){
+        throw tg::Exception(e.what());
+    }
+    return true;
+}
+
+// Reads the file if it is in the binary format, the file keeps the loader in lazy modes
+inline bool DataFile::readBinaryFile(const std::string &path, LoadMode mode){
+    BinarySequenceLoader* loader = new BinarySequenceLoader(m_tracks);
+    if ( !loader->open(path) || !BinaryFormat::isBinary(loader->data(), loader->size()) ){
+        delete loader;
+        return false;
+    }
+
+    try{
+        bool isLazy = mode == LOAD_LAZY || mode == LOAD_PARALLEL;
+        readBinary(loader->data(), loader->size(), isLazy ? loader : 0);
+    } catch ( ... ){
+        if ( m_loader != loader )
+            delete loader;
+        throw;
+    }
+    if ( m_loader != loader )
+        delete loader;
+    if ( mode == LOAD_PARALLEL )
+        loadSequences();
+    return true;
+}
+
+// Snapshots that cannot be read, as when written by another version, are replaced. Failing to
+// write a snapshot leaves the file as read from yaml.
+inline bool DataFile::readCached(const std::string &path, LoadMode mode){
+    std::string snapshotPath = cachePath(path);
+    if ( snapshotPath.empty() )
+        return false;
+
+    try{
+        if ( readBinaryFile(snapshotPath, mode) )
+            return true;
+    } catch ( tg::Exception& ){
+    }
+
+    if ( !readYamlFile(path, LOAD_STREAMING) )
+        return false;
+
+    // the snapshot appears complete or not at all
+    std::string tempPath = snapshotPath + ".tmp";
+    try{
+        if ( writeTo(tempPath, FORMAT_BINARY) && replaceFile(tempPath, snapshotPath) )
+            return true;
+    } catch ( tg::Exception& ){
+    }
+    std::remove(tempPath.c_str());
+    return true;
+}
+
+inline DataFile::Format DataFile::formatFromPath(const std::string &path){
+    const char* extensions[] = { binaryExtension(), compressedExtension() };
+    const Format formats[]   = { FORMAT_BINARY, FORMAT_COMPRESSED };
+    for ( size_t i = 0; i < 2; ++i ){
+        std::string extension = extensions[i];
+        if ( path.size() >= extension.size() &&
+             path.compare(path.size() - extension.size(), extension.size(), extension) == 0 )
+        {
+            return formats[i];
+        }
+    }
+    return FORMAT_YAML;
+}
+
+// Replays the complete records of the journal. Records up to the last compaction marker are skipped
+// if the marker's hash matches the data file, since the data file already holds them.
+inline void DataFile::replayJournal(const std::string &path, const std::string &dataPath){
+    std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+    if ( !in.is_open() )
+        return;
+
+    std::vector<std::string> lines;
+    std::string line;
+    while ( std::getline(in, line) ){
+        if ( in.eof() )
+            break;
+        lines.push_back(line);
+    }
+    if ( lines.empty() )
+        return;
+    if ( lines[0] != JournalFormat::header() )
+        throw Exception("Journal \'" + path + "\' has an unsupported header: " + lines[0]);
+
+    // the data file is hashed once, at the first marker found
+    size_t start = 1;
+    std::string marker;
+    for ( size_t i = lines.size() - 1; i > 0; --i ){
+        if ( lines[i].empty() || lines[i][0] != JournalFormat::COMPACTED )
+            continue;
+
+        if ( marker.empty() ){
+            std::stringstream hash;
+            hash << static_cast<char>(JournalFormat::COMPACTED) << ' ';
+            MappedFile data;
+            if ( data.open(dataPath) )
+                hash << JournalFormat::hash(data.data(), data.size());
+            marker = hash.str();
+        }
+        if ( lines[i] == marker ){
+            start = i + 1;
+            break;
+        }
+    }
+
+    for ( size_t i = start; i < lines.size(); ++i ){
+        try{
+            replayRecord(JournalFormat::split(lines[i]));
+        } catch ( tg::Exception& e ){
+            std::stringstream errorStream;
+            errorStream << "Journal \'" << path << "\' at line " << (i + 1) << ": " << e.message();
+            throw Exception(errorStream.str());
+        }
+    }
+}
+
+inline void DataFile::replayRecord(const std::vector<std::string> &fields){
+    if ( fields[0].size() != 1 )
+        throw Exception("Unknown record: " + fields[0]);
+
+    switch( fields[0][0] ){
+    case JournalFormat::INSERT_SEGMENT:{
+        SegmentTrack* track = journalTrack(fields, 6);
+        track->createSegment(
+            JournalFormat::time(fields[3]), JournalFormat::time(fields[4]), JournalFormat::decode(fields[5])
+        );
+        break;
+    }
+    case JournalFormat::REMOVE_SEGMENT:{
+        SegmentTrack* track = journalTrack(fields, 4);
+        uint64_t index = JournalFormat::number(fields[3]);
+        if ( index >= track->totalSegments() )
+            throw Exception("Out of bounds segment index: " + fields[3]);
+        track->removeSegment(track->begin() + static_cast<size_t>(index));
+        break;
+    }
+    case JournalFormat::ASSIGN_SEGMENT:{
+        SegmentTrack* track = journalTrack(fields, 6);
+        uint64_t index = JournalFormat::number(fields[3]);
+        if ( index >= track->totalSegments() )
+            throw Exception("Out of bounds segment index: " + fields[3]);
+        track->assignSegmentCoords(
+            track->begin() + static_cast<size_t>(index), JournalFormat::time(fields[4]), JournalFormat::time(fields[5])
+        );
+        break;
+    }
+    case JournalFormat::ASSIGN_DATA:{
+        SegmentTrack* track = journalTrack(fields, 5);
+        uint64_t index = JournalFormat::number(fields[3]);
+        if ( index >= track->totalSegments() )
+            throw Exception("Out of bounds segment index: " + fields[3]);
+        track->assignSegmentData(track->begin() + static_cast<size_t>(index), JournalFormat::decode(fields[4]));
+        break;
+    }
+    case JournalFormat::CLEAR_SEGMENTS:
+        journalTrack(fields, 3)->clearSegments();
+        break;
+    case JournalFormat::APPEND_TRACK:
+        if ( fields.size() != 3 )
+            throw Exception("Invalid number of fields for a track.");
+        appendTrack(JournalFormat::decode(fields[1]), JournalFormat::decode(fields[2]));
+        break;
+    case JournalFormat::REMOVE_TRACK:{
+        if ( fields.size() != 2 )
+            throw Exception("Invalid number of fields for a track removal.");
+        uint64_t index = JournalFormat::number(fields[1]);
+        if ( index >= m_tracks.size() )
+            throw Exception("Out of bounds header index: " + fields[1]);
+        removeTrack(m_tracks[static_cast<size_t>(index)]);
+        break;
+    }
+    case JournalFormat::CLEAR_TRACKS:
+        clearTracks();
+        break;
+    case JournalFormat::APPEND_SEQUENCE:{
+        if ( fields.size() != 5 )
+            throw Exception("Invalid number of fields for a sequence.");
+        uint64_t type = JournalFormat::number(fields[3]);
+        appendSequence(new Sequence(
+            JournalFormat::decode(fields[1]),
+            JournalFormat::decode(fields[2]),
+            type == Sequence::Image ? Sequence::Image : Sequence::Video,
+            JournalFormat::time(fields[4])
+        ));
+        break;
+    }
+    case JournalFormat::REMOVE_SEQUENCE:
+        if ( fields.size() != 2 )
+            throw Exception("Invalid number of fields for a sequence removal.");
+        removeSequence(m_sequences[journalSequence(fields[1])]);
+        break;
+    case JournalFormat::MOVE_SEQUENCE:{
+        if ( fields.size() != 3 )
+            throw Exception("Invalid number of fields for a sequence move.");
+        Sequence* seq = m_sequences[journalSequence(fields[1])];
+        uint64_t index = JournalFormat::number(fields[2]);
+        if ( index >= m_sequences.size() )
+            throw Exception("Out of bounds sequence index: " + fields[2]);
+        moveSequence(seq, static_cast<size_t>(index));
+        break;
+    }
+    case JournalFormat::CLEAR_SEQUENCES:
+        clearSequences();
+        break;
+    case JournalFormat::COMPACTED:
+        break;
+    default:
+        throw Exception("Unknown record: " + fields[0]);
+    }
+}
+
+// Returns the segment track given by the sequence and header indexes of a segment record
+inline SegmentTrack *DataFile::journalTrack(const std::vector<std::string> &fields, size_t count){
+    if ( fields.size() != count )
+        throw Exception("Invalid number of fields for a segment record.");
+
+    Sequence* seq = m_sequences[journalSequence(fields[1])];
+    uint64_t trackIndex = JournalFormat::number(fields[2]);
+    if ( trackIndex >= m_tracks.size() )
+        throw Exception("Out of bounds header index: " + fields[2]);
+    if ( m_tracks[static_cast<size_t>(trackIndex)]->type() != "Segment" )
+        throw Exception("Type is not supported by the journal: " + m_tracks[static_cast<size_t>(trackIndex)]->type());
+
+    return static_cast<SegmentTrack*>(seq->track(m_tracks[static_cast<size_t>(trackIndex)]));
+}
+
+inline size_t DataFile::journalSequence(const std::string &field) const{
+    uint64_t index = JournalFormat::number(field);
+    if ( index >= m_sequences.size() )
+        throw Exception("Out of bounds sequence index: " + field);
+    return static_cast<size_t>(index);
+}
+
+// Cached indexes are checked against the sequence, since sequences move and tracks are deleted
+// without notifying the listener. The cache is rebuilt when the track is missing or has moved.
+// Tracks of sequences that are not loaded have no edits yet, so they are not searched.
+inline size_t DataFile::trackSequenceIndex(const Track *track) const{
+    for ( int pass = 0; pass < 2; ++pass ){
+        std::map<const Track*, size_t>::const_iterator it = m_trackSequences.find(track);
+        if ( it != m_trackSequences.end() && it->second < m_sequences.size() ){
+            const Sequence* seq = m_sequences[it->second];
+            if ( seq->isLoaded() && seq->track(track->header()) == track )
+                return it->second;
+        }
+        if ( pass == 1 )
+            break;
+
+        m_trackSequences.clear();
+        for ( size_t i = 0; i < m_sequences.size(); ++i ){
+            if ( !m_sequences[i]->isLoaded() )
+                continue;
+            for ( Sequence::TrackConstIterator trackIt = m_sequences[i]->tracksBegin();
+                  trackIt != m_sequences[i]->tracksEnd(); ++trackIt )
+                m_trackSequences[*trackIt] = i;
+        }
+    }
+    return m_sequences.size();
+}
+
+// Each record is flushed, so a crash loses at most the record being written
+inline void DataFile::writeJournal(const std::string &record){
+    m_journal << record << '\n';
+    m_journal.flush();
+    if ( m_journal.fail() )
+        throw Exception("Failed to write to the journal of: " + m_journalPath);
+}
+
+inline void DataFile::segmentInserted(const Track *track, size_t, const Segment *segment){
+    size_t seqIndex = trackSequenceIndex(track);
+    if ( seqIndex == m_sequences.size() )
+        return;
+    markShardDirty(m_sequences[seqIndex]);
+    if ( !isJournalOpen() )
+        return;
+
+    std::stringstream record;
+    record << static_cast<char>(JournalFormat::INSERT_SEGMENT) << ' ' << seqIndex << ' '
+           << trackIndex(track->header()) << ' ' << segment->position() << ' ' << segment->length() << ' '
+           << JournalFormat::encode(segment->data());
+    writeJournal(record.str());
+}
+
+inline void DataFile::segmentRemoved(const Track *track, size_t index){
+    size_t seqIndex = trackSequenceIndex(track);
+    if ( seqIndex == m_sequences.size() )
+        return;
+    markShardDirty(m_sequences[seqIndex]);
+    if ( !isJournalOpen() )
+        return;
+
+    std::stringstream record;
+    record << static_cast<char>(JournalFormat::REMOVE_SEGMENT) << ' ' << seqIndex << ' '
+           << trackIndex(track->header()) << ' ' << index;
+    writeJournal(record.str());
+}
+
+inline void DataFile::segmentCoordsAssigned(const Track *track, size_t index, VideoTime position, VideoTime length){
+    size_t seqIndex = trackSequenceIndex(track);
+    if ( seqIndex == m_sequences.size() )
+        return;
+    markShardDirty(m_sequences[seqIndex]);
+    if ( !isJournalOpen() )
+        return;
+
+    std::stringstream record;
+    record << static_cast<char>(JournalFormat::ASSIGN_SEGMENT) << ' ' << seqIndex << ' '
+           << trackIndex(track->header()) << ' ' << index << ' ' << position << ' ' << length;
+    writeJournal(record.str());
+}
+
+inline void DataFile::segmentDataAssigned(const Track *track, size_t index, const std::string &data){
+    size_t seqIndex = trackSequenceIndex(track);
+    if ( seqIndex == m_sequences.size() )
+        return;
+    markShardDirty(m_sequences[seqIndex]);
+    if ( !isJournalOpen() )
+        return;
+
+    std::stringstream record;
+    record << static_cast<char>(JournalFormat::ASSIGN_DATA) << ' ' << seqIndex << ' '
+           << trackIndex(track->header()) << ' ' << index << ' ' << JournalFormat::encode(data);
+    writeJournal(record.str());
+}
+
+inline void DataFile::segmentsCleared(const Track *track){
+    size_t seqIndex = trackSequenceIndex(track);
+    if ( seqIndex == m_sequences.size() )
+        return;
+    markShardDirty(m_sequences[seqIndex]);
+    if ( !isJournalOpen() )
+        return;
+
+    std::stringstream record;
+    record << static_cast<char>(JournalFormat::CLEAR_SEGMENTS) << ' ' << seqIndex << ' ' << trackIndex(track->header());
+    writeJournal(record.str());
+}
 
 inline size_t DataFile::trackCount() const{
     return m_tracks.size();
@@ -257,10 +1638,25 @@ inline TrackHeader* DataFile::appendTrack(const std::string &type, const std::st
         seq->appendTrack(theader);
     }
 
+    setShardsDirty();
+    updateListeners();
+    if ( isJournalOpen() ){
+        writeJournal(
+            std::string(1, JournalFormat::APPEND_TRACK) + ' ' + JournalFormat::encode(type) + ' ' +
+            JournalFormat::encode(name)
+        );
+    }
+
     return theader;
 }
 
 inline void DataFile::removeTrack(TrackHeader *trackHeader){
+    setShardsDirty();
+    if ( isJournalOpen() ){
+        std::stringstream record;
+        record << static_cast<char>(JournalFormat::REMOVE_TRACK) << ' ' << trackIndex(trackHeader);
+        writeJournal(record.str());
+    }
 
     for ( SequenceIterator it = sequencesBegin(); it != sequencesEnd(); ++it ){
         Sequence* seq = *it;
@@ -278,6 +1674,9 @@ inline void DataFile::removeTrack(TrackHeader *trackHeader){
 }
 
 inline void DataFile::clearTracks(){
+    setShardsDirty();
+    if ( isJournalOpen() )
+        writeJournal(std::string(1, JournalFormat::CLEAR_TRACKS));
     for ( SequenceIterator it = sequencesBegin(); it != sequencesEnd(); ++it ){
         Sequence* seq = *it;
         seq->clearTracks();
@@ -316,11 +1715,28 @@ inline void DataFile::appendSequence(Sequence *seq){
     for ( TrackHeaderIterator it = tracksBegin(); it != tracksEnd(); ++it ){
         seq->appendTrack(*it);
     }
+
+    if ( isJournalOpen() ){
+        std::stringstream record;
+        record << static_cast<char>(JournalFormat::APPEND_SEQUENCE) << ' ' << JournalFormat::encode(seq->path())
+               << ' ' << JournalFormat::encode(seq->decoder()) << ' ' << static_cast<int>(seq->type())
+               << ' ' << seq->length();
+        writeJournal(record.str());
+    }
 }
 
 inline void DataFile::removeSequence(Sequence *seq){
     for ( SequenceIterator it = sequencesBegin(); it != sequencesEnd(); ++it ){
         if ( *it == seq ){
+            if ( isJournalOpen() ){
+                std::stringstream record;
+                record << static_cast<char>(JournalFormat::REMOVE_SEQUENCE) << ' ' << (it - sequencesBegin());
+                writeJournal(record.str());
+            }
+            if ( m_shards.count(seq) > 0 ){
+                m_staleShards.push_back(m_shards[seq].name);
+                m_shards.erase(seq);
+            }
             m_sequences.erase(it);
             delete seq;
             return;
@@ -339,6 +1755,17 @@ inline const Sequence *DataFile::sequenceAt(size_t index) const{
 inline Sequence *DataFile::takeSequence(Sequence *seq){
     for ( SequenceIterator it = sequencesBegin(); it != sequencesEnd(); ++it ){
         if ( *it == seq ){
+            // the sequence can outlive the file's loader
+            seq->totalTracks();
+            if ( isJournalOpen() ){
+                std::stringstream record;
+                record << static_cast<char>(JournalFormat::REMOVE_SEQUENCE) << ' ' << (it - sequencesBegin());
+                writeJournal(record.str());
+            }
+            if ( m_shards.count(seq) > 0 ){
+                m_staleShards.push_back(m_shards[seq].name);
+                m_shards.erase(seq);
+            }
             m_sequences.erase(it);
             return seq;
         }
@@ -351,6 +1778,11 @@ inline void DataFile::moveSequence(Sequence *seq, size_t indexTo){
         if ( seq == m_sequences[i] ){
             if ( i == indexTo )
                 return;
+            if ( isJournalOpen() ){
+                std::stringstream record;
+                record << static_cast<char>(JournalFormat::MOVE_SEQUENCE) << ' ' << i << ' ' << indexTo;
+                writeJournal(record.str());
+            }
             m_sequences.erase(sequencesBegin() + i);
             m_sequences.insert(sequencesBegin() + indexTo, seq);
             return;
@@ -367,9 +1799,18 @@ inline Sequence *DataFile::sequenceFrom(const std::string &path){
 }
 
 inline void DataFile::clearSequences(){
+    if ( isJournalOpen() )
+        writeJournal(std::string(1, JournalFormat::CLEAR_SEQUENCES));
+    for ( std::map<const Sequence*, Shard>::iterator it = m_shards.begin(); it != m_shards.end(); ++it )
+        m_staleShards.push_back(it->second.name);
+    m_shards.clear();
+
     for ( DataFile::SequenceIterator it = sequencesBegin(); it != sequencesEnd(); ++it )
         delete *it;
     m_sequences.clear();
+
+    delete m_loader;
+    m_loader = 0;
 }
 
 inline DataFile::SequenceIterator DataFile::sequencesBegin(){
@@ -388,6 +1829,43 @@ inline DataFile::SequenceConstIterator DataFile::sequencesEnd() const{
     return m_sequences.end();
 }
 
+// Loads the tracks of all sequences in parallel, then releases the loader. Errors are reported for
+// the first failing sequence in file order.
+inline void DataFile::loadSequences(){
+    std::vector<std::string> errors(m_sequences.size());
+    cv::parallel_for_(cv::Range(0, (int)m_sequences.size()), SequenceLoading(m_sequences, errors));
+
+    for ( std::vector<std::string>::iterator it = errors.begin(); it != errors.end(); ++it ){
+        if ( !it->empty() )
+            throw Exception(*it);
+    }
+
+    delete m_loader;
+    m_loader = 0;
+}
+
+inline void DataFile::SequenceLoading::operator()(const cv::Range& range) const{
+    for ( int i = range.start; i < range.end; ++i ){
+        try{
+            m_sequences[i]->totalTracks();
+        } catch ( tg::Exception& e ){
+            m_errors[i] = e.message();
+        } catch ( std::exception& e ){
+            m_errors[i] = e.what();
+        }
+    }
+}
+
+// Sequences that are not loaded yet are skipped, their indexes are built when they are loaded
+inline void DataFile::buildIndexes() const{
+    for ( SequenceConstIterator it = sequencesBegin(); it != sequencesEnd(); ++it ){
+        if ( !(*it)->isLoaded() )
+            continue;
+        for ( Sequence::TrackConstIterator trackIt = (*it)->tracksBegin(); trackIt != (*it)->tracksEnd(); ++trackIt )
+            (*trackIt)->buildIndex();
+    }
+}
+
 }// namespace tg
 
 #endif
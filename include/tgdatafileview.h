@@ -0,0 +1,266 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGDATAFILEVIEW_H
+#define TGDATAFILEVIEW_H
+
+#include "tgglobal.h"
+#include "tgsequence.h"
+#include "tgbinaryformat.h"
+#include "tgmappedfile.h"
+#include "tgsegmenttrackview.h"
+
+namespace tg{
+
+// Read-only access to a binary data file without loading it. Queries are answered directly from
+// the file's arrays, no Sequence, Track or Segment objects are created. All sections are
+// validated when the file is opened, after which the view can be shared between threads.
+class DataFileView{
+
+public:
+    class SequenceView{
+
+    public:
+        std::string path() const;
+        std::string decoder() const;
+        Sequence::Type type() const;
+        VideoTime length() const;
+
+        SegmentTrackView track(size_t trackIndex) const;
+
+    private:
+        friend class DataFileView;
+
+        SequenceView(const DataFileView* file, size_t index)
+            : m_file(file)
+            , m_index(index)
+        {}
+
+        const BinaryFormat::SequenceEntry& entry() const;
+
+        const DataFileView* m_file;
+        size_t              m_index;
+    };
+
+public:
+    DataFileView();
+    ~DataFileView();
+
+    bool open(const std::string& path);
+    void assign(const char* data, size_t size);
+    void close();
+    bool isOpen() const;
+
+    size_t trackCount() const;
+    size_t trackIndex(const std::string& name) const;
+    std::string trackName(size_t index) const;
+    std::string trackType(size_t index) const;
+
+    size_t sequenceCount() const;
+    SequenceView sequenceAt(size_t index) const;
+
+private:
+    void validate();
+
+    // prevent copy
+    DataFileView(const DataFileView&);
+    DataFileView& operator = (const DataFileView&);
+
+    MappedFile  m_file;
+    const char* m_data;
+    size_t      m_size;
+
+    const BinaryFormat::FileHeader*        m_header;
+    const BinaryFormat::TrackEntry*        m_trackEntries;
+    const BinaryFormat::SequenceEntry*     m_sequenceEntries;
+    const BinaryFormat::SegmentTrackEntry* m_segmentTrackEntries;
+};
+
+inline DataFileView::DataFileView()
+    : m_data(0)
+    , m_size(0)
+    , m_header(0)
+    , m_trackEntries(0)
+    , m_sequenceEntries(0)
+    , m_segmentTrackEntries(0)
+{
+}
+
+inline DataFileView::~DataFileView(){
+    close();
+}
+
+// Maps the file at the given path. Returns false if the file cannot be opened, and throws if the
+// file is not a valid binary data file.
+inline bool DataFileView::open(const std::string& path){
+    close();
+    if ( !m_file.open(path) )
+        return false;
+
+    try{
+        assign(m_file.data(), m_file.size());
+    } catch ( ... ){
+        m_file.close();
+        throw;
+    }
+    return true;
+}
+
+// Views data owned by the caller, which needs to stay valid and 8 byte aligned while in use
+inline void DataFileView::assign(const char* data, size_t size){
+    m_data = data;
+    m_size = size;
+    try{
+        validate();
+    } catch ( ... ){
+        m_data   = 0;
+        m_size   = 0;
+        m_header = 0;
+        throw;
+    }
+}
+
+inline void DataFileView::close(){
+    m_file.close();
+    m_data                = 0;
+    m_size                = 0;
+    m_header              = 0;
+    m_trackEntries        = 0;
+    m_sequenceEntries     = 0;
+    m_segmentTrackEntries = 0;
+}
+
+inline bool DataFileView::isOpen() const{
+    return m_header != 0;
+}
+
+inline size_t DataFileView::trackCount() const{
+    return m_header ? static_cast<size_t>(m_header->trackCount) : 0;
+}
+
+// Returns the index of the track with the given name, or trackCount() if there is none
+inline size_t DataFileView::trackIndex(const std::string &name) const{
+    for ( size_t i = 0; i < trackCount(); ++i ){
+        if ( trackName(i) == name )
+            return i;
+    }
+    return trackCount();
+}
+
+inline std::string DataFileView::trackName(size_t index) const{
+    return BinaryFormat::string(m_data, *m_header, m_trackEntries[index].name);
+}
+
+inline std::string DataFileView::trackType(size_t index) const{
+    return BinaryFormat::string(m_data, *m_header, m_trackEntries[index].type);
+}
+
+inline size_t DataFileView::sequenceCount() const{
+    return m_header ? static_cast<size_t>(m_header->sequenceCount) : 0;
+}
+
+inline DataFileView::SequenceView DataFileView::sequenceAt(size_t index) const{
+    return SequenceView(this, index);
+}
+
+inline void DataFileView::validate(){
+    const BinaryFormat::FileHeader& header = BinaryFormat::header(m_data, m_size);
+
+    m_trackEntries =
+        BinaryFormat::section<BinaryFormat::TrackEntry>(m_data, m_size, header.tracksOffset, header.trackCount);
+    m_sequenceEntries =
+        BinaryFormat::section<BinaryFormat::SequenceEntry>(m_data, m_size, header.sequencesOffset, header.sequenceCount);
+    if ( header.trackCount > 0 && header.sequenceCount > (uint64_t)(-1) / header.trackCount )
+        throw Exception("Binary data file is corrupted: too many segment tracks.");
+    m_segmentTrackEntries = BinaryFormat::section<BinaryFormat::SegmentTrackEntry>(
+        m_data, m_size, header.segmentTracksOffset, header.sequenceCount * header.trackCount
+    );
+
+    for ( uint64_t i = 0; i < header.trackCount; ++i ){
+        std::string trackType = BinaryFormat::string(m_data, header, m_trackEntries[i].type);
+        if ( trackType != "Segment" )
+            throw Exception("Type is not supported by the binary format: " + trackType);
+        BinaryFormat::string(m_data, header, m_trackEntries[i].name);
+    }
+
+    // the arrays of each segment track are checked once here, so track views can skip the checks
+
+    for ( uint64_t i = 0; i < header.sequenceCount * header.trackCount; ++i ){
+        const BinaryFormat::SegmentTrackEntry& entry = m_segmentTrackEntries[i];
+        if ( entry.indexLeaves < entry.count || entry.indexLeaves == 0 ||
+             (entry.indexLeaves & (entry.indexLeaves - 1)) != 0 ||
+             entry.indexLeaves > (uint64_t)(-1) / 2
+        ){
+            throw Exception("Binary data file is corrupted: invalid segment index.");
+        }
+        BinaryFormat::section<VideoTime>(m_data, m_size, entry.positionsOffset, entry.count);
+        BinaryFormat::section<VideoTime>(m_data, m_size, entry.lengthsOffset, entry.count);
+        BinaryFormat::section<BinaryFormat::StringRef>(m_data, m_size, entry.dataOffset, entry.count);
+        BinaryFormat::section<VideoTime>(m_data, m_size, entry.indexOffset, 2 * entry.indexLeaves);
+    }
+
+    m_header = &header;
+}
+
+// DataFileView::SequenceView
+// --------------------------
+
+inline std::string DataFileView::SequenceView::path() const{
+    return BinaryFormat::string(m_file->m_data, *m_file->m_header, entry().path);
+}
+
+inline std::string DataFileView::SequenceView::decoder() const{
+    return BinaryFormat::string(m_file->m_data, *m_file->m_header, entry().decoder);
+}
+
+inline Sequence::Type DataFileView::SequenceView::type() const{
+    return entry().type == Sequence::Image ? Sequence::Image : Sequence::Video;
+}
+
+inline VideoTime DataFileView::SequenceView::length() const{
+    return entry().length;
+}
+
+inline SegmentTrackView DataFileView::SequenceView::track(size_t trackIndex) const{
+    const char* data = m_file->m_data;
+    const BinaryFormat::FileHeader& header   = *m_file->m_header;
+    const BinaryFormat::SegmentTrackEntry& e = m_file->m_segmentTrackEntries[m_index * header.trackCount + trackIndex];
+
+    SegmentTrackView trackView(
+        length(),
+        static_cast<size_t>(e.count),
+        reinterpret_cast<const VideoTime*>(data + e.positionsOffset),
+        reinterpret_cast<const VideoTime*>(data + e.lengthsOffset),
+        reinterpret_cast<const VideoTime*>(data + e.indexOffset),
+        static_cast<size_t>(e.indexLeaves)
+    );
+    trackView.setSegmentData(
+        reinterpret_cast<const BinaryFormat::StringRef*>(data + e.dataOffset),
+        data + header.stringsOffset,
+        static_cast<size_t>(header.stringsSize)
+    );
+    return trackView;
+}
+
+inline const BinaryFormat::SequenceEntry& DataFileView::SequenceView::entry() const{
+    return m_file->m_sequenceEntries[m_index];
+}
+
+} // namespace
+
+#endif // TGDATAFILEVIEW_H
@@ -0,0 +1,181 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGFRAMEBITMAP_H
+#define TGFRAMEBITMAP_H
+
+#include "tgglobal.h"
+#include "tgsegmenttrackview.h"
+#include <stdint.h>
+#include <vector>
+
+namespace tg{
+
+// One bit per frame of a sequence, set for the frames covered by segments or detections. Frames
+// are packed in 64 bit words, so comparing two bitmaps takes one AND or AND NOT and a population
+// count per 64 frames.
+class FrameBitmap{
+
+public:
+    FrameBitmap();
+    explicit FrameBitmap(VideoTime length);
+    explicit FrameBitmap(const SegmentTrackView& track);
+
+    void resize(VideoTime length);
+    VideoTime length() const;
+
+    void set(VideoTime position, VideoTime length);
+    void set(const SegmentTrackView& track);
+    bool test(VideoTime frame) const;
+    void clear();
+
+    VideoTime count() const;
+    VideoTime countAnd(const FrameBitmap& other) const;
+    VideoTime countAndNot(const FrameBitmap& other) const;
+
+    const std::vector<uint64_t>& words() const;
+
+    static VideoTime popcount(uint64_t word);
+
+private:
+    void checkLength(const FrameBitmap& other) const;
+
+    std::vector<uint64_t> m_words;
+    VideoTime             m_length;
+};
+
+inline FrameBitmap::FrameBitmap()
+    : m_length(0)
+{
+}
+
+inline FrameBitmap::FrameBitmap(VideoTime length)
+    : m_length(0)
+{
+    resize(length);
+}
+
+// Bitmap of the frames covered by the segments of a track
+inline FrameBitmap::FrameBitmap(const SegmentTrackView& track)
+    : m_length(0)
+{
+    resize(track.length());
+    set(track);
+}
+
+// Resizes the bitmap to the given number of frames, with all frames cleared
+inline void FrameBitmap::resize(VideoTime length){
+    if ( length < 0 )
+        length = 0;
+    m_length = length;
+    m_words.assign(static_cast<size_t>((length + 63) / 64), 0);
+}
+
+inline VideoTime FrameBitmap::length() const{
+    return m_length;
+}
+
+// Sets the frames in [position, position + length), frames outside the bitmap are ignored
+inline void FrameBitmap::set(VideoTime position, VideoTime length){
+    VideoTime end = position + length;
+    if ( position < 0 )
+        position = 0;
+    if ( end > m_length )
+        end = m_length;
+    if ( position >= end )
+        return;
+
+    size_t first = static_cast<size_t>(position / 64);
+    size_t last  = static_cast<size_t>((end - 1) / 64);
+    uint64_t firstMask = ~static_cast<uint64_t>(0) << (position % 64);
+    uint64_t lastMask  = ~static_cast<uint64_t>(0) >> (63 - (end - 1) % 64);
+
+    if ( first == last ){
+        m_words[first] |= firstMask & lastMask;
+        return;
+    }
+    m_words[first] |= firstMask;
+    for ( size_t i = first + 1; i < last; ++i )
+        m_words[i] = ~static_cast<uint64_t>(0);
+    m_words[last] |= lastMask;
+}
+
+inline void FrameBitmap::set(const SegmentTrackView& track){
+    for ( size_t i = 0; i < track.totalSegments(); ++i )
+        set(track.segmentPosition(i), track.segmentLength(i));
+}
+
+inline bool FrameBitmap::test(VideoTime frame) const{
+    if ( frame < 0 || frame >= m_length )
+        return false;
+    return (m_words[static_cast<size_t>(frame / 64)] >> (frame % 64)) & 1;
+}
+
+inline void FrameBitmap::clear(){
+    m_words.assign(m_words.size(), 0);
+}
+
+// Number of frames set
+inline VideoTime FrameBitmap::count() const{
+    VideoTime total = 0;
+    for ( size_t i = 0; i < m_words.size(); ++i )
+        total += popcount(m_words[i]);
+    return total;
+}
+
+// Number of frames set in both bitmaps
+inline VideoTime FrameBitmap::countAnd(const FrameBitmap& other) const{
+    checkLength(other);
+    VideoTime total = 0;
+    for ( size_t i = 0; i < m_words.size(); ++i )
+        total += popcount(m_words[i] & other.m_words[i]);
+    return total;
+}
+
+// Number of frames set in this bitmap and not in the other
+inline VideoTime FrameBitmap::countAndNot(const FrameBitmap& other) const{
+    checkLength(other);
+    VideoTime total = 0;
+    for ( size_t i = 0; i < m_words.size(); ++i )
+        total += popcount(m_words[i] & ~other.m_words[i]);
+    return total;
+}
+
+inline const std::vector<uint64_t>& FrameBitmap::words() const{
+    return m_words;
+}
+
+inline VideoTime FrameBitmap::popcount(uint64_t word){
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return static_cast<VideoTime>((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+inline void FrameBitmap::checkLength(const FrameBitmap& other) const{
+    if ( m_length != other.m_length )
+        throw Exception("Frame bitmaps have different lengths.");
+}
+
+} // namespace
+
+#endif // TGFRAMEBITMAP_H
@@ -0,0 +1,200 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGINTERVALINDEX_H
+#define TGINTERVALINDEX_H
+
+#include "tgglobal.h"
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+namespace tg{
+
+// Implicit binary tree over intervals sorted by position, where each node keeps the maximum
+// end (position + length) of the intervals below it.
+//
+// Changing an interval in place updates its leaf and ancestors in O(log n). Inserting or erasing
+// at index i shifts the leaves from i onwards and updates their ancestors in O(n - i), the same
+// cost as shifting a sorted array, as long as size() stays within capacity().
+class IntervalIndex{
+
+public:
+    IntervalIndex();
+    ~IntervalIndex(){}
+
+    void resize(size_t count, size_t capacity = 0);
+    void setInterval(size_t index, VideoTime position, VideoTime length);
+    void update();
+    void clear();
+
+    void assignInterval(size_t index, VideoTime position, VideoTime length);
+    void insertInterval(size_t index, VideoTime position, VideoTime length);
+    void eraseInterval(size_t index);
+
+    size_t size() const;
+    size_t capacity() const;
+    size_t leaves() const;
+    const std::vector<VideoTime>& maxEnds() const;
+
+    size_t firstEndingAfter(size_t from, size_t to, VideoTime position) const;
+    static size_t firstEndingAfter(
+        const VideoTime* maxEnd,
+        size_t leaves,
+        size_t count,
+        size_t from,
+        size_t to,
+        VideoTime position
+    );
+
+private:
+    void updateRange(size_t from, size_t to);
+
+    std::vector<VideoTime> m_maxEnd;
+    size_t                 m_count;
+    size_t                 m_leaves;
+};
+
+inline IntervalIndex::IntervalIndex()
+    : m_count(0)
+    , m_leaves(0)
+{
+}
+
+inline void IntervalIndex::resize(size_t count, size_t capacity){
+    m_count  = count;
+    m_leaves = 1;
+    while ( m_leaves < count || m_leaves < capacity )
+        m_leaves <<= 1;
+    m_maxEnd.assign(2 * m_leaves, LLONG_MIN);
+}
+
+inline void IntervalIndex::setInterval(size_t index, VideoTime position, VideoTime length){
+    m_maxEnd[m_leaves + index] = position + length;
+}
+
+inline void IntervalIndex::update(){
+    for ( size_t i = m_leaves - 1; i > 0; --i )
+        m_maxEnd[i] = m_maxEnd[2 * i] > m_maxEnd[2 * i + 1] ? m_maxEnd[2 * i] : m_maxEnd[2 * i + 1];
+}
+
+inline void IntervalIndex::assignInterval(size_t index, VideoTime position, VideoTime length){
+    m_maxEnd[m_leaves + index] = position + length;
+    updateRange(index, index + 1);
+}
+
+// Requires size() < capacity()
+inline void IntervalIndex::insertInterval(size_t index, VideoTime position, VideoTime length){
+    VideoTime* leaf = &m_maxEnd[m_leaves];
+    std::copy_backward(leaf + index, leaf + m_count, leaf + m_count + 1);
+    leaf[index] = position + length;
+    ++m_count;
+    updateRange(index, m_count);
+}
+
+inline void IntervalIndex::eraseInterval(size_t index){
+    VideoTime* leaf = &m_maxEnd[m_leaves];
+    std::copy(leaf + index + 1, leaf + m_count, leaf + index);
+    leaf[m_count - 1] = LLONG_MIN;
+    updateRange(index, m_count);
+    --m_count;
+}
+
+// Updates the ancestors of the leaves in [from, to)
+inline void IntervalIndex::updateRange(size_t from, size_t to){
+    if ( from >= to )
+        return;
+    size_t first = m_leaves + from;
+    size_t last  = m_leaves + to - 1;
+    while ( first > 1 ){
+        first >>= 1;
+        last  >>= 1;
+        for ( size_t i = first; i <= last; ++i )
+            m_maxEnd[i] = m_maxEnd[2 * i] > m_maxEnd[2 * i + 1] ? m_maxEnd[2 * i] : m_maxEnd[2 * i + 1];
+    }
+}
+
+inline void IntervalIndex::clear(){
+    m_maxEnd.clear();
+    m_count  = 0;
+    m_leaves = 0;
+}
+
+inline size_t IntervalIndex::size() const{
+    return m_count;
+}
+
+inline size_t IntervalIndex::capacity() const{
+    return m_leaves;
+}
+
+inline size_t IntervalIndex::leaves() const{
+    return m_leaves;
+}
+
+inline const std::vector<VideoTime>& IntervalIndex::maxEnds() const{
+    return m_maxEnd;
+}
+
+// Returns the first index in [from, to) of an interval ending after position, or 'to' if none is found
+inline size_t IntervalIndex::firstEndingAfter(size_t from, size_t to, VideoTime position) const{
+    if ( m_maxEnd.empty() )
+        return 0;
+    return firstEndingAfter(&m_maxEnd[0], m_leaves, m_count, from, to, position);
+}
+
+// Same query over a tree stored elsewhere, such as a mapped file
+inline size_t IntervalIndex::firstEndingAfter(
+        const VideoTime* maxEnd,
+        size_t leaves,
+        size_t count,
+        size_t from,
+        size_t to,
+        VideoTime position)
+{
+    if ( to > count )
+        to = count;
+    if ( from >= to )
+        return to;
+
+    // climb until we reach a subtree to the right of 'from' that holds a candidate
+
+    size_t node = leaves + from;
+    while ( maxEnd[node] <= position ){
+        while ( node & 1 )
+            node >>= 1;
+        if ( node == 0 )
+            return to;
+        ++node;
+    }
+
+    // descend to the leftmost candidate leaf
+
+    while ( node < leaves ){
+        node <<= 1;
+        if ( maxEnd[node] <= position )
+            ++node;
+    }
+
+    size_t index = node - leaves;
+    return index < to ? index : to;
+}
+
+} // namespace
+
+#endif // TGINTERVALINDEX_H
@@ -0,0 +1,160 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGJOURNALFORMAT_H
+#define TGJOURNALFORMAT_H
+
+#include "tgglobal.h"
+#include "tgbinaryformat.h"
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include <cctype>
+
+namespace tg{
+
+// Layout of the edit journal kept next to a data file. The journal is a text file starting with
+// the header line, followed by one record per line: the record type character and its fields,
+// separated by single spaces. Strings are percent encoded so they contain no spaces or line
+// breaks. A last line without a line break is an interrupted write and is ignored.
+//
+// Sequences and tracks are identified by their index in the data file, and segments by their
+// index in the track, so records are replayed in the order they were written.
+class JournalFormat{
+
+public:
+    enum Record{
+        INSERT_SEGMENT  = 'I', // sequence track position length data
+        REMOVE_SEGMENT  = 'R', // sequence track index
+        ASSIGN_SEGMENT  = 'A', // sequence track index position length
+        ASSIGN_DATA     = 'D', // sequence track index data
+        CLEAR_SEGMENTS  = 'C', // sequence track
+        APPEND_TRACK    = 'T', // type name
+        REMOVE_TRACK    = 'X', // track
+        CLEAR_TRACKS    = 'Y', //
+        APPEND_SEQUENCE = 'S', // path decoder type length
+        REMOVE_SEQUENCE = 'Q', // sequence
+        MOVE_SEQUENCE   = 'M', // sequence index
+        CLEAR_SEQUENCES = 'Z', //
+        COMPACTED       = 'K'  // hash of the data file that holds the records before this one
+    };
+
+    static const char* header();
+    static const char* extension();
+
+    static std::string encode(const std::string& str);
+    static std::string decode(const std::string& str);
+    static uint64_t hash(const char* data, size_t size);
+
+    static std::vector<std::string> split(const std::string& line);
+    static uint64_t number(const std::string& field);
+    static VideoTime time(const std::string& field);
+};
+
+inline const char* JournalFormat::header(){
+    return "tgjournal 1";
+}
+
+inline const char* JournalFormat::extension(){
+    return ".journal";
+}
+
+inline std::string JournalFormat::encode(const std::string& str){
+    static const char digits[] = "0123456789ABCDEF";
+
+    // empty strings need a field as well
+    if ( str.empty() )
+        return "%";
+
+    std::string result;
+    result.reserve(str.size());
+    for ( size_t i = 0; i < str.size(); ++i ){
+        unsigned char c = static_cast<unsigned char>(str[i]);
+        if ( c <= ' ' || c == '%' || c == 0x7f ){
+            result += '%';
+            result += digits[c >> 4];
+            result += digits[c & 0xf];
+        } else {
+            result += static_cast<char>(c);
+        }
+    }
+    return result;
+}
+
+inline std::string JournalFormat::decode(const std::string& str){
+    if ( str == "%" )
+        return "";
+
+    std::string result;
+    result.reserve(str.size());
+    for ( size_t i = 0; i < str.size(); ++i ){
+        if ( str[i] != '%' ){
+            result += str[i];
+            continue;
+        }
+        if ( i + 2 >= str.size() || !std::isxdigit(static_cast<unsigned char>(str[i + 1])) ||
+             !std::isxdigit(static_cast<unsigned char>(str[i + 2])) )
+            throw Exception("Journal is corrupted: invalid string: " + str);
+        result += static_cast<char>(std::strtol(str.substr(i + 1, 2).c_str(), 0, 16));
+        i += 2;
+    }
+    return result;
+}
+
+// 64 bit FNV-1a
+inline uint64_t JournalFormat::hash(const char* data, size_t size){
+    uint64_t result = 14695981039346656037ULL;
+    for ( size_t i = 0; i < size; ++i ){
+        result ^= static_cast<unsigned char>(data[i]);
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+
+inline std::vector<std::string> JournalFormat::split(const std::string& line){
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while ( start <= line.size() ){
+        size_t end = line.find(' ', start);
+        if ( end == std::string::npos )
+            end = line.size();
+        fields.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+    return fields;
+}
+
+inline uint64_t JournalFormat::number(const std::string& field){
+    std::stringstream stream(field);
+    uint64_t result;
+    if ( field.empty() || field[0] == '-' || !(stream >> result) || !stream.eof() )
+        throw Exception("Journal is corrupted: invalid number: " + field);
+    return result;
+}
+
+inline VideoTime JournalFormat::time(const std::string& field){
+    std::stringstream stream(field);
+    VideoTime result;
+    if ( field.empty() || !(stream >> result) || !stream.eof() )
+        throw Exception("Journal is corrupted: invalid time: " + field);
+    return result;
+}
+
+} // namespace
+
+#endif // TGJOURNALFORMAT_H
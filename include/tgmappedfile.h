@@ -0,0 +1,188 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGMAPPEDFILE_H
+#define TGMAPPEDFILE_H
+
+#include "tgglobal.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace tg{
+
+// Read-only view of a file mapped in memory
+class MappedFile{
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const;
+    const char* data() const;
+    size_t size() const;
+
+private:
+    // prevent copy
+    MappedFile(const MappedFile&);
+    MappedFile& operator = (const MappedFile&);
+
+    const char* m_data;
+    size_t      m_size;
+    bool        m_isOpen;
+
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#endif
+};
+
+inline MappedFile::MappedFile()
+    : m_data(0)
+    , m_size(0)
+    , m_isOpen(false)
+#ifdef _WIN32
+    , m_file(INVALID_HANDLE_VALUE)
+    , m_mapping(0)
+#endif
+{
+}
+
+inline MappedFile::~MappedFile(){
+    close();
+}
+
+#ifdef _WIN32
+
+inline bool MappedFile::open(const std::string& path){
+    close();
+
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if ( m_file == INVALID_HANDLE_VALUE )
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if ( !GetFileSizeEx(m_file, &fileSize) ){
+        close();
+        return false;
+    }
+    m_size   = static_cast<size_t>(fileSize.QuadPart);
+    m_isOpen = true;
+    if ( m_size == 0 )
+        return true;
+
+    m_mapping = CreateFileMappingA(m_file, 0, PAGE_READONLY, 0, 0, 0);
+    if ( m_mapping == 0 ){
+        close();
+        return false;
+    }
+
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if ( m_data == 0 ){
+        close();
+        return false;
+    }
+    return true;
+}
+
+inline void MappedFile::close(){
+    if ( m_data )
+        UnmapViewOfFile(m_data);
+    if ( m_mapping )
+        CloseHandle(m_mapping);
+    if ( m_file != INVALID_HANDLE_VALUE )
+        CloseHandle(m_file);
+
+    m_data    = 0;
+    m_size    = 0;
+    m_isOpen  = false;
+    m_mapping = 0;
+    m_file    = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+inline bool MappedFile::open(const std::string& path){
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if ( fd == -1 )
+        return false;
+
+    struct stat fileStat;
+    if ( fstat(fd, &fileStat) != 0 ){
+        ::close(fd);
+        return false;
+    }
+
+    m_size   = static_cast<size_t>(fileStat.st_size);
+    m_isOpen = true;
+    if ( m_size > 0 ){
+        void* mapped = mmap(0, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if ( mapped == MAP_FAILED ){
+            ::close(fd);
+            m_size   = 0;
+            m_isOpen = false;
+            return false;
+        }
+        m_data = static_cast<const char*>(mapped);
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    return true;
+}
+
+inline void MappedFile::close(){
+    if ( m_data )
+        munmap(const_cast<char*>(m_data), m_size);
+
+    m_data   = 0;
+    m_size   = 0;
+    m_isOpen = false;
+}
+
+#endif
+
+inline bool MappedFile::isOpen() const{
+    return m_isOpen;
+}
+
+inline const char* MappedFile::data() const{
+    return m_data;
+}
+
+inline size_t MappedFile::size() const{
+    return m_size;
+}
+
+} // namespace
+
+#endif // TGMAPPEDFILE_H
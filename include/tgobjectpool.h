@@ -0,0 +1,165 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGOBJECTPOOL_H
+#define TGOBJECTPOOL_H
+
+#include "tgglobal.h"
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <new>
+
+namespace tg{
+
+// Allocates objects in blocks and destroys them all at once. Objects destroyed individually leave
+// their slot to the next object created, the memory is released when the pool is cleared.
+template<typename T> class ObjectPool{
+
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 256;
+    static const size_t MAX_BLOCK_SIZE     = 65536;
+
+public:
+    ObjectPool();
+    ~ObjectPool();
+
+    T* create();
+    T* create(const T& other);
+    void destroy(T* object);
+
+    void reserve(size_t count);
+    bool owns(const T* object) const;
+    size_t size() const;
+    void clear();
+
+private:
+    class Block{
+    public:
+        Block(size_t pCapacity)
+            : data(static_cast<T*>(::operator new(pCapacity * sizeof(T))))
+            , capacity(pCapacity)
+            , used(0)
+        {}
+
+        T*     data;
+        size_t capacity;
+        size_t used;
+    };
+
+    void* nextSlot();
+
+    // prevent copy
+    ObjectPool(const ObjectPool&);
+    ObjectPool& operator = (const ObjectPool&);
+
+    std::vector<Block> m_blocks;
+    std::vector<T*>    m_freeSlots;
+    size_t             m_size;
+};
+
+template<typename T> inline ObjectPool<T>::ObjectPool()
+    : m_size(0)
+{
+}
+
+template<typename T> inline ObjectPool<T>::~ObjectPool(){
+    clear();
+}
+
+template<typename T> inline T* ObjectPool<T>::create(){
+    if ( !m_freeSlots.empty() ){
+        T* object = new (m_freeSlots.back()) T;
+        m_freeSlots.pop_back();
+        ++m_size;
+        return object;
+    }
+
+    T* object = new (nextSlot()) T;
+    ++m_blocks.back().used;
+    ++m_size;
+    return object;
+}
+
+template<typename T> inline T* ObjectPool<T>::create(const T& other){
+    if ( !m_freeSlots.empty() ){
+        T* object = new (m_freeSlots.back()) T(other);
+        m_freeSlots.pop_back();
+        ++m_size;
+        return object;
+    }
+
+    T* object = new (nextSlot()) T(other);
+    ++m_blocks.back().used;
+    ++m_size;
+    return object;
+}
+
+// Destroys an object created by this pool
+template<typename T> inline void ObjectPool<T>::destroy(T* object){
+    object->~T();
+    m_freeSlots.push_back(object);
+    --m_size;
+}
+
+template<typename T> inline void ObjectPool<T>::reserve(size_t count){
+    if ( m_blocks.size() > 0 && m_blocks.back().capacity - m_blocks.back().used >= count )
+        return;
+    if ( count > 0 )
+        m_blocks.push_back(Block(count));
+}
+
+template<typename T> inline bool ObjectPool<T>::owns(const T* object) const{
+    for ( typename std::vector<Block>::const_iterator it = m_blocks.begin(); it != m_blocks.end(); ++it ){
+        if ( object >= it->data && object < it->data + it->used )
+            return true;
+    }
+    return false;
+}
+
+template<typename T> inline size_t ObjectPool<T>::size() const{
+    return m_size;
+}
+
+template<typename T> inline void ObjectPool<T>::clear(){
+    std::sort(m_freeSlots.begin(), m_freeSlots.end(), std::less<T*>());
+    for ( typename std::vector<Block>::iterator it = m_blocks.begin(); it != m_blocks.end(); ++it ){
+        for ( size_t i = 0; i < it->used; ++i ){
+            if ( m_freeSlots.empty() || !std::binary_search(m_freeSlots.begin(), m_freeSlots.end(), it->data + i, std::less<T*>()) )
+                it->data[i].~T();
+        }
+        ::operator delete(it->data);
+    }
+    m_blocks.clear();
+    m_freeSlots.clear();
+    m_size = 0;
+}
+
+template<typename T> inline void* ObjectPool<T>::nextSlot(){
+    if ( m_blocks.size() == 0 || m_blocks.back().used == m_blocks.back().capacity ){
+        size_t capacity = m_blocks.size() == 0 ? DEFAULT_BLOCK_SIZE : m_blocks.back().capacity * 2;
+        if ( capacity > MAX_BLOCK_SIZE )
+            capacity = MAX_BLOCK_SIZE;
+        m_blocks.push_back(Block(capacity));
+    }
+    return m_blocks.back().data + m_blocks.back().used;
+}
+
+} // namespace
+
+#endif // TGOBJECTPOOL_H
@@ -0,0 +1,624 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGOVERLAPKERNEL_H
+#define TGOVERLAPKERNEL_H
+
+#include "tgglobal.h"
+#include <stdint.h>
+#include <limits>
+
+#ifndef TG_DISABLE_SIMD
+#if defined(__AVX2__)
+#define TG_OVERLAP_KERNEL_AVX2
+#include <immintrin.h>
+#elif defined(__SSE4_2__)
+#define TG_OVERLAP_KERNEL_SSE4
+#include <nmmintrin.h>
+#elif (defined(__x86_64__) || defined(__i386__)) && \
+      (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define TG_OVERLAP_KERNEL_DISPATCH
+#define TG_OVERLAP_KERNEL_AVX2
+#define TG_OVERLAP_KERNEL_SSE4
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(TG_OVERLAP_KERNEL_DISPATCH)
+#define TG_OVERLAP_TARGET_AVX2 __attribute__((target("avx2")))
+#define TG_OVERLAP_TARGET_SSE4 __attribute__((target("sse4.2")))
+#else
+#define TG_OVERLAP_TARGET_AVX2
+#define TG_OVERLAP_TARGET_SSE4
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace tg{
+
+// Overlap test of one detection against a contiguous block of segments. The overlap, missed and
+// unmarked lengths and the seven thresholds are evaluated without branches, 4 segments at a time
+// with AVX2 or 2 with SSE4.2, and the result is a mask with bit i set if segment i matches. The
+// instruction set is the one enabled at compile time, or when none is, GCC and Clang builds for
+// x86 compile both kernels and pick one for the CPU at run time. Defining TG_DISABLE_SIMD selects
+// the scalar kernel.
+//
+// The vector kernels convert lengths to double exactly only for values in [0, 2^50), blocks with
+// other values are evaluated by the scalar kernel, so results always equal the ones of
+// SegmentTrackTest::OverlapParameters::isMatch.
+class OverlapKernel{
+
+public:
+    static const size_t MAX_BLOCK_SIZE = 64;
+
+    // Thresholds selected by an OverlapMatcher
+    enum Criterion{
+        MIN_OVERLAP_LENGTH               = 1,
+        MAX_MISSED_LENGTH                = 2,
+        MAX_UNMARKED_LENGTH              = 4,
+        MIN_OVERLAP_PERCENT_TO_SEGMENT   = 8,
+        MIN_OVERLAP_PERCENT_TO_ASSERTION = 16,
+        MAX_MISSED_PERCENT               = 32,
+        MAX_UNMARKED_PERCENT             = 64
+    };
+
+    // Overlap thresholds, with the disabled ones replaced by values that never reject
+    class Thresholds{
+    public:
+        Thresholds(
+            VideoTime minOverlapLength,
+            VideoTime maxMissedLength,
+            VideoTime maxUnmarkedLength,
+            double minOverlapPercentToSegment,
+            double minOverlapPercentToAssertion,
+            double maxMissedPercent,
+            double maxUnmarkedPercent
+        );
+
+    public:
+        VideoTime minOverlapLength;
+        VideoTime maxMissedLength;
+        VideoTime maxUnmarkedLength;
+        double minOverlapPercentToSegment;
+        double minOverlapPercentToAssertion;
+        double maxMissedPercent;
+        double maxUnmarkedPercent;
+    };
+
+public:
+    static uint64_t matchMask(
+        const Thresholds& thresholds,
+        VideoTime pos,
+        VideoTime length,
+        const VideoTime* segmPositions,
+        const VideoTime* segmLengths,
+        size_t count
+    );
+    static uint64_t matchMaskScalar(
+        const Thresholds& thresholds,
+        VideoTime pos,
+        VideoTime length,
+        const VideoTime* segmPositions,
+        const VideoTime* segmLengths,
+        size_t count
+    );
+#if defined(TG_OVERLAP_KERNEL_AVX2)
+    TG_OVERLAP_TARGET_AVX2 static uint64_t matchMaskAVX2(
+        const Thresholds& thresholds,
+        VideoTime pos,
+        VideoTime length,
+        const VideoTime* segmPositions,
+        const VideoTime* segmLengths,
+        size_t count
+    );
+#endif
+#if defined(TG_OVERLAP_KERNEL_SSE4)
+    TG_OVERLAP_TARGET_SSE4 static uint64_t matchMaskSSE4(
+        const Thresholds& thresholds,
+        VideoTime pos,
+        VideoTime length,
+        const VideoTime* segmPositions,
+        const VideoTime* segmLengths,
+        size_t count
+    );
+#endif
+    static bool hasAVX2();
+    static bool hasSSE4();
+    static bool matches(
+        const Thresholds& thresholds,
+        VideoTime pos,
+        VideoTime length,
+        VideoTime segmPos,
+        VideoTime segmLength
+    );
+
+    static bool overlap(
+        VideoTime pos,
+        VideoTime length,
+        VideoTime segmPos,
+        VideoTime segmLength,
+        VideoTime& overlapLength,
+        VideoTime& missedLength,
+        VideoTime& unmarkedLength
+    );
+
+    static size_t lowestBit(uint64_t mask);
+
+private:
+    static VideoTime inexactBits();
+
+#if defined(TG_OVERLAP_KERNEL_AVX2)
+    TG_OVERLAP_TARGET_AVX2 static __m256d toDouble(__m256i value);
+#endif
+#if defined(TG_OVERLAP_KERNEL_SSE4)
+    TG_OVERLAP_TARGET_SSE4 static __m128d toDouble(__m128i value);
+#endif
+};
+
+inline OverlapKernel::Thresholds::Thresholds(
+        VideoTime pMinOverlapLength,
+        VideoTime pMaxMissedLength,
+        VideoTime pMaxUnmarkedLength,
+        double pMinOverlapPercentToSegment,
+        double pMinOverlapPercentToAssertion,
+        double pMaxMissedPercent,
+        double pMaxUnmarkedPercent)
+    : minOverlapLength(pMinOverlapLength)
+    , maxMissedLength(pMaxMissedLength > 0 ? pMaxMissedLength : std::numeric_limits<VideoTime>::max())
+    , maxUnmarkedLength(pMaxUnmarkedLength > 0 ? pMaxUnmarkedLength : std::numeric_limits<VideoTime>::max())
+    , minOverlapPercentToSegment(
+        pMinOverlapPercentToSegment > 0 ? pMinOverlapPercentToSegment : -std::numeric_limits<double>::infinity())
+    , minOverlapPercentToAssertion(
+        pMinOverlapPercentToAssertion > 0 ? pMinOverlapPercentToAssertion : -std::numeric_limits<double>::infinity())
+    , maxMissedPercent(pMaxMissedPercent > 0 ? pMaxMissedPercent : std::numeric_limits<double>::infinity())
+    , maxUnmarkedPercent(pMaxUnmarkedPercent > 0 ? pMaxUnmarkedPercent : std::numeric_limits<double>::infinity())
+{
+}
+
+// Returns the mask of segments in the block that match the detection, count is at most MAX_BLOCK_SIZE
+inline uint64_t OverlapKernel::matchMask(
+        const Thresholds& thresholds,
+        VideoTime pos,
+        VideoTime length,
+        const VideoTime* segmPositions,
+        const VideoTime* segmLengths,
+        size_t count)
+{
+    if ( count > MAX_BLOCK_SIZE )
+        throw Exception("Overlap kernel block holds more than 64 segments.");
+
+#if defined(TG_OVERLAP_KERNEL_AVX2)
+    if ( hasAVX2() )
+        return matchMaskAVX2(thresholds, pos, length, segmPositions, segmLengths, count);
+#endif
+#if defined(TG_OVERLAP_KERNEL_SSE4)
+    if ( hasSSE4() )
+        return matchMaskSSE4(thresholds, pos, length, segmPositions, segmLengths, count);
+#endif
+    return matchMaskScalar(thresholds, pos, length, segmPositions, segmLengths, count);
+}
+
+#if defined(TG_OVERLAP_KERNEL_AVX2)
+
+TG_OVERLAP_TARGET_AVX2 inline uint64_t OverlapKernel::matchMaskAVX2(
+        const Thresholds& thresholds,
+        VideoTime pos,
+        VideoTime length,
+        const VideoTime* segmPositions,
+        const VideoTime* segmLengths,
+        size_t count)
+{
+    if ( (pos | length) & inexactBits() )
+        return matchMaskScalar(thresholds, pos, length, segmPositions, segmLengths, count);
+
+    const __m256i vPos      = _mm256_set1_epi64x(pos);
+    const __m256i vEnd      = _mm256_set1_epi64x(pos + length);
+    const __m256d vLength   = _mm256_set1_pd(static_cast<double>(length));
+    const __m256i vInexact  = _mm256_set1_epi64x(inexactBits());
+
+    const __m256i vMinOverlapLength  = _mm256_set1_epi64x(thresholds.minOverlapLength);
+    const __m256i vMaxMissedLength   = _mm256_set1_epi64x(thresholds.maxMissedLength);
+    const __m256i vMaxUnmarkedLength = _mm256_set1_epi64x(thresholds.maxUnmarkedLength);
+    const __m256d vMinToSegment      = _mm256_set1_pd(thresholds.minOverlapPercentToSegment);
+    const __m256d vMinToAssertion    = _mm256_set1_pd(thresholds.minOverlapPercentToAssertion);
+    const __m256d vMaxMissed         = _mm256_set1_pd(thresholds.maxMissedPercent);
+    const __m256d vMaxUnmarked       = _mm256_set1_pd(thresholds.maxUnmarkedPercent);
+
+    uint64_t mask = 0;
+    size_t i = 0;
+    for ( ; i + 4 <= count; i += 4 ){
+        __m256i segmPos    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(segmPositions + i));
+        __m256i segmLength = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(segmLengths + i));
+        if ( !_mm256_testz_si256(_mm256_or_si256(segmPos, segmLength), vInexact) )
+            return matchMaskScalar(thresholds, pos, length, segmPositions, segmLengths, count);
+
+        __m256i segmEnd     = _mm256_add_epi64(segmPos, segmLength);
+        __m256i startsAfter = _mm256_cmpgt_epi64(segmPos, vPos);
+        __m256i endsAfter   = _mm256_cmpgt_epi64(segmEnd, vEnd);
+        __m256i overlaps    = _mm256_and_si256(_mm256_cmpgt_epi64(vEnd, segmPos), _mm256_cmpgt_epi64(segmEnd, vPos));
+
+        __m256i overlapLength = _mm256_sub_epi64(
+            _mm256_blendv_epi8(segmEnd, vEnd, endsAfter),
+            _mm256_blendv_epi8(vPos, segmPos, startsAfter)
+        );
+        __m256i missedLength = _mm256_add_epi64(
+            _mm256_and_si256(startsAfter, _mm256_sub_epi64(segmPos, vPos)),
+            _mm256_andnot_si256(endsAfter, _mm256_sub_epi64(vEnd, segmEnd))
+        );
+        __m256i unmarkedLength = _mm256_add_epi64(
+            _mm256_andnot_si256(startsAfter, _mm256_sub_epi64(vPos, segmPos)),
+            _mm256_and_si256(endsAfter, _mm256_sub_epi64(segmEnd, vEnd))
+        );
+
+        __m256i reject = _mm256_or_si256(
+            _mm256_cmpgt_epi64(vMinOverlapLength, overlapLength),
+            _mm256_or_si256(
+                _mm256_cmpgt_epi64(missedLength, vMaxMissedLength),
+                _mm256_cmpgt_epi64(unmarkedLength, vMaxUnmarkedLength)
+            )
+        );
+
+        __m256d overlapD    = toDouble(overlapLength);
+        __m256d segmLengthD = toDouble(segmLength);
+        __m256d rejectD = _mm256_or_pd(
+            _mm256_or_pd(
+                _mm256_cmp_pd(_mm256_div_pd(overlapD, vLength), vMinToAssertion, _CMP_LT_OQ),
+                _mm256_cmp_pd(_mm256_div_pd(overlapD, segmLengthD), vMinToSegment, _CMP_LT_OQ)
+            ),
+            _mm256_or_pd(
+                _mm256_cmp_pd(_mm256_div_pd(toDouble(missedLength), vLength), vMaxMissed, _CMP_GT_OQ),
+                _mm256_cmp_pd(_mm256_div_pd(toDouble(unmarkedLength), segmLengthD), vMaxUnmarked, _CMP_GT_OQ)
+            )
+        );
+
+        __m256i match = _mm256_andnot_si256(_mm256_or_si256(reject, _mm256_castpd_si256(rejectD)), overlaps);
+        mask |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(match))) << i;
+    }
+    for ( ; i < count; ++i )
+        mask |= static_cast<uint64_t>(matches(thresholds, pos, length, segmPositions[i], segmLengths[i])) << i;
+    return mask;
+}
+
+#endif
+
+#if defined(TG_OVERLAP_KERNEL_SSE4)
+
+TG_OVERLAP_TARGET_SSE4 inline uint64_t OverlapKernel::matchMaskSSE4(
+        const Thresholds& thresholds,
+        VideoTime pos,
+        VideoTime length,
+        const VideoTime* segmPositions,
+        const VideoTime* segmLengths,
+        size_t count)
+{
+    if ( (pos | length) & inexactBits() )
+        return matchMaskScalar(thresholds, pos, length, segmPositions, segmLengths, count);
+
+    const __m128i vPos      = _mm_set1_epi64x(pos);
+    const __m128i vEnd      = _mm_set1_epi64x(pos + length);
+    const __m128d vLength   = _mm_set1_pd(static_cast<double>(length));
+    const __m128i vInexact  = _mm_set1_epi64x(inexactBits());
+
+    const __m128i vMinOverlapLength  = _mm_set1_epi64x(thresholds.minOverlapLength);
+    const __m128i vMaxMissedLength   = _mm_set1_epi64x(thresholds.maxMissedLength);
+    const __m128i vMaxUnmarkedLength = _mm_set1_epi64x(thresholds.maxUnmarkedLength);
+    const __m128d vMinToSegment      = _mm_set1_pd(thresholds.minOverlapPercentToSegment);
+    const __m128d vMinToAssertion    = _mm_set1_pd(thresholds.minOverlapPercentToAssertion);
+    const __m128d vMaxMissed         = _mm_set1_pd(thresholds.maxMissedPercent);
+    const __m128d vMaxUnmarked       = _mm_set1_pd(thresholds.maxUnmarkedPercent);
+
+    uint64_t mask = 0;
+    size_t i = 0;
+    for ( ; i + 2 <= count; i += 2 ){
+        __m128i segmPos    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(segmPositions + i));
+        __m128i segmLength = _mm_loadu_si128(reinterpret_cast<const __m128i*>(segmLengths + i));
+        if ( !_mm_testz_si128(_mm_or_si128(segmPos, segmLength), vInexact) )
+            return matchMaskScalar(thresholds, pos, length, segmPositions, segmLengths, count);
+
+        __m128i segmEnd     = _mm_add_epi64(segmPos, segmLength);
+        __m128i startsAfter = _mm_cmpgt_epi64(segmPos, vPos);
+        __m128i endsAfter   = _mm_cmpgt_epi64(segmEnd, vEnd);
+        __m128i overlaps    = _mm_and_si128(_mm_cmpgt_epi64(vEnd, segmPos), _mm_cmpgt_epi64(segmEnd, vPos));
+
+        __m128i overlapLength = _mm_sub_epi64(
+            _mm_blendv_epi8(segmEnd, vEnd, endsAfter),
+            _mm_blendv_epi8(vPos, segmPos, startsAfter)
+        );
+        __m128i missedLength = _mm_add_epi64(
+            _mm_and_si128(startsAfter, _mm_sub_epi64(segmPos, vPos)),
+            _mm_andnot_si128(endsAfter, _mm_sub_epi64(vEnd, segmEnd))
+        );
+        __m128i unmarkedLength = _mm_add_epi64(
+            _mm_andnot_si128(startsAfter, _mm_sub_epi64(vPos, segmPos)),
+            _mm_and_si128(endsAfter, _mm_sub_epi64(segmEnd, vEnd))
+        );
+
+        __m128i reject = _mm_or_si128(
+            _mm_cmpgt_epi64(vMinOverlapLength, overlapLength),
+            _mm_or_si128(
+                _mm_cmpgt_epi64(missedLength, vMaxMissedLength),
+                _mm_cmpgt_epi64(unmarkedLength, vMaxUnmarkedLength)
+            )
+        );
+
+        __m128d overlapD    = toDouble(overlapLength);
+        __m128d segmLengthD = toDouble(segmLength);
+        __m128d rejectD = _mm_or_pd(
+            _mm_or_pd(
+                _mm_cmplt_pd(_mm_div_pd(overlapD, vLength), vMinToAssertion),
+                _mm_cmplt_pd(_mm_div_pd(overlapD, segmLengthD), vMinToSegment)
+            ),
+            _mm_or_pd(
+                _mm_cmpgt_pd(_mm_div_pd(toDouble(missedLength), vLength), vMaxMissed),
+                _mm_cmpgt_pd(_mm_div_pd(toDouble(unmarkedLength), segmLengthD), vMaxUnmarked)
+            )
+        );
+
+        __m128i match = _mm_andnot_si128(_mm_or_si128(reject, _mm_castpd_si128(rejectD)), overlaps);
+        mask |= static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(match))) << i;
+    }
+    for ( ; i < count; ++i )
+        mask |= static_cast<uint64_t>(matches(thresholds, pos, length, segmPositions[i], segmLengths[i])) << i;
+    return mask;
+}
+
+#endif
+
+inline uint64_t OverlapKernel::matchMaskScalar(
+        const Thresholds& thresholds,
+        VideoTime pos,
+        VideoTime length,
+        const VideoTime* segmPositions,
+        const VideoTime* segmLengths,
+        size_t count)
+{
+    uint64_t mask = 0;
+    for ( size_t i = 0; i < count; ++i )
+        mask |= static_cast<uint64_t>(matches(thresholds, pos, length, segmPositions[i], segmLengths[i])) << i;
+    return mask;
+}
+
+// Single segment form of the kernel, the comparisons are combined without short circuits
+inline bool OverlapKernel::matches(
+        const Thresholds& thresholds,
+        VideoTime pos,
+        VideoTime length,
+        VideoTime segmPos,
+        VideoTime segmLength)
+{
+    VideoTime end     = pos + length;
+    VideoTime segmEnd = segmPos + segmLength;
+
+    VideoTime overlapLength  = (segmEnd < end ? segmEnd : end) - (segmPos > pos ? segmPos : pos);
+    VideoTime missedLength   = (segmPos > pos ? segmPos - pos : 0) + (end > segmEnd ? end - segmEnd : 0);
+    VideoTime unmarkedLength = (pos > segmPos ? pos - segmPos : 0) + (segmEnd > end ? segmEnd - end : 0);
+
+    bool reject =
+        (overlapLength < thresholds.minOverlapLength) |
+        (missedLength > thresholds.maxMissedLength) |
+        (unmarkedLength > thresholds.maxUnmarkedLength) |
+        ((double)overlapLength / length < thresholds.minOverlapPercentToAssertion) |
+        ((double)overlapLength / segmLength < thresholds.minOverlapPercentToSegment) |
+        ((double)missedLength / length > thresholds.maxMissedPercent) |
+        ((double)unmarkedLength / segmLength > thresholds.maxUnmarkedPercent);
+
+    return (end > segmPos) & (segmEnd > pos) & !reject;
+}
+
+// Computes the lengths of the detection and segment overlap, the detection outside the segment
+// and the segment outside the detection. Returns false if they don't overlap.
+inline bool OverlapKernel::overlap(
+        VideoTime pos,
+        VideoTime length,
+        VideoTime segmPos,
+        VideoTime segmLength,
+        VideoTime& overlapLength,
+        VideoTime& missedLength,
+        VideoTime& unmarkedLength)
+{
+    overlapLength  = 0;
+    missedLength   = 0;
+    unmarkedLength = 0;
+
+    if ( pos + length > segmPos && segmPos + segmLength > pos ){
+        VideoTime overlapStart = 0;
+        VideoTime overlapEnd   = 0;
+        if ( segmPos > pos ){
+            overlapStart = segmPos;
+            missedLength = segmPos - pos;
+        } else {
+            overlapStart   = pos;
+            unmarkedLength = pos - segmPos;
+        }
+
+        if ( segmPos + segmLength > pos + length ){
+            overlapEnd      = pos + length;
+            unmarkedLength += (segmPos + segmLength) - (pos + length);
+        } else {
+            overlapEnd    = segmPos + segmLength;
+            missedLength += (pos + length) - (segmPos + segmLength);
+        }
+        overlapLength = overlapEnd - overlapStart;
+        return true;
+    }
+    return false;
+}
+
+// Index of the lowest bit set, the mask cannot be 0
+inline size_t OverlapKernel::lowestBit(uint64_t mask){
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_ctzll(mask));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index = 0;
+    _BitScanForward64(&index, mask);
+    return static_cast<size_t>(index);
+#else
+    size_t index = 0;
+    while ( !(mask & 1) ){
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+// Whether the kernels are built and run on this CPU, which is only checked when they are picked
+// at run time
+inline bool OverlapKernel::hasAVX2(){
+#if defined(TG_OVERLAP_KERNEL_DISPATCH)
+    return __builtin_cpu_supports("avx2");
+#elif defined(TG_OVERLAP_KERNEL_AVX2)
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline bool OverlapKernel::hasSSE4(){
+#if defined(TG_OVERLAP_KERNEL_DISPATCH)
+    return __builtin_cpu_supports("sse4.2");
+#elif defined(TG_OVERLAP_KERNEL_SSE4)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Bits that make a time value negative or too large to be converted to double by toDouble()
+inline VideoTime OverlapKernel::inexactBits(){
+    return ~((static_cast<VideoTime>(1) << 50) - 1);
+}
+
+#if defined(TG_OVERLAP_KERNEL_AVX2)
+
+// Converts values in [0, 2^52) by placing them in the mantissa of 2^52
+TG_OVERLAP_TARGET_AVX2 inline __m256d OverlapKernel::toDouble(__m256i value){
+    const __m256d exponent = _mm256_set1_pd(4503599627370496.0);
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(value, _mm256_castpd_si256(exponent))), exponent);
+}
+
+#endif
+
+#if defined(TG_OVERLAP_KERNEL_SSE4)
+
+// Converts values in [0, 2^52) by placing them in the mantissa of 2^52
+TG_OVERLAP_TARGET_SSE4 inline __m128d OverlapKernel::toDouble(__m128i value){
+    const __m128d exponent = _mm_set1_pd(4503599627370496.0);
+    return _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(value, _mm_castpd_si128(exponent))), exponent);
+}
+
+#endif
+
+// Overlap matcher with the thresholds to test selected at compile time by a combination of
+// OverlapKernel::Criterion flags. The thresholds that are not selected compile away, and as in
+// OverlapParameters, a selected threshold left at 0 is not applied. It can be given to
+// SegmentTrackTest::singleOverlap(), multiOverlap(), evaluate(), evaluateSequences() and sweep() in
+// place of the OverlapParameters.
+template<unsigned int criteria> class OverlapMatcher{
+
+public:
+    OverlapMatcher();
+
+    bool isMatch(
+        VideoTime pos,
+        VideoTime length,
+        VideoTime segmPos,
+        VideoTime segmLength,
+        VideoTime& overlapLength,
+        VideoTime& missedLength,
+        VideoTime& unmarkedLength
+    ) const;
+    bool accepts(
+        VideoTime length,
+        VideoTime segmLength,
+        VideoTime overlapLength,
+        VideoTime missedLength,
+        VideoTime unmarkedLength
+    ) const;
+
+public:
+    VideoTime minOverlapLength;
+    VideoTime maxMissedLength;
+    VideoTime maxUnmarkedLength;
+    double minOverlapPercentToSegment;
+    double minOverlapPercentToAssertion;
+    double maxMissedPercent;
+    double maxUnmarkedPercent;
+};
+
+template<unsigned int criteria> inline OverlapMatcher<criteria>::OverlapMatcher()
+    : minOverlapLength(0)
+    , maxMissedLength(0)
+    , maxUnmarkedLength(0)
+    , minOverlapPercentToSegment(0)
+    , minOverlapPercentToAssertion(0)
+    , maxMissedPercent(0)
+    , maxUnmarkedPercent(0)
+{
+}
+
+template<unsigned int criteria> inline bool OverlapMatcher<criteria>::isMatch(
+        VideoTime pos,
+        VideoTime length,
+        VideoTime segmPos,
+        VideoTime segmLength,
+        VideoTime& overlapLength,
+        VideoTime& missedLength,
+        VideoTime& unmarkedLength) const
+{
+    return OverlapKernel::overlap(pos, length, segmPos, segmLength, overlapLength, missedLength, unmarkedLength) &&
+           accepts(length, segmLength, overlapLength, missedLength, unmarkedLength);
+}
+
+template<unsigned int criteria> inline bool OverlapMatcher<criteria>::accepts(
+        VideoTime length,
+        VideoTime segmLength,
+        VideoTime overlapLength,
+        VideoTime missedLength,
+        VideoTime unmarkedLength) const
+{
+    if ( (criteria & OverlapKernel::MIN_OVERLAP_LENGTH) && overlapLength < minOverlapLength )
+        return false;
+    if ( (criteria & OverlapKernel::MIN_OVERLAP_PERCENT_TO_ASSERTION) && minOverlapPercentToAssertion > 0 &&
+         (double)overlapLength / length < minOverlapPercentToAssertion )
+        return false;
+    if ( (criteria & OverlapKernel::MIN_OVERLAP_PERCENT_TO_SEGMENT) && minOverlapPercentToSegment > 0 &&
+         (double)overlapLength / segmLength < minOverlapPercentToSegment )
+        return false;
+
+    if ( (criteria & OverlapKernel::MAX_MISSED_LENGTH) && maxMissedLength > 0 && missedLength > maxMissedLength )
+        return false;
+    if ( (criteria & OverlapKernel::MAX_MISSED_PERCENT) && maxMissedPercent > 0 &&
+         (double)missedLength / length > maxMissedPercent )
+        return false;
+
+    if ( (criteria & OverlapKernel::MAX_UNMARKED_LENGTH) && maxUnmarkedLength > 0 &&
+         unmarkedLength > maxUnmarkedLength )
+        return false;
+    if ( (criteria & OverlapKernel::MAX_UNMARKED_PERCENT) && maxUnmarkedPercent > 0 &&
+         (double)unmarkedLength / segmLength > maxUnmarkedPercent )
+        return false;
+
+    return true;
+}
+
+} // namespace
+
+#endif // TGOVERLAPKERNEL_H
@@ -20,6 +20,7 @@
 #define TGSEGMENT_H
 
 #include "tgglobal.h"
+#include "tgyamlwriter.h"
 
 namespace tg{
 
@@ -45,9 +46,11 @@ public:
     VideoTime position() const;
     VideoTime length() const;
 
+    // not reported to the listener of the track, see SegmentTrack::assignSegmentData()
     void setData(const std::string& data);
 
     void write(cv::FileStorage& fs) const;
+    void write(YamlWriter& writer) const;
     void read(const cv::FileNode& node);
 
 private:
@@ -87,6 +90,14 @@ inline void Segment::write(cv::FileStorage& fs) const{
        << "}";
 }
 
+inline void Segment::write(YamlWriter& writer) const{
+    writer.startMapping();
+    writer.write("Pos", m_position);
+    writer.write("Length", m_length);
+    writer.write("Data", m_data);
+    writer.endMapping();
+}
+
 inline void Segment::read(const cv::FileNode& node){
     m_position = (VideoTime)(double)node["Pos"];
     m_length   = (VideoTime)(double)node["Length"];
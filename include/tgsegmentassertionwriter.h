@@ -77,7 +77,7 @@ inline void SegmentAssertionConsoleWriter::onAssertionInsert(SegmentAssertion *a
          " TYPE[" << typeString << "]";
 
     if ( assertion->hasSegment() )
-        std::cout << " SEGMENT[" << assertion->segment()->position() << ", " << assertion->segment()->length() << "]";
+        std::cout << " SEGMENT[" << assertion->segmentPosition() << ", " << assertion->segmentLength() << "]";
 
     if ( assertion->hasInfo() )
         std::cout << " INFO[" << assertion->info() << "]";
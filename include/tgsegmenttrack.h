@@ -21,7 +21,10 @@
 
 #include "tgglobal.h"
 #include "tgtrack.h"
+#include "tgtrackheader.h"
 #include "tgsegment.h"
+#include "tgintervalindex.h"
+#include "tgsegmenttrackview.h"
 #include <iostream>
 
 namespace tg{
@@ -35,21 +38,35 @@ public:
 public:
     SegmentTrack(TrackHeader* header, VideoTime length)
         : Track(header, length)
+        , m_intervalIndexDirty(1)
     {}
     ~SegmentTrack();
 
     void write(cv::FileStorage& fs, size_t headerIndex) const;
+    void write(YamlWriter& writer, size_t headerIndex) const;
     void read(const cv::FileNode& node);
+    void buildIndex() const;
+    SegmentTrackView view() const;
 
     void clearSegments();
     SegmentIterator insertSegment(Segment* segment);
+    SegmentIterator createSegment(VideoTime position, VideoTime length, const std::string& data = "");
+    SegmentIterator loadSegment(VideoTime position, VideoTime length, const std::string& data = "");
     void removeSegment(SegmentIterator segmIt);
+    // The segment is returned at the same address and the caller becomes its owner, whether it was
+    // given to insertSegment() or allocated by the track.
     Segment* takeSegment(SegmentIterator segmIt);
 
     size_t totalSegments() const;
+    void reserveSegments(size_t count);
+
+    VideoTime segmentPosition(size_t index) const;
+    VideoTime segmentLength(size_t index) const;
 
     void assignSegmentCoords(Segment* segment, VideoTime position, VideoTime length);
     SegmentIterator assignSegmentCoords(SegmentIterator it, VideoTime position, VideoTime length);
+    void assignSegmentData(Segment* segment, const std::string& data);
+    SegmentIterator assignSegmentData(SegmentIterator it, const std::string& data);
 
     SegmentIterator segmentFrom(VideoTime position);
     SegmentConstIterator segmentFrom(VideoTime position) const;
@@ -63,19 +80,55 @@ public:
     SegmentIterator findSegment(Segment* segment);
     SegmentConstIterator findSegment(Segment *segment) const;
 
+    // Interval Queries
+    // ----------------
+
+    SegmentIterator nextSegmentCovering(SegmentIterator from, VideoTime position);
+    SegmentConstIterator nextSegmentCovering(SegmentConstIterator from, VideoTime position) const;
+    SegmentIterator nextSegmentOverlapping(SegmentIterator from, VideoTime position, VideoTime length);
+    SegmentConstIterator nextSegmentOverlapping(SegmentConstIterator from, VideoTime position, VideoTime length) const;
+
+    size_t segmentsCovering(VideoTime position, std::vector<Segment*>& result) const;
+    size_t segmentsOverlapping(VideoTime position, VideoTime length, std::vector<Segment*>& result) const;
+
 private:
     size_t segmentIndexFrom(VideoTime position) const;
     size_t segmentIndexFrom(VideoTime position, VideoTime length) const;
 
+    size_t nextIndexCovering(size_t from, VideoTime position) const;
+    size_t nextIndexOverlapping(size_t from, VideoTime position, VideoTime length) const;
+    const IntervalIndex& intervalIndex() const;
+
+    SegmentIterator insertSorted(Segment* segment);
+    SegmentIterator insertSegmentAt(size_t index, Segment* segment);
+    void eraseSegmentAt(size_t index);
+
+    void releaseSegment(Segment* segment);
+    void releaseSegments();
+    TrackListener* listener() const;
+
     // prevent copy
     SegmentTrack(const SegmentTrack& other);
     SegmentTrack& operator = (const SegmentTrack& other);
 
-    std::vector<Segment*> m_segments;
+    // the segments own their coordinates, m_positions and m_lengths are a cache of the keys in the
+    // order of m_segments, so searches and the interval index read contiguous memory instead of
+    // dereferencing segments. Coordinates are only edited through the track, which keeps both equal,
+    // and inserting or erasing a segment shifts all three vectors.
+
+    std::vector<Segment*>  m_segments;
+    std::vector<VideoTime> m_positions;
+    std::vector<VideoTime> m_lengths;
+
+    // built on the first query, then kept up to date by the edits until it runs out of leaves. The
+    // flag is read and cleared atomically by const access, see intervalIndex()
+    mutable IntervalIndex m_intervalIndex;
+    mutable int           m_intervalIndexDirty;
+    mutable cv::Mutex     m_intervalIndexMutex;
 };
 
 inline SegmentTrack::~SegmentTrack(){
-    clearSegments();
+    releaseSegments();
 }
 
 inline void SegmentTrack::write(cv::FileStorage &fs, size_t headerIndex) const{
@@ -89,54 +142,109 @@ inline void SegmentTrack::write(cv::FileStorage &fs, size_t headerIndex) const{
     fs << "}";
 }
 
+inline void SegmentTrack::write(YamlWriter &writer, size_t headerIndex) const{
+    writer.startMapping();
+    writer.write("Header", static_cast<VideoTime>(headerIndex));
+    writer.startSequence("Children");
+    for ( SegmentConstIterator it = begin(); it != end(); ++it )
+        (*it)->write(writer);
+    writer.endSequence();
+    writer.endMapping();
+}
+
 inline void SegmentTrack::read(const cv::FileNode &node){
     cv::FileNode seqNode = node["Children"];
     if (seqNode.type() != cv::FileNode::SEQ)
         throw Exception("\'Segment.Track.Children\' is not iterable.");
 
-    clearSegments();
+    // reading is not an edit, so the listener is not notified
+    releaseSegments();
+    reserveSegments(seqNode.size());
 
     for (cv::FileNodeIterator it = seqNode.begin(); it != seqNode.end(); ++it){
-        Segment* segment = new Segment;
-        *it >> *segment;
-        insertSegment(segment);
+        Segment segment;
+        *it >> segment;
+        loadSegment(segment.position(), segment.length(), segment.data());
     }
 }
 
 inline void SegmentTrack::clearSegments(){
-    for ( SegmentIterator it = begin(); it != end(); ++it )
-        delete *it;
-    m_segments.clear();
+    if ( listener() )
+        listener()->segmentsCleared(this);
+    releaseSegments();
 }
 
 inline SegmentTrack::SegmentIterator SegmentTrack::insertSegment(Segment *segment){
+    SegmentIterator it = insertSorted(segment);
+    if ( listener() )
+        listener()->segmentInserted(this, it - m_segments.begin(), segment);
+    return it;
+}
+
+inline SegmentTrack::SegmentIterator SegmentTrack::insertSorted(Segment *segment){
     if ( segment->position() + segment->length() > length() )
         throw tg::Exception("Cannot add segment longer than track.");
 
-    SegmentIterator it = segmentFrom(segment->position());
-    while ( it != end() ){
-        Segment* itseg = *it;
-        if ( itseg->position() > segment->position() ){
-            return m_segments.insert(it, segment);
-        } else if ( itseg->position() == segment->position() && itseg->length() >= segment->length() ){
-            return m_segments.insert(it, segment);
-        }
-        ++it;
+    // segments read in order are appended without searching
+
+    size_t total = m_segments.size();
+    if ( total == 0 ||
+         m_positions[total - 1] < segment->position() ||
+         (m_positions[total - 1] == segment->position() && m_lengths[total - 1] < segment->length())
+    ){
+        return insertSegmentAt(total, segment);
+    }
+
+    size_t index = segmentIndexFrom(segment->position());
+    while ( index < total ){
+        if ( m_positions[index] > segment->position() )
+            break;
+        if ( m_positions[index] == segment->position() && m_lengths[index] >= segment->length() )
+            break;
+        ++index;
     }
-    return m_segments.insert(m_segments.end(), segment);
+    return insertSegmentAt(index, segment);
+}
+
+inline SegmentTrack::SegmentIterator SegmentTrack::createSegment(
+        VideoTime position,
+        VideoTime length,
+        const std::string &data)
+{
+    SegmentIterator it = loadSegment(position, length, data);
+    if ( listener() )
+        listener()->segmentInserted(this, it - m_segments.begin(), *it);
+    return it;
+}
+
+// Adds a segment read from a file. Reading is not an edit, so the header's listener is not notified.
+inline SegmentTrack::SegmentIterator SegmentTrack::loadSegment(
+        VideoTime position,
+        VideoTime length,
+        const std::string &data)
+{
+    if ( position + length > this->length() )
+        throw tg::Exception("Cannot add segment longer than track.");
+
+    return insertSorted(new Segment(position, length, data));
 }
 
 inline void SegmentTrack::removeSegment(SegmentTrack::SegmentIterator it){
     if ( it != end() ){
-        delete *it;
-        m_segments.erase(it);
+        if ( listener() )
+            listener()->segmentRemoved(this, it - m_segments.begin());
+        Segment* segm = *it;
+        eraseSegmentAt(it - m_segments.begin());
+        releaseSegment(segm);
     }
 }
 
 inline Segment *SegmentTrack::takeSegment(SegmentTrack::SegmentIterator segmIt){
     if ( segmIt != end() ){
+        if ( listener() )
+            listener()->segmentRemoved(this, segmIt - m_segments.begin());
         Segment* segm = *segmIt;
-        m_segments.erase(segmIt);
+        eraseSegmentAt(segmIt - m_segments.begin());
         return segm;
     }
     return 0;
@@ -146,6 +254,20 @@ inline size_t SegmentTrack::totalSegments() const{
     return m_segments.size();
 }
 
+inline void SegmentTrack::reserveSegments(size_t count){
+    m_segments.reserve(count);
+    m_positions.reserve(count);
+    m_lengths.reserve(count);
+}
+
+inline VideoTime SegmentTrack::segmentPosition(size_t index) const{
+    return m_positions[index];
+}
+
+inline VideoTime SegmentTrack::segmentLength(size_t index) const{
+    return m_lengths[index];
+}
+
 inline void SegmentTrack::assignSegmentCoords(Segment *segment, VideoTime position, VideoTime length){
     assignSegmentCoords(findSegment(segment), position, length);
 }
@@ -161,34 +283,58 @@ inline SegmentTrack::SegmentIterator SegmentTrack::assignSegmentCoords(
     if ( segm->position() == position && segm->length() == length )
         return it;
 
-    segm->m_position = position;
-    segm->m_length   = length;
+    size_t index = it - m_segments.begin();
+    segm->m_position   = position;
+    segm->m_length     = length;
+    m_positions[index] = position;
+    m_lengths[index]   = length;
+    if ( !m_intervalIndexDirty )
+        m_intervalIndex.assignInterval(index, position, length);
 
     // if position or length different, we need to see if the inserted position is the same
 
     bool reposition = false;
-    if ( it != begin() ){
-        SegmentTrack::SegmentIterator prevIt = it - 1;
-        Segment* prevSegm = *prevIt;
-        if ( prevSegm->position() > segm->position() )
+    if ( index > 0 ){
+        if ( m_positions[index - 1] > position )
             reposition = true;
-        else if ( prevSegm->position() == segm->position() && prevSegm->length() > segm->length() )
+        else if ( m_positions[index - 1] == position && m_lengths[index - 1] > length )
             reposition = true;
     }
-    SegmentTrack::SegmentIterator nextIt = it + 1;
-    if ( nextIt != end() ){
-        Segment* nextSegm = *nextIt;
-        if ( nextSegm->position() < segm->position() )
+    if ( index + 1 < m_segments.size() ){
+        if ( m_positions[index + 1] < position )
             reposition = true;
-        else if ( nextSegm->position() == segm->position() && nextSegm->length() < segm->length() )
+        else if ( m_positions[index + 1] == position && m_lengths[index + 1] < length )
             reposition = true;
     }
 
     if ( reposition ){
-        m_segments.erase(it);
-        return insertSegment(segm);
+        eraseSegmentAt(index);
+        it = insertSorted(segm);
     }
 
+    if ( listener() )
+        listener()->segmentCoordsAssigned(this, index, position, length);
+    return it;
+}
+
+inline void SegmentTrack::assignSegmentData(Segment *segment, const std::string &data){
+    assignSegmentData(findSegment(segment), data);
+}
+
+// Unlike Segment::setData(), the edit is reported to the listener of the track
+inline SegmentTrack::SegmentIterator SegmentTrack::assignSegmentData(
+        SegmentTrack::SegmentIterator it,
+        const std::string &data)
+{
+    if ( it == end() )
+        return end();
+    Segment* segm = *it;
+    if ( segm->data() == data )
+        return it;
+
+    segm->m_data = data;
+    if ( listener() )
+        listener()->segmentDataAssigned(this, it - m_segments.begin(), data);
     return it;
 }
 
@@ -225,63 +371,186 @@ inline SegmentTrack::SegmentConstIterator SegmentTrack::end() const{
 }
 
 inline SegmentTrack::SegmentIterator SegmentTrack::findSegment(Segment *segment){
-    SegmentTrack::SegmentIterator ict = segmentFrom(segment->position(), segment->length());
-   while ( ict != end() ){
-       if ( *ict == segment )
-           return ict;
-       if ( (*ict)->position() != segment->position() || (*ict)->length() != segment->length() )
-           return end();
-       ++ict;
-   }
-   return ict;
+    size_t index = segmentIndexFrom(segment->position(), segment->length());
+    while ( index < m_segments.size() ){
+        if ( m_segments[index] == segment )
+            return m_segments.begin() + index;
+        if ( m_positions[index] != segment->position() || m_lengths[index] != segment->length() )
+            return end();
+        ++index;
+    }
+    return end();
 }
 
 inline SegmentTrack::SegmentConstIterator SegmentTrack::findSegment(Segment *segment) const{
-    SegmentTrack::SegmentConstIterator ict = segmentFrom(segment->position(), segment->length());
-    while ( ict != end() ){
-        if ( *ict == segment )
-            return ict;
-        if ( (*ict)->position() != segment->position() || (*ict)->length() != segment->length() )
+    size_t index = segmentIndexFrom(segment->position(), segment->length());
+    while ( index < m_segments.size() ){
+        if ( m_segments[index] == segment )
+            return m_segments.begin() + index;
+        if ( m_positions[index] != segment->position() || m_lengths[index] != segment->length() )
             return end();
-        ++ict;
+        ++index;
     }
-    return ict;
+    return end();
 }
 
-inline size_t SegmentTrack::segmentIndexFrom(VideoTime position) const{
-    if ( m_segments.size() == 0 )
-        return 0;
-    if ( m_segments.back()->position() < position )
-        return m_segments.size();
+inline SegmentTrack::SegmentIterator SegmentTrack::nextSegmentCovering(SegmentIterator from, VideoTime position){
+    return m_segments.begin() + nextIndexCovering(from - m_segments.begin(), position);
+}
 
-    int first  = 0, last = (int)(m_segments.size()) - 1, middle = (first + last) / 2;
+inline SegmentTrack::SegmentConstIterator SegmentTrack::nextSegmentCovering(
+        SegmentConstIterator from,
+        VideoTime position) const
+{
+    return m_segments.begin() + nextIndexCovering(from - m_segments.begin(), position);
+}
 
-    while( first <= last ){
-        if ( m_segments[middle]->position() < position ){
-            first = middle + 1;
-        } else {
-            last  = middle - 1;
-        }
+inline SegmentTrack::SegmentIterator SegmentTrack::nextSegmentOverlapping(
+        SegmentIterator from,
+        VideoTime position,
+        VideoTime length)
+{
+    return m_segments.begin() + nextIndexOverlapping(from - m_segments.begin(), position, length);
+}
 
-        middle = (first + last) / 2;
+inline SegmentTrack::SegmentConstIterator SegmentTrack::nextSegmentOverlapping(
+        SegmentConstIterator from,
+        VideoTime position,
+        VideoTime length) const
+{
+    return m_segments.begin() + nextIndexOverlapping(from - m_segments.begin(), position, length);
+}
+
+inline size_t SegmentTrack::segmentsCovering(VideoTime position, std::vector<Segment*>& result) const{
+    size_t total = 0;
+    size_t index = nextIndexCovering(0, position);
+    while ( index < m_segments.size() ){
+        result.push_back(m_segments[index]);
+        ++total;
+        index = nextIndexCovering(index + 1, position);
     }
+    return total;
+}
 
-    if ( m_segments[middle]->position() < position )
-        return middle + 1;
-    else
-        return middle;
+inline size_t SegmentTrack::segmentsOverlapping(
+        VideoTime position,
+        VideoTime length,
+        std::vector<Segment*>& result) const
+{
+    size_t total = 0;
+    size_t index = nextIndexOverlapping(0, position, length);
+    while ( index < m_segments.size() ){
+        result.push_back(m_segments[index]);
+        ++total;
+        index = nextIndexOverlapping(index + 1, position, length);
+    }
+    return total;
+}
+
+inline size_t SegmentTrack::segmentIndexFrom(VideoTime position) const{
+    if ( m_positions.size() == 0 )
+        return 0;
+    return SegmentTrackView::lowerBound(&m_positions[0], m_positions.size(), position);
 }
 
 inline size_t SegmentTrack::segmentIndexFrom(VideoTime position, VideoTime length) const{
     size_t index = segmentIndexFrom(position);
-    while ( index < m_segments.size() ){
-        if ( m_segments[index]->position() != position )
-            return m_segments.size();
-        if ( m_segments[index]->length() == length )
+    while ( index < m_positions.size() ){
+        if ( m_positions[index] != position )
+            return m_positions.size();
+        if ( m_lengths[index] == length )
             return index;
         ++index;
     }
-    return m_segments.size();
+    return m_positions.size();
+}
+
+inline size_t SegmentTrack::nextIndexCovering(size_t from, VideoTime position) const{
+    size_t to    = segmentIndexFrom(position + 1);
+    size_t index = intervalIndex().firstEndingAfter(from, to, position);
+    return index < to ? index : m_segments.size();
+}
+
+// Segments starting before position + length and ending after position, as in the overlap test
+// of SegmentTrackTest, so an empty range still gives the segments strictly containing position
+inline size_t SegmentTrack::nextIndexOverlapping(size_t from, VideoTime position, VideoTime length) const{
+    size_t to    = segmentIndexFrom(position + length);
+    size_t index = intervalIndex().firstEndingAfter(from, to, position);
+    return index < to ? index : m_segments.size();
+}
+
+inline void SegmentTrack::buildIndex() const{
+    intervalIndex();
+}
+
+// The view stays valid until the track is modified
+inline SegmentTrackView SegmentTrack::view() const{
+    const IntervalIndex& index = intervalIndex();
+    if ( m_segments.empty() )
+        return SegmentTrackView(length(), 0, 0, 0, 0, 0);
+
+    SegmentTrackView trackView(
+        length(), m_segments.size(), &m_positions[0], &m_lengths[0], &index.maxEnds()[0], index.leaves()
+    );
+    trackView.setSegments(&m_segments[0]);
+    return trackView;
+}
+
+// Const queries may run from several threads, so the flag is read with an atomic add, which is a
+// full barrier, and the lock is only taken to build the index, the same as Sequence::load(). Once
+// built, the index is not modified until the track is.
+inline const IntervalIndex &SegmentTrack::intervalIndex() const{
+    if ( CV_XADD(&m_intervalIndexDirty, 0) == 0 )
+        return m_intervalIndex;
+
+    cv::AutoLock lock(m_intervalIndexMutex);
+    if ( CV_XADD(&m_intervalIndexDirty, 0) == 0 )
+        return m_intervalIndex;
+
+    // leave room for at least one insertion, so growing the track doubles the index
+    m_intervalIndex.resize(m_positions.size(), m_positions.size() + 1);
+    for ( size_t i = 0; i < m_positions.size(); ++i )
+        m_intervalIndex.setInterval(i, m_positions[i], m_lengths[i]);
+    m_intervalIndex.update();
+
+    CV_XADD(&m_intervalIndexDirty, -1);
+    return m_intervalIndex;
+}
+
+inline SegmentTrack::SegmentIterator SegmentTrack::insertSegmentAt(size_t index, Segment *segment){
+    m_positions.insert(m_positions.begin() + index, segment->position());
+    m_lengths.insert(m_lengths.begin() + index, segment->length());
+    if ( !m_intervalIndexDirty && m_intervalIndex.size() < m_intervalIndex.capacity() )
+        m_intervalIndex.insertInterval(index, segment->position(), segment->length());
+    else
+        m_intervalIndexDirty = 1;
+    return m_segments.insert(m_segments.begin() + index, segment);
+}
+
+inline void SegmentTrack::eraseSegmentAt(size_t index){
+    m_segments.erase(m_segments.begin() + index);
+    m_positions.erase(m_positions.begin() + index);
+    m_lengths.erase(m_lengths.begin() + index);
+    if ( !m_intervalIndexDirty )
+        m_intervalIndex.eraseInterval(index);
+}
+
+inline void SegmentTrack::releaseSegment(Segment *segment){
+    delete segment;
+}
+
+inline void SegmentTrack::releaseSegments(){
+    for ( SegmentIterator it = begin(); it != end(); ++it )
+        delete *it;
+    m_segments.clear();
+    m_positions.clear();
+    m_lengths.clear();
+
+    m_intervalIndexDirty = 1;
+}
+
+inline TrackListener *SegmentTrack::listener() const{
+    return header() ? header()->listener() : 0;
 }
 
 } // namespace
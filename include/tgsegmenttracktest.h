@@ -21,12 +21,24 @@
 
 #include "tgglobal.h"
 #include "tgtracktest.h"
+#include "tgdatafileview.h"
+#include "tgsegmenttrackview.h"
+#include "tgoverlapkernel.h"
+#include "tgframebitmap.h"
+#include "tgobjectpool.h"
+#include "tgyamlwriter.h"
+#include <algorithm>
+#include <map>
+#include <fstream>
 
 namespace tg{
 
 class SegmentAssertion{
 
 public:
+    static const int TOTAL_RESULT_TYPES    = 3;
+    static const int TOTAL_ASSERTION_TYPES = 5;
+
     enum ResultType{
         MATCH,
         UNMARKED,
@@ -49,15 +61,20 @@ public:
         const std::string& info = "",
         const std::string& file = "",
         int lineNumber = 0,
-        Segment* segment = 0
+        const Segment* segment = 0
     ) : m_position(position)
       , m_length(length)
       , m_result(resultType)
       , m_type(assertionType)
-      , m_segment(segment)
       , m_info(info)
       , m_file(file)
       , m_lineNumber(lineNumber)
+      , m_segment(segment)
+      , m_hasSegment(segment != 0)
+      , m_segmentIndex(0)
+      , m_segmentPosition(segment ? segment->position() : 0)
+      , m_segmentLength(segment ? segment->length() : 0)
+      , m_isFirstMatch(false)
     {}
     ~SegmentAssertion(){}
 
@@ -73,11 +90,25 @@ public:
     const std::string& file() const{ return m_file; }
     int lineNumber() const{ return m_lineNumber; }
 
+    // the segment object is 0 when the ground truth is a DataFileView, use the segment
+    // position and length instead
     const Segment* segment() const{ return m_segment; }
-    bool hasSegment() const{ return m_segment != 0; }
+    bool hasSegment() const{ return m_hasSegment; }
+    size_t segmentIndex() const{ return m_segmentIndex; }
+    VideoTime segmentPosition() const{ return m_segmentPosition; }
+    VideoTime segmentLength() const{ return m_segmentLength; }
+
+    // true for the match that marked its segment, later matches of the same segment are false
+    bool isFirstMatch() const{ return m_isFirstMatch; }
 
+    static const char* typeName(AssertionType type);
+    static const char* resultName(ResultType result);
 
 private:
+    friend class SegmentTrackTest;
+
+    void setSegment(const SegmentTrackView& track, size_t index);
+
     VideoTime     m_position;
     VideoTime     m_length;
     ResultType    m_result;
@@ -87,10 +118,44 @@ private:
     std::string   m_file;
     int           m_lineNumber;
 
-    Segment*      m_segment;
+    const Segment* m_segment;
+    bool           m_hasSegment;
+    size_t         m_segmentIndex;
+    VideoTime      m_segmentPosition;
+    VideoTime      m_segmentLength;
+    bool           m_isFirstMatch;
 
 };
 
+inline void SegmentAssertion::setSegment(const SegmentTrackView& track, size_t index){
+    m_segment         = track.segment(index);
+    m_hasSegment      = true;
+    m_segmentIndex    = index;
+    m_segmentPosition = track.segmentPosition(index);
+    m_segmentLength   = track.segmentLength(index);
+}
+
+// Names used for the assertion type and result in result files
+inline const char* SegmentAssertion::typeName(AssertionType type){
+    switch( type ){
+    case SINGLE_STAMP:     return "SingleStamp";
+    case MULTI_STAMP:      return "MultiStamp";
+    case SINGLE_OVERLAP:   return "SingleOverlap";
+    case MULTI_OVERLAP:    return "MultiOverlap";
+    case UNMARKED_SEGMENT: return "Unmarked";
+    }
+    return "";
+}
+
+inline const char* SegmentAssertion::resultName(ResultType result){
+    switch( result ){
+    case MATCH:    return "Match";
+    case MISS:     return "Miss";
+    case UNMARKED: return "Unmarked";
+    }
+    return "";
+}
+
 class SegmentAssertionSubscriber{
 
 public:
@@ -101,6 +166,256 @@ public:
     virtual void onAssertionInsert(SegmentAssertion*) = 0;
 };
 
+// Number of assertions for each result and assertion type
+class SegmentAssertionCounts{
+
+public:
+    SegmentAssertionCounts();
+
+    void add(const SegmentAssertion* assertion);
+    void add(SegmentAssertion::ResultType result, SegmentAssertion::AssertionType type, size_t total = 1);
+    void add(const SegmentAssertionCounts& other);
+    void clear();
+
+    size_t count(SegmentAssertion::ResultType result) const;
+    size_t count(SegmentAssertion::ResultType result, SegmentAssertion::AssertionType type) const;
+    size_t total() const;
+
+private:
+    size_t m_counts[SegmentAssertion::TOTAL_RESULT_TYPES][SegmentAssertion::TOTAL_ASSERTION_TYPES];
+};
+
+inline SegmentAssertionCounts::SegmentAssertionCounts(){
+    clear();
+}
+
+inline void SegmentAssertionCounts::add(const SegmentAssertion* assertion){
+    ++m_counts[assertion->result()][assertion->type()];
+}
+
+inline void SegmentAssertionCounts::add(
+        SegmentAssertion::ResultType result,
+        SegmentAssertion::AssertionType type,
+        size_t total)
+{
+    m_counts[result][type] += total;
+}
+
+inline void SegmentAssertionCounts::add(const SegmentAssertionCounts& other){
+    for ( int result = 0; result < SegmentAssertion::TOTAL_RESULT_TYPES; ++result )
+        for ( int type = 0; type < SegmentAssertion::TOTAL_ASSERTION_TYPES; ++type )
+            m_counts[result][type] += other.m_counts[result][type];
+}
+
+inline void SegmentAssertionCounts::clear(){
+    for ( int result = 0; result < SegmentAssertion::TOTAL_RESULT_TYPES; ++result )
+        for ( int type = 0; type < SegmentAssertion::TOTAL_ASSERTION_TYPES; ++type )
+            m_counts[result][type] = 0;
+}
+
+inline size_t SegmentAssertionCounts::count(SegmentAssertion::ResultType result) const{
+    size_t total = 0;
+    for ( int type = 0; type < SegmentAssertion::TOTAL_ASSERTION_TYPES; ++type )
+        total += m_counts[result][type];
+    return total;
+}
+
+inline size_t SegmentAssertionCounts::count(
+        SegmentAssertion::ResultType result,
+        SegmentAssertion::AssertionType type) const
+{
+    return m_counts[result][type];
+}
+
+inline size_t SegmentAssertionCounts::total() const{
+    size_t total = 0;
+    for ( int result = 0; result < SegmentAssertion::TOTAL_RESULT_TYPES; ++result )
+        total += count(static_cast<SegmentAssertion::ResultType>(result));
+    return total;
+}
+
+// Precision, recall, F1 score and miss rate of the detections, updated one assertion at a time.
+// At event level a matched detection is a true positive and a missed detection a false positive
+// for precision, while recall and the miss rate count matched segments against unmarked ones, so
+// several detections on one segment match it once. At frame level the frames covered by both
+// detections and segments are true positives, the other frames of detections false positives and
+// the other frames of segments false negatives, each frame counted once. add() only counts
+// events, SegmentTrackTest adds the frames with addFrames(). Rates are 0 when there is nothing to
+// measure.
+class SegmentMetrics{
+
+public:
+    SegmentMetrics();
+
+    void add(const SegmentAssertion* assertion);
+    void add(const SegmentMetrics& other);
+    void addFrames(VideoTime truePositiveFrames, VideoTime falsePositiveFrames, VideoTime falseNegativeFrames);
+    void setFrames(VideoTime truePositiveFrames, VideoTime falsePositiveFrames, VideoTime falseNegativeFrames);
+    void clear();
+
+    size_t truePositives() const;
+    size_t matchedSegments() const;
+    size_t falsePositives() const;
+    size_t falseNegatives() const;
+
+    VideoTime truePositiveFrames() const;
+    VideoTime falsePositiveFrames() const;
+    VideoTime falseNegativeFrames() const;
+
+    double precision() const;
+    double recall() const;
+    double f1Score() const;
+    double missRate() const;
+
+    double framePrecision() const;
+    double frameRecall() const;
+    double frameF1Score() const;
+    double frameMissRate() const;
+
+private:
+    static double ratio(double value, double total);
+
+    size_t    m_truePositives;
+    size_t    m_matchedSegments;
+    size_t    m_falsePositives;
+    size_t    m_falseNegatives;
+    VideoTime m_truePositiveFrames;
+    VideoTime m_falsePositiveFrames;
+    VideoTime m_falseNegativeFrames;
+};
+
+inline SegmentMetrics::SegmentMetrics(){
+    clear();
+}
+
+inline void SegmentMetrics::add(const SegmentAssertion* assertion){
+    switch( assertion->result() ){
+    case SegmentAssertion::MATCH:
+        ++m_truePositives;
+        if ( assertion->isFirstMatch() )
+            ++m_matchedSegments;
+        break;
+    case SegmentAssertion::MISS:
+        ++m_falsePositives;
+        break;
+    case SegmentAssertion::UNMARKED:
+        ++m_falseNegatives;
+        break;
+    }
+}
+
+inline void SegmentMetrics::add(const SegmentMetrics& other){
+    m_truePositives       += other.m_truePositives;
+    m_matchedSegments     += other.m_matchedSegments;
+    m_falsePositives      += other.m_falsePositives;
+    m_falseNegatives      += other.m_falseNegatives;
+    m_truePositiveFrames  += other.m_truePositiveFrames;
+    m_falsePositiveFrames += other.m_falsePositiveFrames;
+    m_falseNegativeFrames += other.m_falseNegativeFrames;
+}
+
+// The false negatives can decrease, as frames of segments counted before are covered
+inline void SegmentMetrics::addFrames(
+        VideoTime truePositiveFrames,
+        VideoTime falsePositiveFrames,
+        VideoTime falseNegativeFrames)
+{
+    m_truePositiveFrames  += truePositiveFrames;
+    m_falsePositiveFrames += falsePositiveFrames;
+    m_falseNegativeFrames += falseNegativeFrames;
+}
+
+inline void SegmentMetrics::setFrames(
+        VideoTime truePositiveFrames,
+        VideoTime falsePositiveFrames,
+        VideoTime falseNegativeFrames)
+{
+    m_truePositiveFrames  = truePositiveFrames;
+    m_falsePositiveFrames = falsePositiveFrames;
+    m_falseNegativeFrames = falseNegativeFrames;
+}
+
+inline void SegmentMetrics::clear(){
+    m_truePositives       = 0;
+    m_matchedSegments     = 0;
+    m_falsePositives      = 0;
+    m_falseNegatives      = 0;
+    m_truePositiveFrames  = 0;
+    m_falsePositiveFrames = 0;
+    m_falseNegativeFrames = 0;
+}
+
+inline size_t SegmentMetrics::truePositives() const{
+    return m_truePositives;
+}
+
+inline size_t SegmentMetrics::matchedSegments() const{
+    return m_matchedSegments;
+}
+
+inline size_t SegmentMetrics::falsePositives() const{
+    return m_falsePositives;
+}
+
+inline size_t SegmentMetrics::falseNegatives() const{
+    return m_falseNegatives;
+}
+
+inline VideoTime SegmentMetrics::truePositiveFrames() const{
+    return m_truePositiveFrames;
+}
+
+inline VideoTime SegmentMetrics::falsePositiveFrames() const{
+    return m_falsePositiveFrames;
+}
+
+inline VideoTime SegmentMetrics::falseNegativeFrames() const{
+    return m_falseNegativeFrames;
+}
+
+inline double SegmentMetrics::precision() const{
+    return ratio((double)m_truePositives, (double)m_truePositives + m_falsePositives);
+}
+
+inline double SegmentMetrics::recall() const{
+    return ratio((double)m_matchedSegments, (double)m_matchedSegments + m_falseNegatives);
+}
+
+inline double SegmentMetrics::f1Score() const{
+    double precisionValue = precision();
+    double recallValue    = recall();
+    return ratio(2.0 * precisionValue * recallValue, precisionValue + recallValue);
+}
+
+inline double SegmentMetrics::missRate() const{
+    return ratio((double)m_falseNegatives, (double)m_matchedSegments + m_falseNegatives);
+}
+
+inline double SegmentMetrics::framePrecision() const{
+    return ratio((double)m_truePositiveFrames, (double)m_truePositiveFrames + m_falsePositiveFrames);
+}
+
+inline double SegmentMetrics::frameRecall() const{
+    return ratio((double)m_truePositiveFrames, (double)m_truePositiveFrames + m_falseNegativeFrames);
+}
+
+inline double SegmentMetrics::frameF1Score() const{
+    return ratio(
+        2.0 * m_truePositiveFrames,
+        2.0 * m_truePositiveFrames + m_falsePositiveFrames + m_falseNegativeFrames
+    );
+}
+
+inline double SegmentMetrics::frameMissRate() const{
+    return ratio((double)m_falseNegativeFrames, (double)m_truePositiveFrames + m_falseNegativeFrames);
+}
+
+inline double SegmentMetrics::ratio(double value, double total){
+    return total > 0 ? value / total : 0;
+}
+
+// Tests detections against the segments of a track, given either by a DataFile and one of its
+// track headers or by a DataFileView and a track index.
 class SegmentTrackTest : public TrackTest{
 
 public:
@@ -121,6 +436,31 @@ public:
             VideoTime& missedLength,
             VideoTime& unmarkedLength
         ) const;
+        bool accepts(
+            VideoTime length,
+            VideoTime segmLength,
+            VideoTime overlapLength,
+            VideoTime missedLength,
+            VideoTime unmarkedLength
+        ) const;
+        uint64_t matchMask(
+            VideoTime pos,
+            VideoTime length,
+            const VideoTime* segmPositions,
+            const VideoTime* segmLengths,
+            size_t count
+        ) const;
+        OverlapKernel::Thresholds thresholds() const;
+
+        static bool overlap(
+            VideoTime pos,
+            VideoTime length,
+            VideoTime segmPos,
+            VideoTime segmLength,
+            VideoTime& overlapLength,
+            VideoTime& missedLength,
+            VideoTime& unmarkedLength
+        );
 
     public:
         VideoTime minOverlapLength;
@@ -132,11 +472,35 @@ public:
         double maxUnmarkedPercent;
     };
 
+    class Detection{
+    public:
+        Detection(
+            SegmentAssertion::AssertionType type,
+            VideoTime position,
+            VideoTime length = 1,
+            const OverlapParameters& overlapParams = OverlapParameters(),
+            const std::string& info = "",
+            const std::string& file = "",
+            int lineNumber = 0
+        );
+
+    public:
+        SegmentAssertion::AssertionType type;
+        VideoTime         position;
+        VideoTime         length;
+        OverlapParameters overlapParams;
+        std::string       info;
+        std::string       file;
+        int               lineNumber;
+    };
+
 public:
     SegmentTrackTest(const DataFile* data, const TrackHeader* track);
+    SegmentTrackTest(const DataFileView* view, size_t trackIndex);
     ~SegmentTrackTest();
 
     void advanceCursorSequence(DataFile::SequenceIterator itvit, const std::string &file = "", int lineNumber = 0);
+    void advanceCursorSequence(size_t sequenceIndex, const std::string &file = "", int lineNumber = 0);
     void advanceCursorPosition(VideoTime position, const std::string& file = "", int lineNumber = 0);
 
     void singleStamp(
@@ -151,27 +515,66 @@ public:
         const std::string& file = "",
         int lineNumber = 0
     );
-    void singleOverlap(
+    template<typename Matcher> void singleOverlap(
         VideoTime position,
         VideoTime length,
-        const OverlapParameters& overlapParams,
+        const Matcher& overlapParams,
         const std::string& info = "",
         const std::string& file = "",
         int lineNumber = 0
     );
-    void multiOverlap(
+    template<typename Matcher> void multiOverlap(
         VideoTime position,
         VideoTime length,
-        const OverlapParameters& overlapParams,
+        const Matcher& overlapParams,
         const std::string& info = "",
         const std::string& file = "",
         int lineNumber = 0
     );
 
+    void evaluate(const std::vector<Detection>& detections);
+    template<unsigned int criteria> void evaluate(
+        const std::vector<Detection>& detections,
+        const OverlapMatcher<criteria>& overlapMatcher
+    );
+    void evaluateSequences(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const std::string& file = "",
+        int lineNumber = 0
+    );
+    template<unsigned int criteria> void evaluateSequences(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const OverlapMatcher<criteria>& overlapMatcher,
+        const std::string& file = "",
+        int lineNumber = 0
+    );
+
+    void sweep(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const std::vector<OverlapParameters>& overlapParams,
+        std::vector<SegmentAssertionCounts>& counts
+    ) const;
+    template<unsigned int criteria> void sweep(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const std::vector<OverlapMatcher<criteria> >& overlapMatchers,
+        std::vector<SegmentAssertionCounts>& counts
+    ) const;
+
+    void queueDetections(DataFile::SequenceConstIterator seqIt, const std::vector<Detection>& detections);
+    void queueDetections(size_t sequenceIndex, const std::vector<Detection>& detections);
+    void evaluate();
+
     void read(const cv::FileNode& node);
     void write(cv::FileStorage& fs) const;
     bool isEnd() const;
 
+    bool openResultStream(const std::string& path);
+    bool closeResultStream();
+    bool isResultStreamOpen() const;
+
+    void setOnline(bool isOnline);
+    bool isOnline() const;
+
     void draw(
         cv::Mat& dst,
         DataFile::SequenceIterator seqIt,
@@ -180,21 +583,71 @@ public:
         int pixelsPerFrame = 10,
         int trackHeight = 30
     );
+    void draw(
+        cv::Mat& dst,
+        size_t sequenceIndex,
+        VideoTime framePosition,
+        VideoTime numberOfFrames = 100,
+        int pixelsPerFrame = 10,
+        int trackHeight = 30
+    );
 
     void addAssertionSubscriber(SegmentAssertionSubscriber* subscriber);
     void notifySubscribers(SegmentAssertion* assertion);
 
     size_t countAssertions(SegmentAssertion::ResultType resultType);
+    size_t countAssertions(SegmentAssertion::ResultType resultType, SegmentAssertion::AssertionType assertionType);
+    const SegmentAssertionCounts& assertionCounts() const;
+    const SegmentAssertionCounts& assertionCounts(size_t sequenceIndex) const;
+    const SegmentMetrics& metrics() const;
+    const SegmentMetrics& metrics(size_t sequenceIndex) const;
+
+    void setFrameBitmaps(bool hasFrameBitmaps);
+    bool hasFrameBitmaps() const;
+    const FrameBitmap& detectionFrames(size_t sequenceIndex) const;
+    SegmentMetrics frameMetrics(size_t sequenceIndex) const;
+    SegmentMetrics frameMetrics() const;
 
     void clearAssertions();
 
 private:
-    bool isUnmarked(DataFile::SequenceConstIterator seqIt, Segment* segm);
-    SegmentAssertion* firstAssertionFor(DataFile::SequenceConstIterator seqIt, Segment* segm);
-
-    void insertAssertion(DataFile::SequenceConstIterator seqIt, SegmentAssertion* assertion);
+    size_t sequenceCount() const;
+    VideoTime sequenceLength(size_t sequenceIndex) const;
+    SegmentTrackView trackView(size_t sequenceIndex) const;
+    std::string trackName() const;
+
+    bool isUnmarked(size_t sequenceIndex, size_t segmentIndex) const;
+    bool isAssignable(size_t sequenceIndex, size_t segmentIndex, bool isSingle) const;
+    SegmentAssertion* firstAssertionFor(size_t sequenceIndex, size_t segmentIndex) const;
+    void indexAssertion(size_t assertionVectorIndex, SegmentAssertion* assertion);
+
+    ObjectPool<SegmentAssertion>& assertionPool(size_t assertionVectorIndex);
+    SegmentAssertion* insertAssertion(size_t sequenceIndex, const SegmentAssertion& assertion);
     void insertAssertion(size_t assertionVectorIndex, AssertionIterator it, SegmentAssertion *assertion);
 
+    void streamPassedSequences();
+    void writeSequence(YamlWriter& writer, size_t sequenceIndex) const;
+    void releaseAssertions(size_t sequenceIndex);
+    void discardAssertions(size_t sequenceIndex);
+    void pruneAssertions();
+    void releaseAssertion(SegmentAssertion* assertion);
+    void addDetectionFrames(size_t sequenceIndex, const SegmentAssertion* assertion);
+    SegmentMetrics addSequenceMetrics(size_t sequenceIndex, const SegmentAssertion* assertion);
+    void addFrameTotals(const SegmentMetrics& before, size_t sequenceIndex);
+
+    static VideoTime segmentFrames(
+        const SegmentTrackView& track,
+        VideoTime position,
+        VideoTime length,
+        std::vector<size_t>& segments
+    );
+    static void coverFrames(
+        std::map<VideoTime, VideoTime>& covered,
+        VideoTime begin,
+        VideoTime end,
+        std::vector<std::pair<VideoTime, VideoTime> >& uncovered
+    );
+
     void stamp(
         bool isSingle,
         VideoTime position,
@@ -202,115 +655,481 @@ private:
         const std::string& file,
         int lineNumber
     );
-    void overlap(
+    template<typename Matcher> void overlap(
+        bool isSingle,
+        VideoTime position,
+        VideoTime length,
+        const Matcher& overlapParams,
+        const std::string& info,
+        const std::string& file,
+        int lineNumber
+    );
+
+    template<typename Matcher> class SequenceEvaluator;
+    template<typename Matcher> class SweepEvaluator;
+    class SegmentMerge;
+
+    template<typename Matcher> void evaluateWith(
+        const std::vector<Detection>& detections,
+        const Matcher* overlapMatcher
+    );
+    template<typename Matcher> void evaluateSequencesWith(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const Matcher* overlapMatcher,
+        const std::string& file,
+        int lineNumber
+    );
+    template<typename Matcher> void sweepWith(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const std::vector<Matcher>& overlapMatchers,
+        std::vector<SegmentAssertionCounts>& counts
+    ) const;
+
+    // frames of a sequence already counted in its metrics: the detected frames as disjoint
+    // [begin, end) ranges keyed by begin, and whether the frames of its segments were added
+    class FrameCoverage{
+    public:
+        FrameCoverage() : hasSegmentFrames(false){}
+
+        bool                           hasSegmentFrames;
+        std::map<VideoTime, VideoTime> detected;
+    };
+
+    // the first assertion of a segment during sweep(), which creates no assertions
+    class FirstAssertion{
+    public:
+        FirstAssertion()
+            : isSet(false)
+            , position(0)
+            , length(0)
+            , type(SegmentAssertion::SINGLE_STAMP)
+        {}
+
+        bool                            isSet;
+        VideoTime                       position;
+        VideoTime                       length;
+        SegmentAssertion::AssertionType type;
+    };
+
+    template<typename Matcher> void sweepSequence(
+        size_t sequenceIndex,
+        const std::vector<Detection>& detections,
+        const std::vector<Matcher>& overlapMatchers,
+        std::vector<SegmentAssertionCounts>& counts
+    ) const;
+
+    void checkDetection(size_t sequenceIndex, const Detection& detection) const;
+    void checkDetectionPosition(size_t sequenceIndex, VideoTime position) const;
+    SegmentAssertion unmarkedAssertion(
+        const SegmentTrackView& track,
+        size_t segmentIndex,
+        const std::string& file,
+        int lineNumber
+    ) const;
+    SegmentAssertion stampAssertion(
+        size_t sequenceIndex,
+        const SegmentTrackView& track,
+        size_t segmentIndex,
+        bool isSingle,
+        VideoTime position,
+        const std::string& info,
+        const std::string& file,
+        int lineNumber
+    ) const;
+    template<typename Matcher> SegmentAssertion overlapAssertion(
+        size_t sequenceIndex,
+        const SegmentTrackView& track,
+        size_t segmentIndex,
         bool isSingle,
         VideoTime position,
         VideoTime length,
-        const OverlapParameters& overlapParams,
+        const Matcher& overlapParams,
         const std::string& info,
         const std::string& file,
         int lineNumber
+    ) const;
+
+    template<typename Matcher> void evaluateDetections(
+        size_t sequenceIndex,
+        size_t segmentIndex,
+        size_t assertionCursorIndex,
+        const std::vector<Detection>& detections,
+        const Matcher* overlapMatcher,
+        std::vector<SegmentAssertion*>& created
+    );
+    void markUnmarkedSegments(
+        size_t sequenceIndex,
+        size_t segmentIndex,
+        size_t assertionCursorIndex,
+        std::vector<SegmentAssertion*>& created,
+        const std::string& file,
+        int lineNumber
+    );
+    void mergeAssertions(
+        size_t assertionVectorIndex,
+        size_t assertionCursorIndex,
+        const std::vector<SegmentAssertion*>& ordered
     );
 
-    bool findMatchedSegment(VideoTime pos, SegmentTrack::SegmentConstIterator &segmIt);
-    bool findMatchedSegment(
+    static bool isDetectionBefore(const Detection* first, const Detection* second);
+    static bool isAssertionBefore(const SegmentAssertion* first, const SegmentAssertion* second);
+
+    static bool findMatchedSegment(const SegmentTrackView& track, VideoTime pos, size_t& segmentIndex);
+    static bool findMatchedSegment(
+        const SegmentTrackView& track,
         VideoTime pos,
         VideoTime length,
-        SegmentTrack::SegmentConstIterator &segmIt,
+        size_t& segmentIndex,
         const OverlapParameters &overlapParams,
         VideoTime& overlapDistance,
         VideoTime& missedDistance,
         VideoTime& unmarkedDistance
     );
+    template<typename Matcher> static bool findMatchedSegment(
+        const SegmentTrackView& track,
+        VideoTime pos,
+        VideoTime length,
+        size_t& segmentIndex,
+        const Matcher& overlapParams,
+        VideoTime& overlapDistance,
+        VideoTime& missedDistance,
+        VideoTime& unmarkedDistance
+    );
 
     // prevent copy
 
     SegmentTrackTest(const SegmentTrackTest&);
     SegmentTrackTest& operator = (const SegmentTrackTest&);
 
-    // iterators
+    // ground truth, m_view is set for tests over a DataFileView
+
+    const DataFileView* m_view;
+    size_t              m_trackIndex;
+
+    // cursor
 
     VideoTime m_cursorPosition;
-    DataFile::SequenceConstIterator    m_cursorSequenceIt;
-    SegmentTrack::SegmentConstIterator m_cursorSegmentIt;
+    size_t    m_cursorSequenceIndex;
+    size_t    m_cursorSegmentIndex;
 
     // assertions
 
     std::vector<std::vector<SegmentAssertion*> > m_assertions;
+    std::vector<ObjectPool<SegmentAssertion>*>   m_assertionPools;
     AssertionIterator m_assertionCursorIt;
 
+    // first assertion of each segment, indexed by segment for each sequence
+    std::vector<std::vector<SegmentAssertion*> > m_segmentAssertions;
+
     std::vector<SegmentAssertionSubscriber*> m_subscribers;
 
+    // detections waiting for evaluate(), per sequence
+    std::vector<std::vector<Detection> > m_queuedDetections;
+
+    // result stream, sequences before m_releasedSequences had their assertions written and freed
+
+    std::string   m_resultPath;
+    std::ofstream m_resultStream;
+    YamlWriter*   m_resultWriter;
+    size_t        m_streamedSequences;
+    size_t        m_releasedSequences;
+
+    // counts and metrics of all assertions inserted, including the ones freed since, per sequence
+    // and total
+    std::vector<SegmentAssertionCounts> m_sequenceCounts;
+    SegmentAssertionCounts              m_counts;
+    std::vector<SegmentMetrics>         m_sequenceMetrics;
+    SegmentMetrics                      m_metrics;
+    std::vector<FrameCoverage>          m_frameCoverage;
+
+    // online mode, see setOnline. m_hasFreedAssertions is set once online mode or the result stream
+    // freed an assertion, and stays set until the assertions are cleared
+    bool m_isOnline;
+    bool m_hasFreedAssertions;
+
+    // frames covered by detections per sequence, see setFrameBitmaps
+    bool                     m_hasFrameBitmaps;
+    std::vector<FrameBitmap> m_detectionFrames;
+
+};
+
+// Evaluates a range of sequences for SegmentTrackTest::evaluateSequences, overlap detections use
+// the given matcher or their own parameters if it is 0
+template<typename Matcher> class SegmentTrackTest::SequenceEvaluator : public cv::ParallelLoopBody{
+
+public:
+    SequenceEvaluator(
+        SegmentTrackTest* test,
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const Matcher* overlapMatcher,
+        size_t assertionCursorIndex,
+        std::vector<std::vector<SegmentAssertion*> >& created,
+        std::vector<std::string>& errors,
+        const std::string& file,
+        int lineNumber
+    );
+
+    void operator()(const cv::Range& range) const;
+
+private:
+    SegmentTrackTest* m_test;
+    const std::vector<std::vector<Detection> >&   m_sequenceDetections;
+    const Matcher*                                m_overlapMatcher;
+    size_t                                        m_assertionCursorIndex;
+    std::vector<std::vector<SegmentAssertion*> >& m_created;
+    std::vector<std::string>&                     m_errors;
+    const std::string&                            m_file;
+    int                                           m_lineNumber;
+};
+
+template<typename Matcher> inline SegmentTrackTest::SequenceEvaluator<Matcher>::SequenceEvaluator(
+        SegmentTrackTest* test,
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const Matcher* overlapMatcher,
+        size_t assertionCursorIndex,
+        std::vector<std::vector<SegmentAssertion*> >& created,
+        std::vector<std::string>& errors,
+        const std::string& file,
+        int lineNumber)
+    : m_test(test)
+    , m_sequenceDetections(sequenceDetections)
+    , m_overlapMatcher(overlapMatcher)
+    , m_assertionCursorIndex(assertionCursorIndex)
+    , m_created(created)
+    , m_errors(errors)
+    , m_file(file)
+    , m_lineNumber(lineNumber)
+{
+}
+
+template<typename Matcher> inline void SegmentTrackTest::SequenceEvaluator<Matcher>::operator()(const cv::Range& range) const{
+    const std::vector<Detection> noDetections;
+
+    for ( int i = range.start; i < range.end; ++i ){
+
+        // the cursor sequence continues from the current cursor, the rest start from the beginning
+
+        bool isCursorSequence       = (size_t)i == m_test->m_cursorSequenceIndex;
+        size_t segmentIndex         = isCursorSequence ? m_test->m_cursorSegmentIndex : 0;
+        size_t assertionCursorIndex = isCursorSequence ? m_assertionCursorIndex : 0;
+
+        try{
+            m_test->evaluateDetections(
+                i,
+                segmentIndex,
+                assertionCursorIndex,
+                (size_t)i < m_sequenceDetections.size() ? m_sequenceDetections[i] : noDetections,
+                m_overlapMatcher,
+                m_created[i]
+            );
+            m_test->markUnmarkedSegments(i, segmentIndex, assertionCursorIndex, m_created[i], m_file, m_lineNumber);
+        } catch ( tg::Exception& e ){
+            m_errors[i] = e.message();
+        } catch ( std::exception& e ){
+            m_errors[i] = e.what();
+        }
+    }
+}
+
+// Evaluates a range of sequences for SegmentTrackTest::sweep
+template<typename Matcher> class SegmentTrackTest::SweepEvaluator : public cv::ParallelLoopBody{
+
+public:
+    SweepEvaluator(
+        const SegmentTrackTest* test,
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const std::vector<Matcher>& overlapMatchers,
+        std::vector<std::vector<SegmentAssertionCounts> >& counts,
+        std::vector<std::string>& errors
+    )
+        : m_test(test)
+        , m_sequenceDetections(sequenceDetections)
+        , m_overlapMatchers(overlapMatchers)
+        , m_counts(counts)
+        , m_errors(errors)
+    {}
+
+    void operator()(const cv::Range& range) const;
+
+private:
+    const SegmentTrackTest* m_test;
+    const std::vector<std::vector<Detection> >&         m_sequenceDetections;
+    const std::vector<Matcher>&                         m_overlapMatchers;
+    std::vector<std::vector<SegmentAssertionCounts> >& m_counts;
+    std::vector<std::string>&                           m_errors;
+};
+
+template<typename Matcher> inline void SegmentTrackTest::SweepEvaluator<Matcher>::operator()(const cv::Range& range) const{
+    const std::vector<Detection> noDetections;
+
+    for ( int i = range.start; i < range.end; ++i ){
+        try{
+            m_test->sweepSequence(
+                i,
+                (size_t)i < m_sequenceDetections.size() ? m_sequenceDetections[i] : noDetections,
+                m_overlapMatchers,
+                m_counts[i]
+            );
+        } catch ( tg::Exception& e ){
+            m_errors[i] = e.message();
+        } catch ( std::exception& e ){
+            m_errors[i] = e.what();
+        }
+    }
+}
+
+// Walks the segments of a track along detections given in order of their position. Segments
+// covering the last position are kept, so each detection only visits the segments it overlaps.
+class SegmentTrackTest::SegmentMerge{
+
+public:
+    SegmentMerge(const SegmentTrackView& track, size_t segmentIndex)
+        : m_track(track)
+        , m_next(segmentIndex)
+    {}
+
+    void overlapping(VideoTime position, VideoTime length, std::vector<size_t>& result);
+
+private:
+    const SegmentTrackView& m_track;
+    size_t                  m_next;
+    std::vector<size_t>     m_covering;
 };
 
+// Sets result to the segments overlapping the given range in order of their index. The position
+// cannot decrease between calls.
+inline void SegmentTrackTest::SegmentMerge::overlapping(VideoTime position, VideoTime length, std::vector<size_t>& result){
+    const VideoTime* positions = m_track.segmentPositions();
+    const VideoTime* lengths   = m_track.segmentLengths();
+    size_t totalSegments       = m_track.totalSegments();
+
+    while ( m_next < totalSegments && positions[m_next] <= position )
+        m_covering.push_back(m_next++);
+
+    // segments ending before the position cannot overlap the next detections either
+    size_t covering = 0;
+    for ( size_t i = 0; i < m_covering.size(); ++i ){
+        if ( positions[m_covering[i]] + lengths[m_covering[i]] > position )
+            m_covering[covering++] = m_covering[i];
+    }
+    m_covering.resize(covering);
+
+    result.clear();
+    for ( std::vector<size_t>::iterator it = m_covering.begin(); it != m_covering.end(); ++it ){
+        if ( positions[*it] < position + length )
+            result.push_back(*it);
+    }
+    for ( size_t index = m_next; index < totalSegments && positions[index] < position + length; ++index )
+        result.push_back(index);
+}
+
 inline SegmentTrackTest::SegmentTrackTest(const DataFile *data, const TrackHeader *track)
     : TrackTest(data, track)
+    , m_view(0)
+    , m_trackIndex(data->trackIndex(track))
     , m_cursorPosition(0)
-    , m_cursorSequenceIt(data->sequencesBegin())
+    , m_cursorSequenceIndex(0)
+    , m_cursorSegmentIndex(0)
+    , m_resultWriter(0)
+    , m_streamedSequences(0)
+    , m_releasedSequences(0)
+    , m_isOnline(false)
+    , m_hasFreedAssertions(false)
+    , m_hasFrameBitmaps(false)
 {
     if ( track->type() != "Segment" )
         throw Exception("Track \'" + track->name() + "\' isn\'t a segment type.");
-    if ( m_cursorSequenceIt != data->sequencesEnd() ){
-        SegmentTrack* seqTrack = static_cast<SegmentTrack*>((*m_cursorSequenceIt)->track(track));
-        m_cursorSegmentIt = seqTrack->begin();
-    }
 
     m_assertions.resize(data->sequenceCount());
+    m_segmentAssertions.resize(data->sequenceCount());
+    m_sequenceCounts.resize(data->sequenceCount());
+    m_sequenceMetrics.resize(data->sequenceCount());
+    m_frameCoverage.resize(data->sequenceCount());
+    if ( m_assertions.size() > 0 ){
+        m_assertionCursorIt  = m_assertions.front().begin();
+    }
+}
+
+// Tests against a track of a binary data file without loading it. The view needs to stay open
+// while the test is in use.
+inline SegmentTrackTest::SegmentTrackTest(const DataFileView *view, size_t trackIndex)
+    : TrackTest(0, 0)
+    , m_view(view)
+    , m_trackIndex(trackIndex)
+    , m_cursorPosition(0)
+    , m_cursorSequenceIndex(0)
+    , m_cursorSegmentIndex(0)
+    , m_resultWriter(0)
+    , m_streamedSequences(0)
+    , m_releasedSequences(0)
+    , m_isOnline(false)
+    , m_hasFreedAssertions(false)
+    , m_hasFrameBitmaps(false)
+{
+    if ( !view->isOpen() )
+        throw Exception("Data file view is not open.");
+    if ( trackIndex >= view->trackCount() )
+        throw Exception("Track index is out of range.");
+    if ( view->trackType(trackIndex) != "Segment" )
+        throw Exception("Track \'" + view->trackName(trackIndex) + "\' isn\'t a segment type.");
+
+    m_assertions.resize(view->sequenceCount());
+    m_segmentAssertions.resize(view->sequenceCount());
+    m_sequenceCounts.resize(view->sequenceCount());
+    m_sequenceMetrics.resize(view->sequenceCount());
+    m_frameCoverage.resize(view->sequenceCount());
     if ( m_assertions.size() > 0 ){
         m_assertionCursorIt  = m_assertions.front().begin();
     }
 }
 
 inline SegmentTrackTest::~SegmentTrackTest(){
+    closeResultStream();
     clearAssertions();
 }
 
 inline void SegmentTrackTest::advanceCursorSequence(DataFile::SequenceIterator it, const std::string& file, int lineNumber){
-    if ( it <= m_cursorSequenceIt )
+    advanceCursorSequence(static_cast<size_t>(it - data()->sequencesBegin()), file, lineNumber);
+}
+
+inline void SegmentTrackTest::advanceCursorSequence(size_t sequenceIndex, const std::string& file, int lineNumber){
+    if ( sequenceIndex <= m_cursorSequenceIndex )
         throw Exception("Given cursor sequence is before the current one.");
+    if ( sequenceIndex > sequenceCount() )
+        throw Exception("Given cursor sequence is out of range.");
 
+    SegmentTrackView track = trackView(m_cursorSequenceIndex);
+    while ( m_cursorSequenceIndex != sequenceIndex ){
 
-    SegmentTrack* track  = static_cast<SegmentTrack*>((*m_cursorSequenceIt)->track(trackHeader()));
-    while (m_cursorSequenceIt != it){
-
-        while( m_cursorSegmentIt != track->end() ){
-            if ( isUnmarked(m_cursorSequenceIt, *m_cursorSegmentIt) ){
-                insertAssertion(m_cursorSequenceIt, new SegmentAssertion(
-                    (*m_cursorSegmentIt)->position(),
-                    (*m_cursorSegmentIt)->length(),
-                    SegmentAssertion::UNMARKED,
-                    SegmentAssertion::UNMARKED_SEGMENT,
-                    "",
-                    file,
-                    lineNumber,
-                    *m_cursorSegmentIt
-                ));
-            }
-            ++m_cursorSegmentIt;
+        while( m_cursorSegmentIndex < track.totalSegments() ){
+            if ( isUnmarked(m_cursorSequenceIndex, m_cursorSegmentIndex) )
+                insertAssertion(m_cursorSequenceIndex, unmarkedAssertion(track, m_cursorSegmentIndex, file, lineNumber));
+            ++m_cursorSegmentIndex;
         }
 
-        ++m_cursorSequenceIt;
+        ++m_cursorSequenceIndex;
 
-        if ( m_cursorSequenceIt != data()->sequencesEnd() ){
-            track = static_cast<SegmentTrack*>((*m_cursorSequenceIt)->track(trackHeader()));
-            m_cursorSegmentIt = track->begin();
+        if ( m_cursorSequenceIndex < sequenceCount() ){
+            track = trackView(m_cursorSequenceIndex);
+            m_cursorSegmentIndex = 0;
         }
     }
 
-    if ( m_cursorSequenceIt != data()->sequencesEnd() ){
-        track = static_cast<SegmentTrack*>((*m_cursorSequenceIt)->track(trackHeader()));
-        m_cursorSegmentIt = track->begin();
-        m_cursorPosition    = 0;
-        m_assertionCursorIt = m_assertions[m_cursorSequenceIt - data()->sequencesBegin()].begin();
+    if ( m_cursorSequenceIndex < sequenceCount() ){
+        m_cursorSegmentIndex = 0;
+        m_cursorPosition     = 0;
+        m_assertionCursorIt  = m_assertions[m_cursorSequenceIndex].begin();
     }
+
+    streamPassedSequences();
+    pruneAssertions();
 }
 
 inline void SegmentTrackTest::advanceCursorPosition(VideoTime position, const std::string& file, int lineNumber){
-    if ( m_cursorSequenceIt == data()->sequencesEnd() )
+    if ( m_cursorSequenceIndex >= sequenceCount() )
         throw Exception("Cannot advance cursor position. No sequence available.");
 
-    Sequence* seq = *m_cursorSequenceIt;
-    if ( seq->length() <= position ){
+    if ( sequenceLength(m_cursorSequenceIndex) <= position ){
         std::stringstream ss; ss << "Invalid cursor position given: " << position << ".";
         throw Exception(ss.str());
     }
@@ -319,26 +1138,17 @@ inline void SegmentTrackTest::advanceCursorPosition(VideoTime position, const st
         throw Exception("Cannot advance cursor backwards.");
     m_cursorPosition = position;
 
-    SegmentTrack* track = static_cast<SegmentTrack*>((*m_cursorSequenceIt)->track(trackHeader()));
-    while ( m_cursorSegmentIt != track->end() ){
-        Segment* segm = *m_cursorSegmentIt;
-        if ( segm->position() + segm->length() > m_cursorPosition )
+    SegmentTrackView track = trackView(m_cursorSequenceIndex);
+    while ( m_cursorSegmentIndex < track.totalSegments() ){
+        if ( track.segmentPosition(m_cursorSegmentIndex) + track.segmentLength(m_cursorSegmentIndex) > m_cursorPosition )
             break;
 
-        if ( isUnmarked(m_cursorSequenceIt, segm) ){
-            insertAssertion(m_cursorSequenceIt, new SegmentAssertion(
-                (*m_cursorSegmentIt)->position(),
-                (*m_cursorSegmentIt)->length(),
-                SegmentAssertion::UNMARKED,
-                SegmentAssertion::UNMARKED_SEGMENT,
-                "",
-                file,
-                lineNumber,
-                *m_cursorSegmentIt
-            ));
-        }
-        ++m_cursorSegmentIt;
+        if ( isUnmarked(m_cursorSequenceIndex, m_cursorSegmentIndex) )
+            insertAssertion(m_cursorSequenceIndex, unmarkedAssertion(track, m_cursorSegmentIndex, file, lineNumber));
+        ++m_cursorSegmentIndex;
     }
+
+    pruneAssertions();
 }
 
 inline void SegmentTrackTest::singleStamp(
@@ -359,10 +1169,10 @@ inline void SegmentTrackTest::multiStamp(
     stamp(false, position, info, file, lineNumber);
 }
 
-inline void SegmentTrackTest::singleOverlap(
+template<typename Matcher> inline void SegmentTrackTest::singleOverlap(
         VideoTime position,
         VideoTime length,
-        const SegmentTrackTest::OverlapParameters& overlapParams,
+        const Matcher& overlapParams,
         const std::string &info,
         const std::string &file,
         int lineNumber
@@ -370,10 +1180,10 @@ inline void SegmentTrackTest::singleOverlap(
     overlap(true, position, length, overlapParams, info, file, lineNumber);
 }
 
-inline void SegmentTrackTest::multiOverlap(
+template<typename Matcher> inline void SegmentTrackTest::multiOverlap(
     VideoTime position,
     VideoTime length,
-    const SegmentTrackTest::OverlapParameters& overlapParams,
+    const Matcher& overlapParams,
     const std::string &info,
     const std::string &file,
     int lineNumber
@@ -381,16 +1191,256 @@ inline void SegmentTrackTest::multiOverlap(
     overlap(false, position, length, overlapParams, info, file, lineNumber);
 }
 
+// Evaluates all detections for the current sequence in order of their position. The results and
+// notifications are the same as stamping or overlapping each detection in that order, but the
+// new assertions are merged into the assertion list in a single pass.
+inline void SegmentTrackTest::evaluate(const std::vector<Detection>& detections){
+    evaluateWith(detections, static_cast<const OverlapParameters*>(0));
+}
+
+// Same as evaluate(detections), with the overlap detections tested by the given matcher instead
+// of their overlap parameters
+template<unsigned int criteria> inline void SegmentTrackTest::evaluate(
+        const std::vector<Detection>& detections,
+        const OverlapMatcher<criteria>& overlapMatcher)
+{
+    evaluateWith(detections, &overlapMatcher);
+}
+
+template<typename Matcher> inline void SegmentTrackTest::evaluateWith(
+        const std::vector<Detection>& detections,
+        const Matcher* overlapMatcher)
+{
+    if ( detections.empty() )
+        return;
+    if ( m_cursorSequenceIndex >= sequenceCount() )
+        throw Exception("Current sequence is not set.");
+    for ( std::vector<Detection>::const_iterator it = detections.begin(); it != detections.end(); ++it )
+        checkDetection(m_cursorSequenceIndex, *it);
+
+    size_t assertionIndex       = m_cursorSequenceIndex;
+    size_t assertionCursorIndex = m_assertionCursorIt - m_assertions[assertionIndex].begin();
+
+    std::vector<SegmentAssertion*> created;
+    SegmentMetrics before = m_sequenceMetrics[assertionIndex];
+    evaluateDetections(
+        m_cursorSequenceIndex, m_cursorSegmentIndex, assertionCursorIndex, detections, overlapMatcher, created
+    );
+    m_assertionCursorIt = m_assertions[assertionIndex].begin() + assertionCursorIndex;
+
+    addFrameTotals(before, assertionIndex);
+    for ( AssertionIterator it = created.begin(); it != created.end(); ++it ){
+        m_counts.add(*it);
+        m_metrics.add(*it);
+        notifySubscribers(*it);
+    }
+}
+
+inline void SegmentTrackTest::queueDetections(
+        DataFile::SequenceConstIterator seqIt,
+        const std::vector<Detection>& detections)
+{
+    queueDetections(static_cast<size_t>(seqIt - data()->sequencesBegin()), detections);
+}
+
+inline void SegmentTrackTest::queueDetections(size_t sequenceIndex, const std::vector<Detection>& detections){
+    if ( sequenceIndex >= sequenceCount() )
+        throw Exception("Cannot queue detections. No sequence available.");
+    if ( m_queuedDetections.size() <= sequenceIndex )
+        m_queuedDetections.resize(sequenceIndex + 1);
+    m_queuedDetections[sequenceIndex].insert(m_queuedDetections[sequenceIndex].end(), detections.begin(), detections.end());
+}
+
+// Evaluates the queued detections with evaluateSequences
+inline void SegmentTrackTest::evaluate(){
+    if ( m_queuedDetections.empty() )
+        return;
+
+    std::vector<std::vector<Detection> > detections;
+    detections.swap(m_queuedDetections);
+    evaluateSequences(detections);
+}
+
+// Evaluates the detections of each sequence starting from the current one, where
+// sequenceDetections[i] holds the detections of the i-th sequence, and advances the cursor to
+// the end. Sequences are evaluated concurrently, subscribers are notified afterwards in sequence
+// order, the same as evaluating each sequence and advancing the cursor to the next one. The file
+// and line are given to the unmarked assertions, as with advanceCursorSequence.
+//
+// If a sequence fails, the sequences before it are evaluated as above and the cursor is advanced
+// to it, while it and the sequences after it are left as they were before the call.
+inline void SegmentTrackTest::evaluateSequences(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const std::string& file,
+        int lineNumber)
+{
+    evaluateSequencesWith(sequenceDetections, static_cast<const OverlapParameters*>(0), file, lineNumber);
+}
+
+// Same as evaluateSequences(sequenceDetections), with the overlap detections tested by the given
+// matcher instead of their overlap parameters
+template<unsigned int criteria> inline void SegmentTrackTest::evaluateSequences(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const OverlapMatcher<criteria>& overlapMatcher,
+        const std::string& file,
+        int lineNumber)
+{
+    evaluateSequencesWith(sequenceDetections, &overlapMatcher, file, lineNumber);
+}
+
+template<typename Matcher> inline void SegmentTrackTest::evaluateSequencesWith(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const Matcher* overlapMatcher,
+        const std::string& file,
+        int lineNumber)
+{
+    if ( m_cursorSequenceIndex >= sequenceCount() )
+        throw Exception("Current sequence is not set.");
+    if ( sequenceDetections.size() > sequenceCount() )
+        throw Exception("Given detections for more sequences than available.");
+
+    size_t cursorSequenceIndex = m_cursorSequenceIndex;
+    for ( size_t i = 0; i < sequenceDetections.size(); ++i ){
+        if ( i < cursorSequenceIndex ){
+            if ( !sequenceDetections[i].empty() )
+                throw Exception("Given detections for a sequence before the current one.");
+            continue;
+        }
+        const std::vector<Detection>& detections = sequenceDetections[i];
+        for ( std::vector<Detection>::const_iterator it = detections.begin(); it != detections.end(); ++it )
+            checkDetection(i, *it);
+    }
+
+    // shared containers are set up before evaluation, workers only access their own sequence
+
+    size_t totalSequences = sequenceCount();
+    if ( m_segmentAssertions.size() < totalSequences )
+        m_segmentAssertions.resize(totalSequences);
+    for ( size_t i = cursorSequenceIndex; i < totalSequences; ++i )
+        assertionPool(i);
+
+    std::vector<std::vector<SegmentAssertion*> > created(totalSequences);
+    std::vector<std::string> errors(totalSequences);
+    SegmentMetrics cursorMetrics = m_sequenceMetrics[cursorSequenceIndex];
+
+    cv::parallel_for_(
+        cv::Range((int)cursorSequenceIndex, (int)totalSequences),
+        SequenceEvaluator<Matcher>(
+            this,
+            sequenceDetections,
+            overlapMatcher,
+            m_assertionCursorIt - m_assertions[cursorSequenceIndex].begin(),
+            created,
+            errors,
+            file,
+            lineNumber
+        )
+    );
+
+    // the sequences after the first failing one are discarded, the failing one was left as it was
+
+    size_t failedSequenceIndex = cursorSequenceIndex;
+    while ( failedSequenceIndex < totalSequences && errors[failedSequenceIndex].empty() )
+        ++failedSequenceIndex;
+    for ( size_t i = std::max(failedSequenceIndex, cursorSequenceIndex + 1); i < totalSequences; ++i )
+        discardAssertions(i);
+
+    // only the cursor sequence had metrics before
+    for ( size_t i = cursorSequenceIndex; i < failedSequenceIndex; ++i ){
+        addFrameTotals(i == cursorSequenceIndex ? cursorMetrics : SegmentMetrics(), i);
+        for ( AssertionIterator it = created[i].begin(); it != created[i].end(); ++it ){
+            m_counts.add(*it);
+            m_metrics.add(*it);
+            notifySubscribers(*it);
+        }
+    }
+
+    if ( failedSequenceIndex < totalSequences ){
+        if ( failedSequenceIndex > cursorSequenceIndex ){
+            m_cursorSequenceIndex = failedSequenceIndex;
+            m_cursorSegmentIndex  = 0;
+            m_cursorPosition      = 0;
+            m_assertionCursorIt   = m_assertions[failedSequenceIndex].begin();
+        }
+        streamPassedSequences();
+        pruneAssertions();
+        throw Exception(errors[failedSequenceIndex]);
+    }
+
+    m_cursorSequenceIndex = totalSequences;
+    streamPassedSequences();
+    pruneAssertions();
+    m_assertionCursorIt   = m_assertions.back().end();
+}
+
+// Evaluates the detections of all sequences once for each of the overlap parameters, as if each
+// were used for the overlap detections of evaluateSequences on a new test, and sets counts[i] to
+// the resulting assertion counts for overlapParams[i]. The segments overlapping each detection
+// and their overlap lengths are found once and shared by all parameters, and no assertions are
+// created, so the cost of an additional parameter set is only the threshold checks.
+inline void SegmentTrackTest::sweep(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const std::vector<OverlapParameters>& overlapParams,
+        std::vector<SegmentAssertionCounts>& counts) const
+{
+    sweepWith(sequenceDetections, overlapParams, counts);
+}
+
+// Same as sweep() with overlap parameters, for matchers with the thresholds selected at compile time
+template<unsigned int criteria> inline void SegmentTrackTest::sweep(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const std::vector<OverlapMatcher<criteria> >& overlapMatchers,
+        std::vector<SegmentAssertionCounts>& counts) const
+{
+    sweepWith(sequenceDetections, overlapMatchers, counts);
+}
+
+template<typename Matcher> inline void SegmentTrackTest::sweepWith(
+        const std::vector<std::vector<Detection> >& sequenceDetections,
+        const std::vector<Matcher>& overlapParams,
+        std::vector<SegmentAssertionCounts>& counts) const
+{
+    if ( sequenceDetections.size() > sequenceCount() )
+        throw Exception("Given detections for more sequences than available.");
+
+    size_t totalSequences = sequenceCount();
+    std::vector<std::vector<SegmentAssertionCounts> > sequenceCounts(
+        totalSequences, std::vector<SegmentAssertionCounts>(overlapParams.size())
+    );
+    std::vector<std::string> errors(totalSequences);
+
+    cv::parallel_for_(
+        cv::Range(0, (int)totalSequences),
+        SweepEvaluator<Matcher>(this, sequenceDetections, overlapParams, sequenceCounts, errors)
+    );
+
+    for ( size_t i = 0; i < totalSequences; ++i ){
+        if ( !errors[i].empty() )
+            throw Exception(errors[i]);
+    }
+
+    counts.assign(overlapParams.size(), SegmentAssertionCounts());
+    for ( size_t i = 0; i < totalSequences; ++i ){
+        for ( size_t p = 0; p < overlapParams.size(); ++p )
+            counts[p].add(sequenceCounts[i][p]);
+    }
+}
+
 inline void SegmentTrackTest::read(const cv::FileNode& node){
     cv::FileNode seqNode = node["Sequences"];
     if ( seqNode.type() != cv::FileNode::SEQ )
         throw Exception("\'SegmentTrackTest.Sequences\' is not iterable.");
-    if ( seqNode.size() != data()->sequenceCount() )
+    if ( seqNode.size() != sequenceCount() )
         throw Exception("Different number of sequences between data file and result file.");
 
     clearAssertions();
 
     m_assertions.resize(seqNode.size());
+    m_segmentAssertions.resize(seqNode.size());
+    m_sequenceCounts.resize(seqNode.size());
+    m_sequenceMetrics.resize(seqNode.size());
+    m_frameCoverage.resize(seqNode.size());
+    setFrameBitmaps(m_hasFrameBitmaps);
 
     for( cv::FileNodeIterator vit = node.begin(); vit != node.end(); ++vit ){
         const cv::FileNode& nodeV = *vit;
@@ -438,18 +1488,25 @@ inline void SegmentTrackTest::read(const cv::FileNode& node){
                 fileLine = (int)node["FileLine"];
             }
 
-            Segment* segm = 0;
+            SegmentAssertion assertion(
+                static_cast<VideoTime>((double)node["Position"]),
+                static_cast<VideoTime>((double)node["Length"]),
+                result,
+                type,
+                info,
+                file,
+                fileLine
+            );
+
             if ( node["SegmentPosition"].type() != cv::FileNode::NONE &&
                  node["SegmentLength"].type() != cv::FileNode::NONE
             ){
                 VideoTime segmentPosition = static_cast<VideoTime>((double)node["SegmentPosition"]);
                 VideoTime segmentLength   = static_cast<VideoTime>((double)node["SegmentLength"]);
 
-                const Sequence* seq       = data()->sequenceAt(vit - node.begin());
-                const SegmentTrack* track = static_cast<const SegmentTrack*>(seq->track(trackHeader()));
-
-                SegmentTrack::SegmentConstIterator segmIt = track->segmentFrom(segmentPosition, segmentLength);
-                if ( segmIt == track->end() ){
+                SegmentTrackView track = trackView(vit - node.begin());
+                size_t segmentIndex    = track.segmentIndexFrom(segmentPosition, segmentLength);
+                if ( segmentIndex == track.totalSegments() ){
                     std::stringstream errorMessage;
                     errorMessage
                             << "\'SegmentTrackTest.Sequences.Assertions\' failed to find segment in data file: "
@@ -457,28 +1514,29 @@ inline void SegmentTrackTest::read(const cv::FileNode& node){
                     throw Exception(errorMessage.str());
                 }
 
-                segm = *segmIt;
+                assertion.setSegment(track, segmentIndex);
             }
 
-            assertV.push_back(new SegmentAssertion(
-                static_cast<VideoTime>((double)node["Position"]),
-                static_cast<VideoTime>((double)node["Length"]),
-                result,
-                type,
-                info,
-                file,
-                fileLine,
-                segm
-            ));
+            assertV.push_back(assertionPool((size_t)((double)nodeV["Index"])).create(assertion));
+            indexAssertion((size_t)((double)nodeV["Index"]), assertV.back());
+            m_sequenceCounts[(size_t)((double)nodeV["Index"])].add(assertV.back());
+            m_counts.add(assertV.back());
+            m_metrics.add(addSequenceMetrics((size_t)((double)nodeV["Index"]), assertV.back()));
+            addDetectionFrames((size_t)((double)nodeV["Index"]), assertV.back());
         }
     }
 
-    m_cursorSequenceIt = data()->sequencesEnd();
+    m_cursorSequenceIndex = sequenceCount();
 }
 
+// Throws in online mode, or if assertions were freed by the result stream or by online mode, even if
+// it was turned off since
 inline void SegmentTrackTest::write(cv::FileStorage& fs) const{
+    if ( m_hasFreedAssertions || m_isOnline )
+        throw Exception("Cannot write the results of track '" + trackName() + "', their assertions were freed.");
+
     fs << "{";
-    fs << "Header" << (double)(data()->trackIndex(trackHeader()));
+    fs << "Header" << (double)(m_trackIndex);
     fs << "Type"   << "SegmentTrackTest";
     fs << "Sequences" << "[";
     size_t index = 0;
@@ -493,20 +1551,8 @@ inline void SegmentTrackTest::write(cv::FileStorage& fs) const{
         for ( std::vector<SegmentAssertion*>::const_iterator it = vit->begin(); it != vit->end(); ++it ){
             SegmentAssertion* assertion = *it;
 
-            switch( assertion->type() ){
-            case SegmentAssertion::SINGLE_STAMP:     fs << "Type" << "SingleStamp"; break;
-            case SegmentAssertion::MULTI_STAMP:      fs << "Type" << "MultiStamp"; break;
-            case SegmentAssertion::SINGLE_OVERLAP:   fs << "Type" << "SingleOverlap"; break;
-            case SegmentAssertion::MULTI_OVERLAP:    fs << "Type" << "MultiOverlap"; break;
-            case SegmentAssertion::UNMARKED_SEGMENT: fs << "Type" << "Unmarked"; break;
-            }
-
-            switch( assertion->result() ){
-            case SegmentAssertion::MATCH: fs << "Result" << "Match"; break;
-            case SegmentAssertion::MISS:  fs << "Result" << "Miss"; break;
-            case SegmentAssertion::UNMARKED: fs << "Result" << "Unmarked"; break;
-            }
-
+            fs << "Type" << SegmentAssertion::typeName(assertion->type());
+            fs << "Result" << SegmentAssertion::resultName(assertion->result());
             fs << "Position" << (double)assertion->position();
             fs << "Length" << (double)assertion->length();
             if ( assertion->hasInfo() )
@@ -516,8 +1562,8 @@ inline void SegmentTrackTest::write(cv::FileStorage& fs) const{
                 fs << "FileLine" << assertion->lineNumber();
             }
             if ( assertion->hasSegment() ){
-                fs << "SegmentPosition" << (double)assertion->segment()->position();
-                fs << "SegmentLength" << (double)assertion->segment()->length();
+                fs << "SegmentPosition" << (double)assertion->segmentPosition();
+                fs << "SegmentLength" << (double)assertion->segmentLength();
             }
         }
         fs << "]";
@@ -528,11 +1574,75 @@ inline void SegmentTrackTest::write(cv::FileStorage& fs) const{
 }
 
 inline bool SegmentTrackTest::isEnd() const{
-    if ( m_cursorSequenceIt == data()->sequencesEnd() )
+    if ( m_cursorSequenceIndex >= sequenceCount() )
         return true;
     return false;
 }
 
+// Writes the results to path while the test runs. Once the cursor moves past a sequence, its
+// assertions are written and freed, so they are no longer available to draw() or subscribers
+// holding on to them, only to the assertion counts. Closing the stream writes the assertions of the remaining
+// sequences and ends the document. Sequences freed by an earlier stream are not written again.
+// Once a sequence was freed, write() throws instead of leaving it out, so the results of a test
+// streamed this way are only in the stream, and TestSuite::writeTo() throws for its suite as well.
+inline bool SegmentTrackTest::openResultStream(const std::string& path){
+    if ( m_isOnline )
+        throw Exception("Results cannot be streamed in online mode.");
+    closeResultStream();
+
+    m_resultStream.clear();
+    m_resultStream.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if ( !m_resultStream.is_open() )
+        return false;
+    m_resultPath = path;
+
+    m_resultWriter = new YamlWriter(m_resultStream);
+    m_resultWriter->write("Header", static_cast<VideoTime>(m_trackIndex));
+    m_resultWriter->write("Type", "SegmentTrackTest");
+    m_resultWriter->startSequence("Sequences");
+    m_streamedSequences = m_releasedSequences;
+
+    streamPassedSequences();
+    return true;
+}
+
+// Returns false if the results could not be written completely
+inline bool SegmentTrackTest::closeResultStream(){
+    if ( !isResultStreamOpen() )
+        return false;
+
+    for ( ; m_streamedSequences < m_assertions.size(); ++m_streamedSequences )
+        writeSequence(*m_resultWriter, m_streamedSequences);
+    m_resultWriter->endSequence();
+
+    delete m_resultWriter;
+    m_resultWriter = 0;
+    m_resultStream.flush();
+    bool isWritten = !m_resultStream.fail();
+    m_resultStream.close();
+    m_resultPath = "";
+    return isWritten;
+}
+
+inline bool SegmentTrackTest::isResultStreamOpen() const{
+    return m_resultWriter != 0;
+}
+
+// In online mode only the assertions that can still change are kept: those of the cursor sequence
+// that end after the cursor position, and the first assertion of each segment the cursor has not
+// passed. The others are freed as the cursor advances and are only available as counts, so
+// memory stays bounded on a continuous stream of detections while the counts stay the same.
+inline void SegmentTrackTest::setOnline(bool isOnline){
+    if ( isOnline && isResultStreamOpen() )
+        throw Exception("Results cannot be streamed in online mode.");
+    m_isOnline = isOnline;
+    pruneAssertions();
+}
+
+inline bool SegmentTrackTest::isOnline() const{
+    return m_isOnline;
+}
+
 inline void SegmentTrackTest::draw(
         cv::Mat &dst,
         DataFile::SequenceIterator seqIt,
@@ -540,6 +1650,27 @@ inline void SegmentTrackTest::draw(
         VideoTime numberOfFrames,
         int pixelsPerFrame,
         int trackHeight)
+{
+    draw(
+        dst,
+        static_cast<size_t>(seqIt - data()->sequencesBegin()),
+        framePosition,
+        numberOfFrames,
+        pixelsPerFrame,
+        trackHeight
+    );
+}
+
+// Only draws the assertions that are still kept. In online mode or with a result stream, the
+// segments the cursor passed are drawn neither as marked nor as unmarked once their assertions are
+// freed, only the segments from the cursor on and the assertions kept by setOnline() are.
+inline void SegmentTrackTest::draw(
+        cv::Mat &dst,
+        size_t sequenceIndex,
+        VideoTime framePosition,
+        VideoTime numberOfFrames,
+        int pixelsPerFrame,
+        int trackHeight)
 {
     // Value calculation
 
@@ -553,8 +1684,6 @@ inline void SegmentTrackTest::draw(
     );
     dst.setTo(cv::Scalar(70, 70, 70));
 
-    const TrackHeader* theader = trackHeader();
-
     cv::rectangle(
         dst,
         cv::Rect(0, 0, TrackTest::DRAW_HEADER_WIDTH, trackHeight - 1),
@@ -564,7 +1693,7 @@ inline void SegmentTrackTest::draw(
 
     cv::putText(
         dst,
-        theader->name().substr(0, 9),
+        trackName().substr(0, 9),
         cv::Point(10, trackHeight / 2 + 10),
         cv::FONT_HERSHEY_SIMPLEX,
         0.44,
@@ -572,51 +1701,44 @@ inline void SegmentTrackTest::draw(
         1
     );
 
-    size_t currentSequenceIndex = seqIt - data()->sequencesBegin();
-    size_t cursorSequenceIndex  = m_cursorSequenceIt - data()->sequencesBegin();
+    size_t currentSequenceIndex = sequenceIndex;
+    size_t cursorSequenceIndex  = m_cursorSequenceIndex;
 
     VideoTime cursorPosition = 0;
     if ( currentSequenceIndex < cursorSequenceIndex )
-        cursorPosition = (*seqIt)->length();
+        cursorPosition = sequenceLength(sequenceIndex);
     else if ( currentSequenceIndex == cursorSequenceIndex )
         cursorPosition = m_cursorPosition;
 
-    Sequence* seq       = *seqIt;
-    SegmentTrack* track = static_cast<SegmentTrack*>(seq->track(theader));
+    SegmentTrackView track = trackView(sequenceIndex);
 
-    // Draw unmarked segments
+    // Draw unmarked segments, from the cursor on, where the first assertions are never freed
 
-    SegmentTrack::SegmentIterator it = track->segmentFrom(cursorPosition);
-    SegmentTrack::SegmentIterator reversePeekIt = it;
-    if ( reversePeekIt != track->begin() ){
-        do{
-            --reversePeekIt;
-            Segment* segm = *reversePeekIt;
-            if ( segm->position() + segm->length() <= cursorPosition )
-                break;
-            it = reversePeekIt;
-        } while ( reversePeekIt != track->begin() );
+    size_t segmentIndex = track.segmentIndexFrom(cursorPosition);
+    while ( segmentIndex > 0 &&
+            track.segmentPosition(segmentIndex - 1) + track.segmentLength(segmentIndex - 1) > cursorPosition )
+    {
+        --segmentIndex;
     }
 
     VideoTime sequencePosition = 0;
-    while( seqIt != data()->sequencesEnd() ){
-        if ( it == track->end() ){
-            sequencePosition += seq->length();
-            ++seqIt;
-            if ( seqIt == data()->sequencesEnd() )
+    while( sequenceIndex < sequenceCount() ){
+        if ( segmentIndex == track.totalSegments() ){
+            sequencePosition += sequenceLength(sequenceIndex);
+            ++sequenceIndex;
+            if ( sequenceIndex == sequenceCount() )
                 break;
-            seq = *seqIt;
-            track = static_cast<SegmentTrack*>(seq->track(theader));
-            it = track->begin();
+            track        = trackView(sequenceIndex);
+            segmentIndex = 0;
         } else {
-            Segment* segm = *it;
-            if ( segm->position() > frameEndInterval )
+            VideoTime segmentPosition = track.segmentPosition(segmentIndex);
+            if ( segmentPosition > frameEndInterval )
                 break;
 
-            if ( isUnmarked(seqIt, segm) ){
+            if ( isUnmarked(sequenceIndex, segmentIndex) ){
 
-                int drawStartPosition = (int)(segm->position() - framePosition + sequencePosition);
-                int drawLength        = (int)(segm->length());
+                int drawStartPosition = (int)(segmentPosition - framePosition + sequencePosition);
+                int drawLength        = (int)(track.segmentLength(segmentIndex));
                 if ( drawStartPosition < 0 ){
                     drawLength       += drawStartPosition;
                     drawStartPosition = 0;
@@ -633,7 +1755,7 @@ inline void SegmentTrackTest::draw(
                 );
             }
 
-            ++it;
+            ++segmentIndex;
         }
     }
 
@@ -644,18 +1766,19 @@ inline void SegmentTrackTest::draw(
     sequencePosition = 0;
     while ( currentSequenceIndex < m_assertions.size() ){
         if ( asIt == m_assertions[currentSequenceIndex].end() ){
-            sequencePosition += seq->length();
+            sequencePosition += sequenceLength(currentSequenceIndex);
             ++currentSequenceIndex;
             if ( currentSequenceIndex == m_assertions.size() )
                 break;
             asIt = m_assertions[currentSequenceIndex].begin();
         } else {
             if ((*asIt)->hasSegment() ){
-                const Segment* segm = (*asIt)->segment();
+                VideoTime segmentPosition = (*asIt)->segmentPosition();
+                VideoTime segmentLength   = (*asIt)->segmentLength();
 
-                if ( sequencePosition + segm->position() + segm->length() > framePosition ){
-                    int drawStartPosition = (int)(segm->position() - framePosition + sequencePosition);
-                    int drawLength        = (int)(segm->length());
+                if ( sequencePosition + segmentPosition + segmentLength > framePosition ){
+                    int drawStartPosition = (int)(segmentPosition - framePosition + sequencePosition);
+                    int drawLength        = (int)(segmentLength);
                     if ( drawStartPosition < 0 ){
                         drawLength       += drawStartPosition;
                         drawStartPosition = 0;
@@ -734,73 +1857,199 @@ inline void SegmentTrackTest::notifySubscribers(SegmentAssertion* assertion){
 }
 
 inline size_t SegmentTrackTest::countAssertions(SegmentAssertion::ResultType resultType){
-    size_t totalAssertions = 0;
-    for ( SegmentTrackTest::AssertionVectorIterator avIt = m_assertions.begin(); avIt != m_assertions.end(); ++avIt ){
-        for ( SegmentTrackTest::AssertionIterator asIt = avIt->begin(); asIt != avIt->end(); ++asIt ){
-            if ( (*asIt)->result() == resultType )
-                ++totalAssertions;
-        }
+    return m_counts.count(resultType);
+}
+
+inline size_t SegmentTrackTest::countAssertions(
+        SegmentAssertion::ResultType resultType,
+        SegmentAssertion::AssertionType assertionType)
+{
+    return m_counts.count(resultType, assertionType);
+}
+
+// Counts of the assertions of all sequences, kept up to date as assertions are inserted
+inline const SegmentAssertionCounts& SegmentTrackTest::assertionCounts() const{
+    return m_counts;
+}
+
+inline const SegmentAssertionCounts& SegmentTrackTest::assertionCounts(size_t sequenceIndex) const{
+    if ( sequenceIndex >= m_sequenceCounts.size() )
+        throw Exception("Sequence index is out of range.");
+    return m_sequenceCounts[sequenceIndex];
+}
+
+// Precision and recall of the detections in all sequences, kept up to date as assertions are inserted
+inline const SegmentMetrics& SegmentTrackTest::metrics() const{
+    return m_metrics;
+}
+
+inline const SegmentMetrics& SegmentTrackTest::metrics(size_t sequenceIndex) const{
+    if ( sequenceIndex >= m_sequenceMetrics.size() )
+        throw Exception("Sequence index is out of range.");
+    return m_sequenceMetrics[sequenceIndex];
+}
+
+// Keeps a bitmap of the frames covered by detections for each sequence, from which frameMetrics()
+// computes exact frame level metrics. Frames stay marked after their assertions are freed by the
+// result stream or online mode, but assertions freed before the bitmaps are enabled are not
+// included. Each bitmap takes one bit per frame of its sequence.
+inline void SegmentTrackTest::setFrameBitmaps(bool hasFrameBitmaps){
+    m_hasFrameBitmaps = hasFrameBitmaps;
+    m_detectionFrames.clear();
+    if ( !hasFrameBitmaps )
+        return;
+
+    m_detectionFrames.resize(m_assertions.size());
+    for ( size_t i = 0; i < m_assertions.size(); ++i ){
+        m_detectionFrames[i].resize(sequenceLength(i));
+        for ( AssertionConstIteartor it = m_assertions[i].begin(); it != m_assertions[i].end(); ++it )
+            addDetectionFrames(i, *it);
     }
-    return totalAssertions;
+}
+
+inline bool SegmentTrackTest::hasFrameBitmaps() const{
+    return m_hasFrameBitmaps;
+}
+
+inline const FrameBitmap& SegmentTrackTest::detectionFrames(size_t sequenceIndex) const{
+    if ( !m_hasFrameBitmaps )
+        throw Exception("Frame bitmaps are not enabled.");
+    if ( sequenceIndex >= m_detectionFrames.size() )
+        throw Exception("Sequence index is out of range.");
+    return m_detectionFrames[sequenceIndex];
+}
+
+// Metrics of a sequence with the frame level counts recomputed from the frame bitmaps
+inline SegmentMetrics SegmentTrackTest::frameMetrics(size_t sequenceIndex) const{
+    const FrameBitmap& detections = detectionFrames(sequenceIndex);
+    FrameBitmap truth(detections.length());
+    truth.set(trackView(sequenceIndex));
+
+    SegmentMetrics result = metrics(sequenceIndex);
+    result.setFrames(detections.countAnd(truth), detections.countAndNot(truth), truth.countAndNot(detections));
+    return result;
+}
+
+inline SegmentMetrics SegmentTrackTest::frameMetrics() const{
+    SegmentMetrics result;
+    for ( size_t i = 0; i < m_detectionFrames.size(); ++i )
+        result.add(frameMetrics(i));
+    return result;
 }
 
 inline void SegmentTrackTest::clearAssertions(){
+    m_assertions.clear();
+    m_segmentAssertions.clear();
+
     for (
-        std::vector<std::vector<SegmentAssertion*> >::iterator vit = m_assertions.begin();
-        vit != m_assertions.end();
-        ++vit
+        std::vector<ObjectPool<SegmentAssertion>*>::iterator pit = m_assertionPools.begin();
+        pit != m_assertionPools.end();
+        ++pit
     ){
-        for ( AssertionIterator ait = (*vit).begin(); ait != (*vit).end(); ++ait )
-            delete *ait;
+        delete *pit;
     }
-    m_assertions.clear();
+    m_assertionPools.clear();
+
+    m_streamedSequences  = 0;
+    m_releasedSequences  = 0;
+    m_hasFreedAssertions = false;
+    m_sequenceCounts.clear();
+    m_counts.clear();
+    m_sequenceMetrics.clear();
+    m_metrics.clear();
+    m_frameCoverage.clear();
+    m_detectionFrames.clear();
 }
 
-inline bool SegmentTrackTest::isUnmarked(DataFile::SequenceConstIterator seqIt, Segment* segm){
-    size_t assertionIndex = seqIt - data()->sequencesBegin();
+inline size_t SegmentTrackTest::sequenceCount() const{
+    return m_view ? m_view->sequenceCount() : data()->sequenceCount();
+}
 
-    AssertionIterator asIt =
-        (seqIt == m_cursorSequenceIt ? m_assertionCursorIt : m_assertions[assertionIndex].begin());
+inline VideoTime SegmentTrackTest::sequenceLength(size_t sequenceIndex) const{
+    return m_view ? m_view->sequenceAt(sequenceIndex).length() : data()->sequenceAt(sequenceIndex)->length();
+}
 
-    while ( asIt != m_assertions[assertionIndex].end() ){
-        if ( (*asIt)->segment() == segm )
-            return false;
-        ++asIt;
-    }
-    return true;
+inline SegmentTrackView SegmentTrackTest::trackView(size_t sequenceIndex) const{
+    if ( m_view )
+        return m_view->sequenceAt(sequenceIndex).track(m_trackIndex);
+    return static_cast<const SegmentTrack*>(data()->sequenceAt(sequenceIndex)->track(trackHeader()))->view();
 }
 
-inline SegmentAssertion* SegmentTrackTest::firstAssertionFor(DataFile::SequenceConstIterator seqIt, Segment* segm){
-    size_t assertionIndex = seqIt - data()->sequencesBegin();
+inline std::string SegmentTrackTest::trackName() const{
+    return m_view ? m_view->trackName(m_trackIndex) : trackHeader()->name();
+}
 
-    AssertionIterator asIt =
-        (seqIt == m_cursorSequenceIt ? m_assertionCursorIt : m_assertions[assertionIndex].begin());
+inline ObjectPool<SegmentAssertion>& SegmentTrackTest::assertionPool(size_t assertionVectorIndex){
+    if ( m_assertionPools.size() <= assertionVectorIndex )
+        m_assertionPools.resize(assertionVectorIndex + 1, 0);
+    if ( m_assertionPools[assertionVectorIndex] == 0 )
+        m_assertionPools[assertionVectorIndex] = new ObjectPool<SegmentAssertion>;
+    return *m_assertionPools[assertionVectorIndex];
+}
 
-    while ( asIt != m_assertions[assertionIndex].end() ){
-        if ( (*asIt)->segment() == segm )
-            return *asIt;
-        ++asIt;
+inline bool SegmentTrackTest::isUnmarked(size_t sequenceIndex, size_t segmentIndex) const{
+    return firstAssertionFor(sequenceIndex, segmentIndex) == 0;
+}
+
+// Single detections only match unmarked segments, multiple ones any segment not already matched
+// by a single detection
+inline bool SegmentTrackTest::isAssignable(size_t sequenceIndex, size_t segmentIndex, bool isSingle) const{
+    SegmentAssertion* firstAssertion = firstAssertionFor(sequenceIndex, segmentIndex);
+    if ( isSingle )
+        return firstAssertion == 0;
+    return firstAssertion == 0 || firstAssertion->type() != SegmentAssertion::SINGLE_STAMP;
+}
+
+inline SegmentAssertion* SegmentTrackTest::firstAssertionFor(size_t sequenceIndex, size_t segmentIndex) const{
+    if ( sequenceIndex >= m_segmentAssertions.size() )
+        return 0;
+
+    const std::vector<SegmentAssertion*>& segmentAssertions = m_segmentAssertions[sequenceIndex];
+    return segmentIndex < segmentAssertions.size() ? segmentAssertions[segmentIndex] : 0;
+}
+
+inline void SegmentTrackTest::indexAssertion(size_t assertionVectorIndex, SegmentAssertion* assertion){
+    if ( !assertion->hasSegment() )
+        return;
+
+    if ( m_segmentAssertions.size() <= assertionVectorIndex )
+        m_segmentAssertions.resize(assertionVectorIndex + 1);
+    std::vector<SegmentAssertion*>& segmentAssertions = m_segmentAssertions[assertionVectorIndex];
+    if ( segmentAssertions.size() <= assertion->segmentIndex() )
+        segmentAssertions.resize(trackView(assertionVectorIndex).totalSegments(), 0);
+
+    // keep the assertion that comes first in the sorted assertion list
+
+    SegmentAssertion*& first = segmentAssertions[assertion->segmentIndex()];
+    if ( first == 0 && assertion->result() == SegmentAssertion::MATCH )
+        assertion->m_isFirstMatch = true;
+    if ( first == 0 ||
+         assertion->position() < first->position() ||
+         (assertion->position() == first->position() && assertion->length() <= first->length())
+    ){
+        first = assertion;
     }
-    return 0;
 }
 
-inline void SegmentTrackTest::insertAssertion(DataFile::SequenceConstIterator seqIt, SegmentAssertion* assertion){
-    size_t assertionIndex = seqIt - data()->sequencesBegin();
+inline SegmentAssertion* SegmentTrackTest::insertAssertion(size_t sequenceIndex, const SegmentAssertion& value){
+    size_t assertionIndex = sequenceIndex;
+    SegmentAssertion* assertion = assertionPool(assertionIndex).create(value);
     AssertionIterator asIt =
-        (seqIt == m_cursorSequenceIt ? m_assertionCursorIt : m_assertions[assertionIndex].begin());
+        (sequenceIndex == m_cursorSequenceIndex ? m_assertionCursorIt : m_assertions[assertionIndex].begin());
 
     while ( asIt != m_assertions[assertionIndex].end() ){
         if ( (*asIt)->position() > assertion->position() ){
             insertAssertion(assertionIndex, asIt, assertion);
-            return;
+            return assertion;
         } else if ( (*asIt)->position() == assertion->position() && (*asIt)->length() >= assertion->length() ){
             insertAssertion(assertionIndex, asIt, assertion);
-            return;
+            return assertion;
         }
         ++asIt;
     }
 
     insertAssertion(assertionIndex, m_assertions[assertionIndex].end(), assertion);
+    return assertion;
 }
 
 inline void SegmentTrackTest::insertAssertion(
@@ -816,9 +2065,254 @@ inline void SegmentTrackTest::insertAssertion(
         m_assertions[assertionVectorIndex].insert(it, assertion);
         m_assertionCursorIt = m_assertions[assertionVectorIndex].begin() + assertionCursorIndex;
     }
+    indexAssertion(assertionVectorIndex, assertion);
+    m_sequenceCounts[assertionVectorIndex].add(assertion);
+    addDetectionFrames(assertionVectorIndex, assertion);
+    m_counts.add(assertion);
+    m_metrics.add(addSequenceMetrics(assertionVectorIndex, assertion));
     notifySubscribers(assertion);
 }
 
+// Writes and frees the assertions of the sequences before the cursor
+inline void SegmentTrackTest::streamPassedSequences(){
+    if ( !isResultStreamOpen() )
+        return;
+
+    size_t passedSequences = std::min(m_cursorSequenceIndex, m_assertions.size());
+    if ( m_streamedSequences >= passedSequences )
+        return;
+
+    for ( ; m_streamedSequences < passedSequences; ++m_streamedSequences ){
+        writeSequence(*m_resultWriter, m_streamedSequences);
+        releaseAssertions(m_streamedSequences);
+    }
+
+    m_resultStream.flush();
+    if ( m_resultStream.fail() )
+        throw Exception("Failed to write results to: " + m_resultPath);
+}
+
+inline void SegmentTrackTest::writeSequence(YamlWriter& writer, size_t sequenceIndex) const{
+    writer.startMapping();
+    writer.write("Index", static_cast<VideoTime>(sequenceIndex));
+    writer.startSequence("Assertions");
+
+    const std::vector<SegmentAssertion*>& assertions = m_assertions[sequenceIndex];
+    for ( AssertionConstIteartor it = assertions.begin(); it != assertions.end(); ++it ){
+        const SegmentAssertion* assertion = *it;
+
+        writer.startMapping();
+        writer.write("Type", SegmentAssertion::typeName(assertion->type()));
+        writer.write("Result", SegmentAssertion::resultName(assertion->result()));
+        writer.write("Position", assertion->position());
+        writer.write("Length", assertion->length());
+        if ( assertion->hasInfo() )
+            writer.write("Info", assertion->info());
+        if ( assertion->hasFile() ){
+            writer.write("File", assertion->file());
+            writer.write("FileLine", static_cast<VideoTime>(assertion->lineNumber()));
+        }
+        if ( assertion->hasSegment() ){
+            writer.write("SegmentPosition", assertion->segmentPosition());
+            writer.write("SegmentLength", assertion->segmentLength());
+        }
+        writer.endMapping();
+    }
+
+    writer.endSequence();
+    writer.endMapping();
+}
+
+// Frees the assertions of a sequence the cursor has passed
+inline void SegmentTrackTest::releaseAssertions(size_t sequenceIndex){
+    std::vector<SegmentAssertion*>().swap(m_assertions[sequenceIndex]);
+
+    if ( sequenceIndex < m_segmentAssertions.size() )
+        std::vector<SegmentAssertion*>().swap(m_segmentAssertions[sequenceIndex]);
+    if ( sequenceIndex < m_assertionPools.size() ){
+        delete m_assertionPools[sequenceIndex];
+        m_assertionPools[sequenceIndex] = 0;
+    }
+    if ( sequenceIndex < m_frameCoverage.size() )
+        std::map<VideoTime, VideoTime>().swap(m_frameCoverage[sequenceIndex].detected);
+
+    m_releasedSequences  = sequenceIndex + 1;
+    m_hasFreedAssertions = true;
+}
+
+// Frees the assertions of a sequence after the cursor and clears its counts, as before it was
+// evaluated
+inline void SegmentTrackTest::discardAssertions(size_t sequenceIndex){
+    std::vector<SegmentAssertion*>().swap(m_assertions[sequenceIndex]);
+
+    if ( sequenceIndex < m_segmentAssertions.size() )
+        std::vector<SegmentAssertion*>().swap(m_segmentAssertions[sequenceIndex]);
+    if ( sequenceIndex < m_assertionPools.size() ){
+        delete m_assertionPools[sequenceIndex];
+        m_assertionPools[sequenceIndex] = 0;
+    }
+
+    m_sequenceCounts[sequenceIndex].clear();
+    m_sequenceMetrics[sequenceIndex].clear();
+    m_frameCoverage[sequenceIndex] = FrameCoverage();
+    if ( m_hasFrameBitmaps )
+        m_detectionFrames[sequenceIndex].clear();
+}
+
+// Frees the assertions that can no longer change in online mode, see setOnline
+inline void SegmentTrackTest::pruneAssertions(){
+    if ( !m_isOnline )
+        return;
+
+    size_t passedSequences = std::min(m_cursorSequenceIndex, m_assertions.size());
+    for ( size_t i = m_releasedSequences; i < passedSequences; ++i )
+        releaseAssertions(i);
+    if ( m_cursorSequenceIndex >= m_assertions.size() )
+        return;
+
+    std::vector<SegmentAssertion*>& assertions = m_assertions[m_cursorSequenceIndex];
+    size_t assertionCursorIndex = m_assertionCursorIt - assertions.begin();
+    size_t cursorOffset         = 0;
+    size_t totalKept            = 0;
+    for ( size_t i = 0; i < assertions.size(); ++i ){
+        SegmentAssertion* assertion = assertions[i];
+        bool isFirstOfNextSegment =
+            assertion->hasSegment() &&
+            assertion->segmentIndex() >= m_cursorSegmentIndex &&
+            firstAssertionFor(m_cursorSequenceIndex, assertion->segmentIndex()) == assertion;
+
+        if ( isFirstOfNextSegment || assertion->position() + assertion->length() > m_cursorPosition ){
+            assertions[totalKept++] = assertion;
+        } else {
+            releaseAssertion(assertion);
+            if ( i < assertionCursorIndex )
+                ++cursorOffset;
+        }
+    }
+    assertions.resize(totalKept);
+    m_assertionCursorIt = assertions.begin() + (assertionCursorIndex - cursorOffset);
+}
+
+inline void SegmentTrackTest::addDetectionFrames(size_t sequenceIndex, const SegmentAssertion* assertion){
+    if ( m_hasFrameBitmaps && assertion->result() != SegmentAssertion::UNMARKED )
+        m_detectionFrames[sequenceIndex].set(assertion->position(), assertion->length());
+}
+
+// Adds an assertion to the metrics of its sequence and returns what it added. Only the frames
+// within the sequence not counted by earlier assertions are added, and the frames of the
+// sequence's segments are added as false negatives with its first assertion, then moved to the
+// true positives as detections cover them.
+inline SegmentMetrics SegmentTrackTest::addSequenceMetrics(size_t sequenceIndex, const SegmentAssertion* assertion){
+    SegmentMetrics added;
+    added.add(assertion);
+
+    FrameCoverage& coverage = m_frameCoverage[sequenceIndex];
+    SegmentTrackView track  = trackView(sequenceIndex);
+    std::vector<size_t> segments;
+
+    VideoTime falseNegativeFrames = 0;
+    if ( !coverage.hasSegmentFrames ){
+        falseNegativeFrames += segmentFrames(track, 0, track.length(), segments);
+        coverage.hasSegmentFrames = true;
+    }
+
+    VideoTime truePositiveFrames  = 0;
+    VideoTime falsePositiveFrames = 0;
+    VideoTime end = std::min(assertion->position() + assertion->length(), track.length());
+    if ( assertion->result() != SegmentAssertion::UNMARKED && end > assertion->position() ){
+        std::vector<std::pair<VideoTime, VideoTime> > uncovered;
+        coverFrames(coverage.detected, assertion->position(), end, uncovered);
+        for ( size_t i = 0; i < uncovered.size(); ++i ){
+            VideoTime length   = uncovered[i].second - uncovered[i].first;
+            VideoTime detected = segmentFrames(track, uncovered[i].first, length, segments);
+            truePositiveFrames  += detected;
+            falsePositiveFrames += length - detected;
+            falseNegativeFrames -= detected;
+        }
+    }
+
+    added.addFrames(truePositiveFrames, falsePositiveFrames, falseNegativeFrames);
+    m_sequenceMetrics[sequenceIndex].add(added);
+    return added;
+}
+
+// Adds the frames a sequence's metrics gained since before to the total metrics, for assertions
+// added by workers, which only update the metrics of their sequence
+inline void SegmentTrackTest::addFrameTotals(const SegmentMetrics& before, size_t sequenceIndex){
+    const SegmentMetrics& after = m_sequenceMetrics[sequenceIndex];
+    m_metrics.addFrames(
+        after.truePositiveFrames() - before.truePositiveFrames(),
+        after.falsePositiveFrames() - before.falsePositiveFrames(),
+        after.falseNegativeFrames() - before.falseNegativeFrames()
+    );
+}
+
+// Number of frames in the range covered by at least one segment
+inline VideoTime SegmentTrackTest::segmentFrames(
+        const SegmentTrackView& track,
+        VideoTime position,
+        VideoTime length,
+        std::vector<size_t>& segments)
+{
+    segments.clear();
+    track.segmentsOverlapping(position, length, segments);
+
+    // segments come in order of their position, so the covered frames end at coveredEnd
+    VideoTime end        = position + length;
+    VideoTime coveredEnd = position;
+    VideoTime total      = 0;
+    for ( std::vector<size_t>::iterator it = segments.begin(); it != segments.end(); ++it ){
+        VideoTime segmentBegin = std::max(track.segmentPosition(*it), coveredEnd);
+        VideoTime segmentEnd   = std::min(track.segmentPosition(*it) + track.segmentLength(*it), end);
+        if ( segmentEnd > segmentBegin ){
+            total     += segmentEnd - segmentBegin;
+            coveredEnd = segmentEnd;
+        }
+    }
+    return total;
+}
+
+// Adds [begin, end) to the disjoint ranges in covered, merging the ones it overlaps or touches,
+// and sets uncovered to the parts of it that were not covered before
+inline void SegmentTrackTest::coverFrames(
+        std::map<VideoTime, VideoTime>& covered,
+        VideoTime begin,
+        VideoTime end,
+        std::vector<std::pair<VideoTime, VideoTime> >& uncovered)
+{
+    uncovered.clear();
+
+    std::map<VideoTime, VideoTime>::iterator it = covered.upper_bound(begin);
+    if ( it != covered.begin() ){
+        --it;
+        if ( it->second < begin )
+            ++it;
+    }
+
+    VideoTime mergedBegin = begin;
+    VideoTime mergedEnd   = end;
+    VideoTime cursor      = begin;
+    while ( it != covered.end() && it->first <= end ){
+        if ( it->first > cursor )
+            uncovered.push_back(std::make_pair(cursor, std::min(it->first, end)));
+        cursor      = std::max(cursor, it->second);
+        mergedBegin = std::min(mergedBegin, it->first);
+        mergedEnd   = std::max(mergedEnd, it->second);
+        covered.erase(it++);
+    }
+    if ( cursor < end )
+        uncovered.push_back(std::make_pair(cursor, end));
+
+    covered[mergedBegin] = mergedEnd;
+}
+
+inline void SegmentTrackTest::releaseAssertion(SegmentAssertion* assertion){
+    if ( assertion->hasSegment() && firstAssertionFor(m_cursorSequenceIndex, assertion->segmentIndex()) == assertion )
+        m_segmentAssertions[m_cursorSequenceIndex][assertion->segmentIndex()] = 0;
+    assertionPool(m_cursorSequenceIndex).destroy(assertion);
+    m_hasFreedAssertions = true;
+}
+
 inline void SegmentTrackTest::stamp(
     bool isSingle,
     VideoTime position,
@@ -826,148 +2320,488 @@ inline void SegmentTrackTest::stamp(
     const std::string &file,
     int lineNumber
 ){
-    SegmentTrack::SegmentConstIterator segmIt = m_cursorSegmentIt;
+    checkDetectionPosition(m_cursorSequenceIndex, position);
+    insertAssertion(
+        m_cursorSequenceIndex,
+        stampAssertion(
+            m_cursorSequenceIndex,
+            trackView(m_cursorSequenceIndex),
+            m_cursorSegmentIndex,
+            isSingle,
+            position,
+            info,
+            file,
+            lineNumber
+        )
+    );
+}
+
+template<typename Matcher> inline void SegmentTrackTest::overlap(
+    bool isSingle,
+    VideoTime position,
+    VideoTime length,
+    const Matcher& overlapParams,
+    const std::string &info,
+    const std::string &file,
+    int lineNumber
+){
+    checkDetectionPosition(m_cursorSequenceIndex, position);
+    insertAssertion(
+        m_cursorSequenceIndex,
+        overlapAssertion(
+            m_cursorSequenceIndex,
+            trackView(m_cursorSequenceIndex),
+            m_cursorSegmentIndex,
+            isSingle,
+            position,
+            length,
+            overlapParams,
+            info,
+            file,
+            lineNumber
+        )
+    );
+}
 
-    if ( m_cursorSequenceIt == data()->sequencesEnd() )
+inline void SegmentTrackTest::checkDetection(size_t sequenceIndex, const Detection& detection) const{
+    checkDetectionPosition(sequenceIndex, detection.position);
+    if ( detection.type == SegmentAssertion::UNMARKED_SEGMENT )
+        throw Exception("Unmarked segment is not a detection type.");
+}
+
+inline void SegmentTrackTest::checkDetectionPosition(size_t sequenceIndex, VideoTime position) const{
+    if ( sequenceIndex >= sequenceCount() )
         throw Exception("Current sequence is not set.");
-    if ( position >= (*m_cursorSequenceIt)->length() )
+    if ( position >= sequenceLength(sequenceIndex) )
         throw Exception("Position is not within the current sequence range.");
+}
 
-    while( findMatchedSegment(position, segmIt) ){
-        bool insert = true;
-        if ( !isSingle ){
-            SegmentAssertion* firstAssertion = firstAssertionFor(m_cursorSequenceIt, *segmIt);
-            if( firstAssertion != 0 )
-                if ( firstAssertion->type() == SegmentAssertion::SINGLE_STAMP )
-                    insert = false;
-        } else if ( !isUnmarked(m_cursorSequenceIt, *segmIt ) ){
-            insert = false;
-        }
-
-        if ( insert ){
-            insertAssertion(m_cursorSequenceIt, new SegmentAssertion(
-                position,
-                1,
-                SegmentAssertion::MATCH,
-                isSingle ? SegmentAssertion::SINGLE_STAMP : SegmentAssertion::MULTI_STAMP,
-                info,
-                file,
-                lineNumber,
-                *segmIt
-            ));
-            return;
-        }
-        ++segmIt;
-    }
+inline SegmentAssertion SegmentTrackTest::unmarkedAssertion(
+    const SegmentTrackView& track,
+    size_t segmentIndex,
+    const std::string& file,
+    int lineNumber
+) const{
+    SegmentAssertion assertion(
+        track.segmentPosition(segmentIndex),
+        track.segmentLength(segmentIndex),
+        SegmentAssertion::UNMARKED,
+        SegmentAssertion::UNMARKED_SEGMENT,
+        "",
+        file,
+        lineNumber
+    );
+    assertion.setSegment(track, segmentIndex);
+    return assertion;
+}
 
-    insertAssertion(m_cursorSequenceIt, new SegmentAssertion(
+inline SegmentAssertion SegmentTrackTest::stampAssertion(
+    size_t sequenceIndex,
+    const SegmentTrackView& track,
+    size_t segmentIndex,
+    bool isSingle,
+    VideoTime position,
+    const std::string &info,
+    const std::string &file,
+    int lineNumber
+) const{
+    SegmentAssertion assertion(
         position,
         1,
         SegmentAssertion::MISS,
         isSingle ? SegmentAssertion::SINGLE_STAMP : SegmentAssertion::MULTI_STAMP,
         info,
         file,
-        lineNumber,
-        0
-    ));
+        lineNumber
+    );
+
+    while( findMatchedSegment(track, position, segmentIndex) ){
+        if ( isAssignable(sequenceIndex, segmentIndex, isSingle) ){
+            assertion.m_result = SegmentAssertion::MATCH;
+            assertion.setSegment(track, segmentIndex);
+            return assertion;
+        }
+        ++segmentIndex;
+    }
+
+    return assertion;
 }
 
-inline void SegmentTrackTest::overlap(
+template<typename Matcher> inline SegmentAssertion SegmentTrackTest::overlapAssertion(
+    size_t sequenceIndex,
+    const SegmentTrackView& track,
+    size_t segmentIndex,
     bool isSingle,
     VideoTime position,
     VideoTime length,
-    const SegmentTrackTest::OverlapParameters& overlapParams,
+    const Matcher& overlapParams,
     const std::string &info,
     const std::string &file,
     int lineNumber
-){
-    SegmentTrack::SegmentConstIterator segmIt = m_cursorSegmentIt;
-
-    if ( m_cursorSequenceIt == data()->sequencesEnd() )
-        throw Exception("Current sequence is not set.");
-    if ( position >= (*m_cursorSequenceIt)->length() )
-        throw Exception("Position is not within the current sequence range.");
+) const{
+    SegmentAssertion assertion(
+        position,
+        length,
+        SegmentAssertion::MISS,
+        isSingle ? SegmentAssertion::SINGLE_STAMP : SegmentAssertion::MULTI_STAMP,
+        info,
+        file,
+        lineNumber
+    );
 
     VideoTime overlapLength  = 0;
     VideoTime missedLength   = 0;
     VideoTime unmarkedLength = 0;
 
-    while( findMatchedSegment(position, length, segmIt, overlapParams, overlapLength, missedLength, unmarkedLength) ){
-        bool insert = true;
-        if ( !isSingle ){
-            SegmentAssertion* firstAssertion = firstAssertionFor(m_cursorSequenceIt, *segmIt);
-            if( firstAssertion != 0 )
-                if ( firstAssertion->type() == SegmentAssertion::SINGLE_STAMP )
-                    insert = false;
-        } else if ( !isUnmarked(m_cursorSequenceIt, *segmIt ) ){
-            insert = false;
+    while( findMatchedSegment(track, position, length, segmentIndex, overlapParams, overlapLength, missedLength, unmarkedLength) ){
+        if ( isAssignable(sequenceIndex, segmentIndex, isSingle) ){
+            assertion.m_result = SegmentAssertion::MATCH;
+            assertion.setSegment(track, segmentIndex);
+            return assertion;
         }
+        ++segmentIndex;
+    }
 
-        if ( insert ){
-            insertAssertion(m_cursorSequenceIt, new SegmentAssertion(
-                position,
-                length,
-                SegmentAssertion::MATCH,
+    return assertion;
+}
+
+// Matches the detections of a sequence in order of their position against the segments starting
+// from segmentIndex in a single merge, and merges the new assertions after the assertion cursor.
+// The detections are checked by the caller. Overlap detections are tested by overlapMatcher, or
+// by their own parameters if it is 0. If the matcher throws, the sequence is left unchanged.
+template<typename Matcher> inline void SegmentTrackTest::evaluateDetections(
+    size_t sequenceIndex,
+    size_t segmentIndex,
+    size_t assertionCursorIndex,
+    const std::vector<Detection>& detections,
+    const Matcher* overlapMatcher,
+    std::vector<SegmentAssertion*>& created
+){
+    if ( detections.empty() )
+        return;
+
+    std::vector<const Detection*> sortedDetections;
+    sortedDetections.reserve(detections.size());
+    for ( std::vector<Detection>::const_iterator it = detections.begin(); it != detections.end(); ++it )
+        sortedDetections.push_back(&*it);
+    std::stable_sort(sortedDetections.begin(), sortedDetections.end(), &SegmentTrackTest::isDetectionBefore);
+
+    ObjectPool<SegmentAssertion>& pool = assertionPool(sequenceIndex);
+    SegmentTrackView track = trackView(sequenceIndex);
+    SegmentMerge merge(track, segmentIndex);
+
+    size_t createdStart = created.size();
+    std::vector<size_t> candidates;
+
+    // first assertions replaced in the index, restored if a matcher throws
+    std::vector<std::pair<size_t, SegmentAssertion*> > replaced;
+
+    try{
+        for ( std::vector<const Detection*>::iterator it = sortedDetections.begin(); it != sortedDetections.end(); ++it ){
+            const Detection* d = *it;
+            bool isSingle = d->type == SegmentAssertion::SINGLE_STAMP || d->type == SegmentAssertion::SINGLE_OVERLAP;
+            bool isStamp  = d->type == SegmentAssertion::SINGLE_STAMP || d->type == SegmentAssertion::MULTI_STAMP;
+
+            SegmentAssertion assertion(
+                d->position,
+                isStamp ? 1 : d->length,
+                SegmentAssertion::MISS,
                 isSingle ? SegmentAssertion::SINGLE_STAMP : SegmentAssertion::MULTI_STAMP,
-                info,
-                file,
-                lineNumber,
-                *segmIt
-            ));
-            return;
+                d->info,
+                d->file,
+                d->lineNumber
+            );
+
+            merge.overlapping(assertion.position(), assertion.length(), candidates);
+            for ( std::vector<size_t>::iterator cit = candidates.begin(); cit != candidates.end(); ++cit ){
+                if ( !isStamp ){
+                    VideoTime overlapLength = 0, missedLength = 0, unmarkedLength = 0;
+                    bool isMatch = overlapMatcher
+                        ? overlapMatcher->isMatch(
+                            d->position, d->length, track.segmentPosition(*cit), track.segmentLength(*cit),
+                            overlapLength, missedLength, unmarkedLength)
+                        : d->overlapParams.isMatch(
+                            d->position, d->length, track.segmentPosition(*cit), track.segmentLength(*cit),
+                            overlapLength, missedLength, unmarkedLength);
+                    if ( !isMatch )
+                        continue;
+                }
+                if ( !isAssignable(sequenceIndex, *cit, isSingle) )
+                    continue;
+
+                assertion.m_result = SegmentAssertion::MATCH;
+                assertion.setSegment(track, *cit);
+                break;
+            }
+
+            SegmentAssertion* createdAssertion = pool.create(assertion);
+            created.push_back(createdAssertion);
+            if ( createdAssertion->hasSegment() ){
+                replaced.push_back(std::make_pair(
+                    createdAssertion->segmentIndex(), firstAssertionFor(sequenceIndex, createdAssertion->segmentIndex())
+                ));
+            }
+            indexAssertion(sequenceIndex, createdAssertion);
         }
-        ++segmIt;
+    } catch ( ... ){
+        for ( size_t i = replaced.size(); i > 0; --i )
+            m_segmentAssertions[sequenceIndex][replaced[i - 1].first] = replaced[i - 1].second;
+        for ( size_t i = createdStart; i < created.size(); ++i )
+            pool.destroy(created[i]);
+        created.resize(createdStart);
+        throw;
     }
 
-    insertAssertion(m_cursorSequenceIt, new SegmentAssertion(
-        position,
-        length,
-        SegmentAssertion::MISS,
-        isSingle ? SegmentAssertion::SINGLE_STAMP : SegmentAssertion::MULTI_STAMP,
-        info,
-        file,
-        lineNumber,
-        0
-    ));
+    // later assertions go before earlier ones with the same position and length
+
+    std::vector<SegmentAssertion*> ordered(created.rbegin(), created.rend() - createdStart);
+    std::stable_sort(ordered.begin(), ordered.end(), &SegmentTrackTest::isAssertionBefore);
+
+    mergeAssertions(sequenceIndex, assertionCursorIndex, ordered);
 }
 
-inline bool SegmentTrackTest::findMatchedSegment(
-    VideoTime pos,
-    SegmentTrack::SegmentConstIterator& segmIt
+// Adds unmarked assertions for the segments starting from segmentIndex that have no assertion
+inline void SegmentTrackTest::markUnmarkedSegments(
+    size_t sequenceIndex,
+    size_t segmentIndex,
+    size_t assertionCursorIndex,
+    std::vector<SegmentAssertion*>& created,
+    const std::string& file,
+    int lineNumber
 ){
-    SegmentTrack* tr = static_cast<SegmentTrack*>((*m_cursorSequenceIt)->track(trackHeader()));
-    while ( segmIt != tr->end() ){
-        Segment* segm = *segmIt;
-        if ( segm->position() > pos ){
-            return false;
+    ObjectPool<SegmentAssertion>& pool = assertionPool(sequenceIndex);
+    SegmentTrackView track = trackView(sequenceIndex);
+
+    std::vector<SegmentAssertion*> ordered;
+    for ( ; segmentIndex < track.totalSegments(); ++segmentIndex ){
+        if ( isUnmarked(sequenceIndex, segmentIndex) ){
+            SegmentAssertion* assertion = pool.create(unmarkedAssertion(track, segmentIndex, file, lineNumber));
+            indexAssertion(sequenceIndex, assertion);
+            ordered.push_back(assertion);
         }
-        if ( segm->position() <= pos && segm->position() + segm->length() > pos )
-            return true;
-        ++segmIt;
     }
-    return false;
+
+    mergeAssertions(sequenceIndex, assertionCursorIndex, ordered);
+    created.insert(created.end(), ordered.begin(), ordered.end());
+}
+
+// Merges sorted assertions into the assertions after the cursor. New assertions go before
+// existing ones with the same position and length.
+inline void SegmentTrackTest::mergeAssertions(
+    size_t assertionVectorIndex,
+    size_t assertionCursorIndex,
+    const std::vector<SegmentAssertion*>& ordered
+){
+    if ( ordered.empty() )
+        return;
+
+    for ( AssertionConstIteartor it = ordered.begin(); it != ordered.end(); ++it ){
+        m_sequenceCounts[assertionVectorIndex].add(*it);
+        addSequenceMetrics(assertionVectorIndex, *it);
+        addDetectionFrames(assertionVectorIndex, *it);
+    }
+
+    std::vector<SegmentAssertion*>& assertions = m_assertions[assertionVectorIndex];
+
+    std::vector<SegmentAssertion*> merged;
+    merged.reserve(assertions.size() + ordered.size());
+    merged.insert(merged.end(), assertions.begin(), assertions.begin() + assertionCursorIndex);
+
+    AssertionIterator asIt = assertions.begin() + assertionCursorIndex;
+    AssertionConstIteartor newIt = ordered.begin();
+    while ( asIt != assertions.end() && newIt != ordered.end() ){
+        if ( isAssertionBefore(*asIt, *newIt) )
+            merged.push_back(*asIt++);
+        else
+            merged.push_back(*newIt++);
+    }
+    merged.insert(merged.end(), asIt, assertions.end());
+    merged.insert(merged.end(), newIt, ordered.end());
+
+    assertions.swap(merged);
+}
+
+// Follows evaluateDetections and markUnmarkedSegments for each of the overlap parameters,
+// keeping only the first assertion of each segment instead of the assertions
+template<typename Matcher> inline void SegmentTrackTest::sweepSequence(
+    size_t sequenceIndex,
+    const std::vector<Detection>& detections,
+    const std::vector<Matcher>& overlapParams,
+    std::vector<SegmentAssertionCounts>& counts
+) const{
+    std::vector<const Detection*> sortedDetections;
+    sortedDetections.reserve(detections.size());
+    for ( std::vector<Detection>::const_iterator it = detections.begin(); it != detections.end(); ++it ){
+        checkDetection(sequenceIndex, *it);
+        sortedDetections.push_back(&*it);
+    }
+    std::stable_sort(sortedDetections.begin(), sortedDetections.end(), &SegmentTrackTest::isDetectionBefore);
+
+    SegmentTrackView track = trackView(sequenceIndex);
+    size_t totalParams     = overlapParams.size();
+    SegmentMerge merge(track, 0);
+
+    // only segments that were candidates of a detection get a row of first assertions, one for
+    // each parameter set, the others stay unmarked for all of them
+    std::map<size_t, size_t>    segmentRows;
+    std::vector<FirstAssertion> firstAssertions;
+
+    std::vector<size_t>    candidates, candidateRows;
+    std::vector<VideoTime> overlapLengths, missedLengths, unmarkedLengths;
+    for ( std::vector<const Detection*>::iterator it = sortedDetections.begin(); it != sortedDetections.end(); ++it ){
+        const Detection* d = *it;
+        bool isSingle = d->type == SegmentAssertion::SINGLE_STAMP || d->type == SegmentAssertion::SINGLE_OVERLAP;
+        bool isStamp  = d->type == SegmentAssertion::SINGLE_STAMP || d->type == SegmentAssertion::MULTI_STAMP;
+        SegmentAssertion::AssertionType type = isSingle ? SegmentAssertion::SINGLE_STAMP : SegmentAssertion::MULTI_STAMP;
+        VideoTime length = isStamp ? 1 : d->length;
+
+        candidateRows.clear();
+        overlapLengths.clear();
+        missedLengths.clear();
+        unmarkedLengths.clear();
+        merge.overlapping(d->position, length, candidates);
+        if ( !isStamp ){
+            for ( std::vector<size_t>::iterator cit = candidates.begin(); cit != candidates.end(); ++cit ){
+                VideoTime overlapLength = 0, missedLength = 0, unmarkedLength = 0;
+                OverlapKernel::overlap(
+                    d->position, d->length, track.segmentPosition(*cit), track.segmentLength(*cit),
+                    overlapLength, missedLength, unmarkedLength
+                );
+                overlapLengths.push_back(overlapLength);
+                missedLengths.push_back(missedLength);
+                unmarkedLengths.push_back(unmarkedLength);
+            }
+        }
+
+        for ( std::vector<size_t>::iterator cit = candidates.begin(); cit != candidates.end(); ++cit ){
+            std::map<size_t, size_t>::iterator rowIt = segmentRows.find(*cit);
+            if ( rowIt == segmentRows.end() ){
+                rowIt = segmentRows.insert(std::make_pair(*cit, firstAssertions.size())).first;
+                firstAssertions.resize(firstAssertions.size() + totalParams);
+            }
+            candidateRows.push_back(rowIt->second);
+        }
+
+        for ( size_t p = 0; p < totalParams; ++p ){
+            FirstAssertion* matched = 0;
+            for ( size_t c = 0; c < candidates.size() && !matched; ++c ){
+                if ( !isStamp && !overlapParams[p].accepts(
+                        d->length, track.segmentLength(candidates[c]), overlapLengths[c], missedLengths[c], unmarkedLengths[c]) )
+                    continue;
+
+                FirstAssertion& first = firstAssertions[candidateRows[c] + p];
+                if ( isSingle ? !first.isSet : !(first.isSet && first.type == SegmentAssertion::SINGLE_STAMP) )
+                    matched = &first;
+            }
+
+            if ( !matched ){
+                counts[p].add(SegmentAssertion::MISS, type);
+                continue;
+            }
+
+            counts[p].add(SegmentAssertion::MATCH, type);
+            if ( !matched->isSet ||
+                 d->position < matched->position ||
+                 (d->position == matched->position && length <= matched->length) )
+            {
+                matched->isSet    = true;
+                matched->position = d->position;
+                matched->length   = length;
+                matched->type     = type;
+            }
+        }
+    }
+
+    for ( size_t p = 0; p < totalParams; ++p ){
+        size_t marked = 0;
+        for ( size_t row = 0; row < firstAssertions.size(); row += totalParams )
+            marked += firstAssertions[row + p].isSet ? 1 : 0;
+        counts[p].add(SegmentAssertion::UNMARKED, SegmentAssertion::UNMARKED_SEGMENT, track.totalSegments() - marked);
+    }
+}
+
+inline bool SegmentTrackTest::isDetectionBefore(const Detection* first, const Detection* second){
+    return first->position < second->position;
+}
+
+// Order of the assertion list: a new assertion goes before existing ones with the same position
+// and a greater or equal length
+inline bool SegmentTrackTest::isAssertionBefore(const SegmentAssertion* first, const SegmentAssertion* second){
+    if ( first->position() != second->position() )
+        return first->position() < second->position();
+    return first->length() < second->length();
+}
+
+inline bool SegmentTrackTest::findMatchedSegment(const SegmentTrackView& track, VideoTime pos, size_t& segmentIndex){
+    segmentIndex = track.nextIndexCovering(segmentIndex, pos);
+    return segmentIndex < track.totalSegments();
 }
 
 inline bool SegmentTrackTest::findMatchedSegment(
+    const SegmentTrackView& track,
     VideoTime pos,
     VideoTime length,
-    SegmentTrack::SegmentConstIterator& segmIt,
+    size_t& segmentIndex,
     const SegmentTrackTest::OverlapParameters& overlapParams,
     VideoTime &overlapLength,
     VideoTime &missedLength,
     VideoTime &unmarkedLength
 ){
-    SegmentTrack* tr = static_cast<SegmentTrack*>((*m_cursorSequenceIt)->track(trackHeader()));
-    while ( segmIt != tr->end() ){
-        Segment* segm = *segmIt;
-        if ( segm->position() >= pos + length )
-            return false;
+    OverlapKernel::Thresholds thresholds = overlapParams.thresholds();
+
+    // candidates are tested in blocks of consecutive segments, from the next one overlapping
+    size_t to = track.segmentIndexFrom(pos + length);
+    segmentIndex = track.nextIndexOverlapping(segmentIndex, pos, length);
+    while ( segmentIndex < track.totalSegments() ){
+        size_t count = to - segmentIndex;
+        if ( count > OverlapKernel::MAX_BLOCK_SIZE )
+            count = OverlapKernel::MAX_BLOCK_SIZE;
+
+        uint64_t mask = OverlapKernel::matchMask(
+            thresholds,
+            pos,
+            length,
+            track.segmentPositions() + segmentIndex,
+            track.segmentLengths() + segmentIndex,
+            count
+        );
+        if ( mask ){
+            segmentIndex += OverlapKernel::lowestBit(mask);
+            OverlapKernel::overlap(
+                pos,
+                length,
+                track.segmentPosition(segmentIndex),
+                track.segmentLength(segmentIndex),
+                overlapLength,
+                missedLength,
+                unmarkedLength
+            );
+            return true;
+        }
 
+        segmentIndex = track.nextIndexOverlapping(segmentIndex + count, pos, length);
+    }
+    return false;
+}
+
+// Tests the overlapping segments one at a time with a compile time matcher
+template<typename Matcher> inline bool SegmentTrackTest::findMatchedSegment(
+    const SegmentTrackView& track,
+    VideoTime pos,
+    VideoTime length,
+    size_t& segmentIndex,
+    const Matcher& overlapParams,
+    VideoTime &overlapLength,
+    VideoTime &missedLength,
+    VideoTime &unmarkedLength
+){
+    segmentIndex = track.nextIndexOverlapping(segmentIndex, pos, length);
+    while ( segmentIndex < track.totalSegments() ){
         if ( overlapParams.isMatch(
             pos,
             length,
-            segm->position(),
-            segm->length(),
+            track.segmentPosition(segmentIndex),
+            track.segmentLength(segmentIndex),
             overlapLength,
             missedLength,
             unmarkedLength
@@ -975,11 +2809,32 @@ inline bool SegmentTrackTest::findMatchedSegment(
             return true;
         }
 
-        ++segmIt;
+        segmentIndex = track.nextIndexOverlapping(segmentIndex + 1, pos, length);
     }
     return false;
 }
 
+// SegmentTrackTest::Detection Implementation
+// ------------------------------------------
+
+inline SegmentTrackTest::Detection::Detection(
+        SegmentAssertion::AssertionType pType,
+        VideoTime pPosition,
+        VideoTime pLength,
+        const SegmentTrackTest::OverlapParameters& pOverlapParams,
+        const std::string& pInfo,
+        const std::string& pFile,
+        int pLineNumber)
+    : type(pType)
+    , position(pPosition)
+    , length(pLength)
+    , overlapParams(pOverlapParams)
+    , info(pInfo)
+    , file(pFile)
+    , lineNumber(pLineNumber)
+{
+}
+
 // SegmentTrackTest::OverlapParameters Implementation
 // --------------------------------------------------
 
@@ -987,8 +2842,8 @@ inline SegmentTrackTest::OverlapParameters::OverlapParameters()
     : minOverlapLength(0)
     , maxMissedLength(0)
     , maxUnmarkedLength(0)
-    , minOverlapPercentToAssertion(0)
     , minOverlapPercentToSegment(0)
+    , minOverlapPercentToAssertion(0)
     , maxMissedPercent(0)
     , maxUnmarkedPercent(0)
 {
@@ -1003,50 +2858,72 @@ inline bool SegmentTrackTest::OverlapParameters::isMatch(
     VideoTime& missedLength,
     VideoTime& unmarkedLength
 ) const{
-    overlapLength  = 0;
-    missedLength   = 0;
-    unmarkedLength = 0;
-
-    if ( pos + length > segmPos && segmPos + segmLength > pos ){
-        VideoTime overlapStart = 0;
-        VideoTime overlapEnd   = 0;
-        if ( segmPos > pos ){
-            overlapStart = segmPos;
-            missedLength = segmPos - pos;
-        } else {
-            overlapStart   = pos;
-            unmarkedLength = pos - segmPos;
-        }
+    return overlap(pos, length, segmPos, segmLength, overlapLength, missedLength, unmarkedLength) &&
+           accepts(length, segmLength, overlapLength, missedLength, unmarkedLength);
+}
 
-        if ( segmPos + segmLength > pos + length ){
-            overlapEnd      = pos + length;
-            unmarkedLength += (segmPos + segmLength) - (pos + length);
-        } else {
-            overlapEnd    = segmPos + segmLength;
-            missedLength += (pos + length) - (segmPos + segmLength);
-        }
-        overlapLength = overlapEnd - overlapStart;
+// Batch form of isMatch() over a block of at most OverlapKernel::MAX_BLOCK_SIZE segments. Returns
+// the mask of matching segments.
+inline uint64_t SegmentTrackTest::OverlapParameters::matchMask(
+    VideoTime pos,
+    VideoTime length,
+    const VideoTime* segmPositions,
+    const VideoTime* segmLengths,
+    size_t count
+) const{
+    return OverlapKernel::matchMask(thresholds(), pos, length, segmPositions, segmLengths, count);
+}
 
-        if ( overlapLength < minOverlapLength )
-            return false;
-        if ( minOverlapPercentToAssertion > 0 && (double)overlapLength / length < minOverlapPercentToAssertion)
-            return false;
-        if ( minOverlapPercentToSegment > 0 && (double)overlapLength / segmLength < minOverlapPercentToSegment)
-            return false;
+inline OverlapKernel::Thresholds SegmentTrackTest::OverlapParameters::thresholds() const{
+    return OverlapKernel::Thresholds(
+        minOverlapLength,
+        maxMissedLength,
+        maxUnmarkedLength,
+        minOverlapPercentToSegment,
+        minOverlapPercentToAssertion,
+        maxMissedPercent,
+        maxUnmarkedPercent
+    );
+}
 
-        if ( maxMissedLength > 0 && missedLength > maxMissedLength )
-            return false;
-        if ( maxMissedPercent > 0 && (double)missedLength / length > maxMissedPercent )
-            return false;
+inline bool SegmentTrackTest::OverlapParameters::overlap(
+    VideoTime pos,
+    VideoTime length,
+    VideoTime segmPos,
+    VideoTime segmLength,
+    VideoTime& overlapLength,
+    VideoTime& missedLength,
+    VideoTime& unmarkedLength
+){
+    return OverlapKernel::overlap(pos, length, segmPos, segmLength, overlapLength, missedLength, unmarkedLength);
+}
 
-        if ( maxUnmarkedLength > 0 && unmarkedLength > maxUnmarkedLength )
-            return false;
-        if ( maxUnmarkedPercent > 0 && (double)unmarkedLength / segmLength > maxUnmarkedPercent)
-            return false;
+// Checks the lengths computed by overlap() against the thresholds
+inline bool SegmentTrackTest::OverlapParameters::accepts(
+    VideoTime length,
+    VideoTime segmLength,
+    VideoTime overlapLength,
+    VideoTime missedLength,
+    VideoTime unmarkedLength
+) const{
+    if ( overlapLength < minOverlapLength )
+        return false;
+    if ( minOverlapPercentToAssertion > 0 && (double)overlapLength / length < minOverlapPercentToAssertion)
+        return false;
+    if ( minOverlapPercentToSegment > 0 && (double)overlapLength / segmLength < minOverlapPercentToSegment)
+        return false;
+
+    if ( maxMissedLength > 0 && missedLength > maxMissedLength )
+        return false;
+    if ( maxMissedPercent > 0 && (double)missedLength / length > maxMissedPercent )
+        return false;
+
+    if ( maxUnmarkedLength > 0 && unmarkedLength > maxUnmarkedLength )
+        return false;
+    if ( maxUnmarkedPercent > 0 && (double)unmarkedLength / segmLength > maxUnmarkedPercent)
+        return false;
 
-        return true;
-    }
-    return false;
+    return true;
 }
 
 }// namespace
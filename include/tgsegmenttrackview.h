@@ -0,0 +1,255 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGSEGMENTTRACKVIEW_H
+#define TGSEGMENTTRACKVIEW_H
+
+#include "tgglobal.h"
+#include "tgsegment.h"
+#include "tgintervalindex.h"
+#include "tgbinaryformat.h"
+#include <vector>
+
+namespace tg{
+
+// Read-only view over the sorted segment arrays of a track. The arrays are owned elsewhere, either
+// by a SegmentTrack, as the cache of its segment keys, or by a mapped binary file, and segments are
+// addressed by their index.
+class SegmentTrackView{
+
+public:
+    SegmentTrackView();
+    SegmentTrackView(
+        VideoTime length,
+        size_t count,
+        const VideoTime* positions,
+        const VideoTime* lengths,
+        const VideoTime* maxEnds,
+        size_t indexLeaves
+    );
+
+    void setSegments(const Segment* const* segments);
+    void setSegmentData(const BinaryFormat::StringRef* dataRefs, const char* strings, size_t stringsSize);
+
+    VideoTime length() const;
+    size_t totalSegments() const;
+
+    VideoTime segmentPosition(size_t index) const;
+    VideoTime segmentLength(size_t index) const;
+    std::string segmentData(size_t index) const;
+    const Segment* segment(size_t index) const;
+    const VideoTime* segmentPositions() const;
+    const VideoTime* segmentLengths() const;
+
+    size_t segmentIndexFrom(VideoTime position) const;
+    size_t segmentIndexFrom(VideoTime position, VideoTime length) const;
+
+    // Interval Queries
+    // ----------------
+
+    size_t nextIndexCovering(size_t from, VideoTime position) const;
+    size_t nextIndexOverlapping(size_t from, VideoTime position, VideoTime length) const;
+
+    size_t segmentsCovering(VideoTime position, std::vector<size_t>& result) const;
+    size_t segmentsOverlapping(VideoTime position, VideoTime length, std::vector<size_t>& result) const;
+
+    static size_t lowerBound(const VideoTime* positions, size_t count, VideoTime position);
+
+private:
+    VideoTime        m_length;
+    size_t           m_count;
+    const VideoTime* m_positions;
+    const VideoTime* m_lengths;
+    const VideoTime* m_maxEnds;
+    size_t           m_indexLeaves;
+
+    // segment objects when viewing a SegmentTrack, segment data when viewing a binary file
+    const Segment* const*          m_segments;
+    const BinaryFormat::StringRef* m_dataRefs;
+    const char*                    m_strings;
+    size_t                         m_stringsSize;
+};
+
+inline SegmentTrackView::SegmentTrackView()
+    : m_length(0)
+    , m_count(0)
+    , m_positions(0)
+    , m_lengths(0)
+    , m_maxEnds(0)
+    , m_indexLeaves(0)
+    , m_segments(0)
+    , m_dataRefs(0)
+    , m_strings(0)
+    , m_stringsSize(0)
+{
+}
+
+inline SegmentTrackView::SegmentTrackView(
+        VideoTime length,
+        size_t count,
+        const VideoTime* positions,
+        const VideoTime* lengths,
+        const VideoTime* maxEnds,
+        size_t indexLeaves)
+    : m_length(length)
+    , m_count(count)
+    , m_positions(positions)
+    , m_lengths(lengths)
+    , m_maxEnds(maxEnds)
+    , m_indexLeaves(indexLeaves)
+    , m_segments(0)
+    , m_dataRefs(0)
+    , m_strings(0)
+    , m_stringsSize(0)
+{
+}
+
+inline void SegmentTrackView::setSegments(const Segment* const* segments){
+    m_segments = segments;
+}
+
+inline void SegmentTrackView::setSegmentData(
+        const BinaryFormat::StringRef* dataRefs,
+        const char* strings,
+        size_t stringsSize)
+{
+    m_dataRefs    = dataRefs;
+    m_strings     = strings;
+    m_stringsSize = stringsSize;
+}
+
+inline VideoTime SegmentTrackView::length() const{
+    return m_length;
+}
+
+inline size_t SegmentTrackView::totalSegments() const{
+    return m_count;
+}
+
+inline VideoTime SegmentTrackView::segmentPosition(size_t index) const{
+    return m_positions[index];
+}
+
+inline VideoTime SegmentTrackView::segmentLength(size_t index) const{
+    return m_lengths[index];
+}
+
+inline std::string SegmentTrackView::segmentData(size_t index) const{
+    if ( m_segments )
+        return m_segments[index]->data();
+    if ( !m_dataRefs )
+        return "";
+
+    const BinaryFormat::StringRef& ref = m_dataRefs[index];
+    if ( ref.offset > m_stringsSize || ref.length > m_stringsSize - ref.offset )
+        throw Exception("Binary data file is corrupted: string out of bounds.");
+    return std::string(m_strings + ref.offset, static_cast<size_t>(ref.length));
+}
+
+// Returns the segment object at the given index, or 0 for views that are not backed by segments
+inline const Segment* SegmentTrackView::segment(size_t index) const{
+    return m_segments ? m_segments[index] : 0;
+}
+
+inline const VideoTime* SegmentTrackView::segmentPositions() const{
+    return m_positions;
+}
+
+inline const VideoTime* SegmentTrackView::segmentLengths() const{
+    return m_lengths;
+}
+
+inline size_t SegmentTrackView::segmentIndexFrom(VideoTime position) const{
+    return lowerBound(m_positions, m_count, position);
+}
+
+inline size_t SegmentTrackView::segmentIndexFrom(VideoTime position, VideoTime length) const{
+    size_t index = segmentIndexFrom(position);
+    while ( index < m_count ){
+        if ( m_positions[index] != position )
+            return m_count;
+        if ( m_lengths[index] == length )
+            return index;
+        ++index;
+    }
+    return m_count;
+}
+
+inline size_t SegmentTrackView::nextIndexCovering(size_t from, VideoTime position) const{
+    size_t to    = segmentIndexFrom(position + 1);
+    size_t index = IntervalIndex::firstEndingAfter(m_maxEnds, m_indexLeaves, m_count, from, to, position);
+    return index < to ? index : m_count;
+}
+
+// Segments starting before position + length and ending after position, as in the overlap test
+// of SegmentTrackTest, so an empty range still gives the segments strictly containing position
+inline size_t SegmentTrackView::nextIndexOverlapping(size_t from, VideoTime position, VideoTime length) const{
+    size_t to    = segmentIndexFrom(position + length);
+    size_t index = IntervalIndex::firstEndingAfter(m_maxEnds, m_indexLeaves, m_count, from, to, position);
+    return index < to ? index : m_count;
+}
+
+inline size_t SegmentTrackView::segmentsCovering(VideoTime position, std::vector<size_t>& result) const{
+    size_t total = 0;
+    size_t index = nextIndexCovering(0, position);
+    while ( index < m_count ){
+        result.push_back(index);
+        ++total;
+        index = nextIndexCovering(index + 1, position);
+    }
+    return total;
+}
+
+inline size_t SegmentTrackView::segmentsOverlapping(
+        VideoTime position,
+        VideoTime length,
+        std::vector<size_t>& result) const
+{
+    size_t total = 0;
+    size_t index = nextIndexOverlapping(0, position, length);
+    while ( index < m_count ){
+        result.push_back(index);
+        ++total;
+        index = nextIndexOverlapping(index + 1, position, length);
+    }
+    return total;
+}
+
+// Returns the index of the first position that is not less than the given one
+inline size_t SegmentTrackView::lowerBound(const VideoTime* positions, size_t count, VideoTime position){
+    if ( count == 0 )
+        return 0;
+    if ( positions[count - 1] < position )
+        return count;
+
+    size_t first = 0;
+    while ( count > 0 ){
+        size_t half = count / 2;
+        if ( positions[first + half] < position ){
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return first;
+}
+
+} // namespace
+
+#endif // TGSEGMENTTRACKVIEW_H
@@ -25,6 +25,27 @@
 
 namespace tg {
 
+class Sequence;
+
+// Creates the tracks of a sequence on first access. Different sequences may be loaded from
+// several threads at the same time.
+class SequenceLoader{
+
+public:
+    SequenceLoader(){}
+    virtual ~SequenceLoader(){}
+
+    virtual void load(Sequence* seq, size_t index) = 0;
+
+protected:
+    static Track* appendLoadedTrack(Sequence* seq, TrackHeader* header);
+
+private:
+    // prevent copy
+    SequenceLoader(const SequenceLoader&);
+    SequenceLoader& operator = (const SequenceLoader&);
+};
+
 class Sequence{
 
 public:
@@ -42,12 +63,18 @@ public:
         , m_decoder("")
         , m_type(Video)
         , m_length(0)
+        , m_isLoaded(1)
+        , m_loader(0)
+        , m_loaderIndex(0)
     {}
     Sequence(const std::string& path, const std::string& decoder, Type type, VideoTime length)
         : m_path(path)
         , m_decoder(decoder)
         , m_type(type)
         , m_length(length)
+        , m_isLoaded(1)
+        , m_loader(0)
+        , m_loaderIndex(0)
     {}
     ~Sequence()
     {}
@@ -78,7 +105,14 @@ public:
     TrackIterator tracksEnd();
     TrackConstIterator tracksEnd() const;
 
+    void setLoader(SequenceLoader* loader, size_t index);
+    bool isLoaded() const;
+
 private:
+    friend class SequenceLoader;
+
+    void load() const;
+
     // prevent copy
     Sequence(const Sequence&);
     Sequence& operator = (const Sequence&);
@@ -91,8 +125,19 @@ private:
 
     std::vector<Track*> m_tracks;
 
+    // read and set atomically by const access, see isLoaded()
+    mutable int             m_isLoaded;
+    mutable SequenceLoader* m_loader;
+    size_t                  m_loaderIndex;
+    mutable cv::Mutex       m_loadMutex;
 };
 
+inline Track *SequenceLoader::appendLoadedTrack(Sequence *seq, TrackHeader *header){
+    Track* track = header->make(seq->m_length);
+    seq->m_tracks.push_back(track);
+    return track;
+}
+
 inline const std::string Sequence::path() const{
     return m_path;
 }
@@ -124,6 +169,7 @@ inline VideoTime Sequence::length() const{
 }
 
 inline size_t Sequence::totalTracks() const{
+    load();
     return m_tracks.size();
 }
 
@@ -165,6 +211,7 @@ inline const Track *Sequence::track(const TrackHeader *theader) const{
 }
 
 inline Track* Sequence::appendTrack(TrackHeader *header){
+    load();
     Track* track = header->make(m_length);
     m_tracks.push_back(track);
     return track;
@@ -181,27 +228,70 @@ inline void Sequence::removeTrack(TrackHeader *header){
 }
 
 inline void Sequence::clearTracks(){
+    m_isLoaded = 1;
     for ( TrackIterator it = tracksBegin(); it != tracksEnd(); ++it )
         delete *it;
     m_tracks.clear();
 }
 
 inline Sequence::TrackIterator Sequence::tracksBegin(){
+    load();
     return m_tracks.begin();
 }
 
 inline Sequence::TrackConstIterator Sequence::tracksBegin() const{
+    load();
     return m_tracks.begin();
 }
 
 inline Sequence::TrackIterator Sequence::tracksEnd(){
+    load();
     return m_tracks.end();
 }
 
 inline Sequence::TrackConstIterator Sequence::tracksEnd() const{
+    load();
     return m_tracks.end();
 }
 
+// Defers the creation of the tracks until they are first accessed. The index identifies the
+// sequence to the loader, which is no longer used once the sequence is loaded.
+inline void Sequence::setLoader(SequenceLoader *loader, size_t index){
+    clearTracks();
+    m_loader      = loader;
+    m_loaderIndex = index;
+    m_isLoaded    = loader == 0 ? 1 : 0;
+}
+
+// The flag is read with an atomic add, which is a full barrier, and load() sets it the same way
+// once the tracks are complete, so a thread that sees the sequence loaded also sees its tracks.
+inline bool Sequence::isLoaded() const{
+    return CV_XADD(&m_isLoaded, 0) != 0;
+}
+
+inline void Sequence::load() const{
+    if ( isLoaded() )
+        return;
+
+    cv::AutoLock lock(m_loadMutex);
+    if ( isLoaded() )
+        return;
+
+    Sequence* seq = const_cast<Sequence*>(this);
+    try{
+        m_loader->load(seq, m_loaderIndex);
+    } catch ( ... ){
+        for ( TrackIterator it = seq->m_tracks.begin(); it != seq->m_tracks.end(); ++it )
+            delete *it;
+        seq->m_tracks.clear();
+        throw;
+    }
+    for ( TrackIterator it = seq->m_tracks.begin(); it != seq->m_tracks.end(); ++it )
+        (*it)->buildIndex();
+    m_loader = 0;
+    CV_XADD(&m_isLoaded, 1);
+}
+
 } // namespace
 
 #endif // TGSEQUENCE_H
@@ -0,0 +1,292 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGSEQUENCELOADER_H
+#define TGSEQUENCELOADER_H
+
+#include "tgglobal.h"
+#include "tgsequence.h"
+#include "tgtrackheader.h"
+#include "tgsegmenttrack.h"
+#include "tgbinaryformat.h"
+#include "tgmappedfile.h"
+#include "tgyamlreader.h"
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+namespace tg{
+
+// Loads the tracks of sequences from a yaml data file. Only the position of each sequence's
+// 'Tracks' entry is kept in memory, and the file is opened again for each load.
+class YamlSequenceLoader : public SequenceLoader{
+
+public:
+    YamlSequenceLoader(const std::vector<TrackHeader*>& tracks, const std::string& path);
+
+    size_t addSequence(std::streamoff tracksOffset, size_t tracksLine);
+    void load(Sequence* seq, size_t index);
+
+    static void readTracks(YamlReader& reader, Sequence* seq, const std::vector<TrackHeader*>& tracks);
+    static void readSegments(YamlReader& reader, SegmentTrack* track);
+
+private:
+    const std::vector<TrackHeader*>& m_tracks;
+    std::string                      m_path;
+    std::vector<std::streamoff>      m_offsets;
+    std::vector<size_t>              m_lines;
+};
+
+// Loads the tracks of sequences from the shard files of a shard directory, one file per sequence.
+class ShardSequenceLoader : public SequenceLoader{
+
+public:
+    ShardSequenceLoader(const std::vector<TrackHeader*>& tracks, const std::string& directory);
+
+    size_t addSequence(const std::string& shard);
+    void load(Sequence* seq, size_t index);
+
+private:
+    const std::vector<TrackHeader*>& m_tracks;
+    std::string                      m_directory;
+    std::vector<std::string>         m_shards;
+};
+
+// Loads the tracks of sequences from a mapped binary data file.
+class BinarySequenceLoader : public SequenceLoader{
+
+public:
+    BinarySequenceLoader(const std::vector<TrackHeader*>& tracks);
+
+    bool open(const std::string& path);
+    const char* data() const;
+    size_t size() const;
+
+    void load(Sequence* seq, size_t index);
+
+    static void readTracks(
+        const char* data,
+        size_t size,
+        Sequence* seq,
+        size_t index,
+        const std::vector<TrackHeader*>& tracks
+    );
+
+private:
+    const std::vector<TrackHeader*>& m_tracks;
+    MappedFile                       m_file;
+};
+
+// YamlSequenceLoader
+// ------------------
+
+inline YamlSequenceLoader::YamlSequenceLoader(const std::vector<TrackHeader*>& tracks, const std::string& path)
+    : m_tracks(tracks)
+    , m_path(path)
+{
+}
+
+// Stores the position of the line holding a sequence's 'Tracks' key, returns the index to load
+// the sequence with
+inline size_t YamlSequenceLoader::addSequence(std::streamoff tracksOffset, size_t tracksLine){
+    m_offsets.push_back(tracksOffset);
+    m_lines.push_back(tracksLine);
+    return m_offsets.size() - 1;
+}
+
+inline void YamlSequenceLoader::load(Sequence *seq, size_t index){
+    std::ifstream in(m_path.c_str(), std::ios::in | std::ios::binary);
+    in.seekg(m_offsets[index]);
+    if ( !in )
+        throw Exception("Failed to read the tracks of sequence \'" + seq->path() + "\' from: " + m_path);
+
+    // the line may start with the sequence item or other keys of a flow mapping
+
+    YamlReader reader(in, m_lines[index] - 1);
+    YamlReader::Event event = reader.next();
+    if ( event == YamlReader::SEQUENCE_START )
+        event = reader.next();
+    if ( event != YamlReader::MAPPING_START )
+        reader.error("\'Sequence.Tracks\' not found.");
+
+    while ( reader.next() == YamlReader::SCALAR ){
+        if ( reader.value() == "Tracks" ){
+            if ( reader.next() != YamlReader::SEQUENCE_START )
+                reader.error("\'Sequence.Tracks\' is not an iterable type.");
+            readTracks(reader, seq, m_tracks);
+            return;
+        }
+        reader.skip(reader.next());
+    }
+    reader.error("\'Sequence.Tracks\' not found.");
+}
+
+// Reads the track entries following the start of a sequence's 'Tracks'
+inline void YamlSequenceLoader::readTracks(
+        YamlReader &reader,
+        Sequence *seq,
+        const std::vector<TrackHeader*> &tracks)
+{
+    YamlReader::Event event;
+    while ( (event = reader.next()) == YamlReader::MAPPING_START ){
+        Track* track = 0;
+        while ( reader.next() == YamlReader::SCALAR ){
+            if ( reader.value() == "Header" ){
+                size_t trackIndex = static_cast<size_t>(reader.readNumber("Sequence.Tracks.Header"));
+                if ( trackIndex >= tracks.size() ){
+                    std::stringstream errorStream;
+                    errorStream << "Out of bounds header index: " << trackIndex;
+                    throw Exception(errorStream.str());
+                }
+                if ( tracks[trackIndex]->type() != "Segment" )
+                    throw Exception("Type is not supported by the yaml reader: " + tracks[trackIndex]->type());
+                track = appendLoadedTrack(seq, tracks[trackIndex]);
+            } else if ( reader.value() == "Children" ){
+                if ( !track )
+                    reader.error("\'Header\' needs to be placed before \'Children\'.");
+                readSegments(reader, static_cast<SegmentTrack*>(track));
+            } else {
+                reader.skip(reader.next());
+            }
+        }
+    }
+    if ( event != YamlReader::SEQUENCE_END )
+        reader.error("\'Sequence.Tracks\' contains a value that is not a track.");
+}
+
+inline void YamlSequenceLoader::readSegments(YamlReader &reader, SegmentTrack *track){
+    if ( reader.next() != YamlReader::SEQUENCE_START )
+        reader.error("\'Segment.Track.Children\' is not iterable.");
+
+    YamlReader::Event event;
+    while ( (event = reader.next()) == YamlReader::MAPPING_START ){
+        VideoTime   position = 0;
+        VideoTime   length   = 0;
+        std::string data     = "";
+        while ( reader.next() == YamlReader::SCALAR ){
+            if ( reader.value() == "Pos" )
+                position = static_cast<VideoTime>(reader.readNumber("Segment.Pos"));
+            else if ( reader.value() == "Length" )
+                length = static_cast<VideoTime>(reader.readNumber("Segment.Length"));
+            else if ( reader.value() == "Data" )
+                data = reader.readScalar("Segment.Data");
+            else
+                reader.skip(reader.next());
+        }
+        track->loadSegment(position, length, data);
+    }
+    if ( event != YamlReader::SEQUENCE_END )
+        reader.error("\'Segment.Track.Children\' contains a value that is not a segment.");
+}
+
+// ShardSequenceLoader
+// -------------------
+
+inline ShardSequenceLoader::ShardSequenceLoader(const std::vector<TrackHeader*>& tracks, const std::string& directory)
+    : m_tracks(tracks)
+    , m_directory(directory)
+{
+}
+
+// Returns the index to load the sequence stored in the given shard with
+inline size_t ShardSequenceLoader::addSequence(const std::string &shard){
+    m_shards.push_back(shard);
+    return m_shards.size() - 1;
+}
+
+inline void ShardSequenceLoader::load(Sequence *seq, size_t index){
+    std::string path = m_directory + "/" + m_shards[index];
+    std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+    if ( !in.is_open() )
+        throw Exception("Failed to read the shard of sequence \'" + seq->path() + "\' from: " + path);
+
+    YamlReader reader(in);
+    if ( reader.next() != YamlReader::MAPPING_START )
+        reader.error("\'Tracks\' not found in shard: " + path);
+
+    while ( reader.next() == YamlReader::SCALAR ){
+        if ( reader.value() == "Tracks" ){
+            if ( reader.next() != YamlReader::SEQUENCE_START )
+                reader.error("\'Tracks\' is not an iterable type.");
+            YamlSequenceLoader::readTracks(reader, seq, m_tracks);
+            return;
+        }
+        reader.skip(reader.next());
+    }
+    reader.error("\'Tracks\' not found in shard: " + path);
+}
+
+// BinarySequenceLoader
+// --------------------
+
+inline BinarySequenceLoader::BinarySequenceLoader(const std::vector<TrackHeader*>& tracks)
+    : m_tracks(tracks)
+{
+}
+
+inline bool BinarySequenceLoader::open(const std::string &path){
+    return m_file.open(path);
+}
+
+inline const char *BinarySequenceLoader::data() const{
+    return m_file.data();
+}
+
+inline size_t BinarySequenceLoader::size() const{
+    return m_file.size();
+}
+
+inline void BinarySequenceLoader::load(Sequence *seq, size_t index){
+    readTracks(m_file.data(), m_file.size(), seq, index, m_tracks);
+}
+
+// Creates the segment tracks of the sequence at the given index in the file. The first tracks
+// need to match the file's track table.
+inline void BinarySequenceLoader::readTracks(
+        const char *data,
+        size_t size,
+        Sequence *seq,
+        size_t index,
+        const std::vector<TrackHeader*> &tracks)
+{
+    const BinaryFormat::FileHeader& header = BinaryFormat::header(data, size);
+    const BinaryFormat::SegmentTrackEntry* segmentTrackEntries =
+        BinaryFormat::section<BinaryFormat::SegmentTrackEntry>(
+            data, size, header.segmentTracksOffset, header.sequenceCount * header.trackCount
+        );
+
+    for ( size_t t = 0; t < header.trackCount; ++t ){
+        const BinaryFormat::SegmentTrackEntry& trackEntry = segmentTrackEntries[index * header.trackCount + t];
+
+        const VideoTime* positions =
+            BinaryFormat::section<VideoTime>(data, size, trackEntry.positionsOffset, trackEntry.count);
+        const VideoTime* lengths =
+            BinaryFormat::section<VideoTime>(data, size, trackEntry.lengthsOffset, trackEntry.count);
+        const BinaryFormat::StringRef* segmentData =
+            BinaryFormat::section<BinaryFormat::StringRef>(data, size, trackEntry.dataOffset, trackEntry.count);
+
+        SegmentTrack* track = static_cast<SegmentTrack*>(appendLoadedTrack(seq, tracks[t]));
+        track->reserveSegments(static_cast<size_t>(trackEntry.count));
+        for ( uint64_t s = 0; s < trackEntry.count; ++s )
+            track->loadSegment(positions[s], lengths[s], BinaryFormat::string(data, header, segmentData[s]));
+    }
+}
+
+} // namespace
+
+#endif // TGSEQUENCELOADER_H
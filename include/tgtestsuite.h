@@ -28,6 +28,12 @@ namespace tg{
 
 class TestSuite{
 
+public:
+    enum EvaluationMode{
+        SERIAL,
+        PARALLEL
+    };
+
 public:
     TestSuite(const DataFile* dataFile, const std::string& name);
     ~TestSuite();
@@ -35,6 +41,9 @@ public:
     void addTest(TrackTest* testSuite);
     const DataFile* dataFile() const;
 
+    void evaluate(EvaluationMode mode = PARALLEL);
+    SegmentMetrics segmentMetrics() const;
+
     void read(const cv::FileNode& node);
     void write(cv::FileStorage& fs) const;
 
@@ -53,6 +62,20 @@ public:
     );
 
 private:
+    class TestEvaluator : public cv::ParallelLoopBody{
+    public:
+        TestEvaluator(const std::vector<TrackTest*>& tests, std::vector<std::string>& errors)
+            : m_tests(tests)
+            , m_errors(errors)
+        {}
+
+        void operator()(const cv::Range& range) const;
+
+    private:
+        const std::vector<TrackTest*>& m_tests;
+        std::vector<std::string>&      m_errors;
+    };
+
     const DataFile* m_data;
     std::string m_name;
     std::vector<TrackTest*> m_tests;
@@ -78,6 +101,48 @@ inline const DataFile *TestSuite::dataFile() const{
     return m_data;
 }
 
+// Runs the evaluation queued on each test. In parallel mode each test runs on a worker thread.
+// Tests only read the data file, but subscribers attached to different tests may be notified
+// concurrently. Errors are reported for the first failing test in the order tests were added.
+inline void TestSuite::evaluate(EvaluationMode mode){
+    m_data->buildIndexes();
+
+    std::vector<std::string> errors(m_tests.size());
+    TestEvaluator evaluator(m_tests, errors);
+    if ( mode == PARALLEL )
+        cv::parallel_for_(cv::Range(0, (int)m_tests.size()), evaluator);
+    else
+        evaluator(cv::Range(0, (int)m_tests.size()));
+
+    for ( std::vector<std::string>::iterator it = errors.begin(); it != errors.end(); ++it ){
+        if ( !it->empty() )
+            throw Exception(*it);
+    }
+}
+
+// Metrics of the detections over all segment tracks tested
+inline SegmentMetrics TestSuite::segmentMetrics() const{
+    SegmentMetrics result;
+    for ( std::vector<TrackTest*>::const_iterator it = m_tests.begin(); it != m_tests.end(); ++it ){
+        const SegmentTrackTest* test = dynamic_cast<const SegmentTrackTest*>(*it);
+        if ( test )
+            result.add(test->metrics());
+    }
+    return result;
+}
+
+inline void TestSuite::TestEvaluator::operator()(const cv::Range& range) const{
+    for ( int i = range.start; i < range.end; ++i ){
+        try{
+            m_tests[i]->evaluate();
+        } catch ( tg::Exception& e ){
+            m_errors[i] = e.message();
+        } catch ( std::exception& e ){
+            m_errors[i] = e.what();
+        }
+    }
+}
+
 inline void TestSuite::read(const cv::FileNode &node){
     clearTests();
 
@@ -149,7 +214,7 @@ inline void TestSuite::clearTests(){
     m_tests.clear();
 }
 
-void TestSuite::draw(
+inline void TestSuite::draw(
     cv::Mat &dst,
     DataFile::SequenceIterator seqIt,
     VideoTime framePosition,
@@ -20,6 +20,7 @@
 #define TGTRACK_H
 
 #include "tgglobal.h"
+#include "tgyamlwriter.h"
 
 namespace tg{
 
@@ -41,6 +42,14 @@ public:
     virtual void write(cv::FileStorage& fs, size_t headerIndex) const = 0;
     virtual void read(const cv::FileNode& node) = 0;
 
+    // streaming output, for track types that support it
+    virtual void write(YamlWriter&, size_t) const{
+        throw Exception("Track type does not support the yaml writer.");
+    }
+
+    // builds any lookup structure the track would otherwise create lazily during const access
+    virtual void buildIndex() const{}
+
 private:
     Track();
     Track(const Track& other);
@@ -20,10 +20,27 @@
 #define TGTRACKHEADER_H
 
 #include "tgglobal.h"
+#include "tgyamlwriter.h"
 
 namespace tg{
 
 class Track;
+class Segment;
+
+// Receives the edits made to tracks. Indexes refer to the track's segments in their sorted order,
+// as they were before the edit for removals and coordinate changes.
+class TrackListener{
+
+public:
+    virtual ~TrackListener(){}
+
+    virtual void segmentInserted(const Track* track, size_t index, const Segment* segment) = 0;
+    virtual void segmentRemoved(const Track* track, size_t index) = 0;
+    virtual void segmentCoordsAssigned(const Track* track, size_t index, VideoTime position, VideoTime length) = 0;
+    virtual void segmentDataAssigned(const Track* track, size_t index, const std::string& data) = 0;
+    virtual void segmentsCleared(const Track* track) = 0;
+};
+
 class TrackHeader{
 
     // Factory Functions
@@ -68,6 +85,9 @@ public:
 
     static bool hasType(const std::string& type);
 
+    TrackListener* listener() const;
+    void setListener(TrackListener* listener);
+
     template<class T> static void registerType(const std::string& typeName){
         if ( !hasType(typeName) )
             registeredTypes().push_back(TrackFactory(typeName, &TrackFactory::make<T>));
@@ -75,6 +95,7 @@ public:
 
 
     void write(cv::FileStorage& fs) const;
+    void write(YamlWriter& writer) const;
     void read(const cv::FileNode& node);
 
 private:
@@ -84,6 +105,7 @@ private:
     std::string m_name;
     std::string m_type;
     TrackMakeFunction m_fp;
+    TrackListener* m_listener;
 };
 
 inline bool TrackHeader::hasType(const std::string &type){
@@ -100,6 +122,13 @@ inline void TrackHeader::write(cv::FileStorage &fs) const{
     fs << "}";
 }
 
+inline void TrackHeader::write(YamlWriter &writer) const{
+    writer.startMapping();
+    writer.write("Name", m_name);
+    writer.write("Type", m_type);
+    writer.endMapping();
+}
+
 inline void TrackHeader::read(const cv::FileNode &node){
     m_name = (std::string)(node["Name"]);
 }
@@ -108,6 +137,7 @@ inline TrackHeader::TrackHeader(const std::string &type, const std::string &name
     : m_name(name)
     , m_type(type)
     , m_fp(0)
+    , m_listener(0)
 {
     for ( std::vector<TrackFactory>::iterator it = registeredTypes().begin(); it != registeredTypes().end(); ++it ){
         if ( it->type == type){
@@ -120,6 +150,15 @@ inline TrackHeader::TrackHeader(const std::string &type, const std::string &name
 inline TrackHeader::~TrackHeader(){
 }
 
+inline TrackListener *TrackHeader::listener() const{
+    return m_listener;
+}
+
+// Tracks of this header report their edits to the listener
+inline void TrackHeader::setListener(TrackListener *listener){
+    m_listener = listener;
+}
+
 inline void TrackHeader::setName(const std::string& name){
     m_name = name;
 }
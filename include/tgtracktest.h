@@ -102,6 +102,9 @@ public:
     virtual void write(cv::FileStorage& fs) const = 0;
     virtual bool isEnd() const = 0;
 
+    // runs the evaluation queued on the test, may be called from a worker thread by TestSuite
+    virtual void evaluate(){}
+
     virtual void draw(
         cv::Mat& dst,
         DataFile::SequenceIterator seqIt,
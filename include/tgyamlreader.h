@@ -0,0 +1,502 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGYAMLREADER_H
+#define TGYAMLREADER_H
+
+#include "tgglobal.h"
+#include <istream>
+#include <sstream>
+#include <deque>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+namespace tg{
+
+// Event based reader for the yaml subset written by cv::FileStorage: block mappings and
+// sequences, flow collections on a single line, and plain or quoted scalars. The input is read
+// one line at a time, so memory use does not depend on the size of the document.
+//
+// Mappings produce the key as a SCALAR event followed by the events of its value.
+class YamlReader{
+
+public:
+    enum Event{
+        SCALAR,
+        MAPPING_START,
+        MAPPING_END,
+        SEQUENCE_START,
+        SEQUENCE_END,
+        DOCUMENT_END
+    };
+
+public:
+    YamlReader(std::istream& in, size_t lineNumber = 0);
+    ~YamlReader(){}
+
+    Event next();
+    const std::string& value() const;
+    size_t lineNumber() const;
+    std::streamoff lineOffset() const;
+
+    void skip(Event event);
+    std::string readScalar(const std::string& name);
+    double readNumber(const std::string& name);
+
+    void error(const std::string& message) const;
+
+private:
+    class Token{
+    public:
+        Token(Event pEvent, const std::string& pValue)
+            : event(pEvent)
+            , value(pValue)
+        {}
+
+        Event       event;
+        std::string value;
+    };
+
+    class Block{
+    public:
+        Block(bool pIsMapping, size_t pIndent)
+            : isMapping(pIsMapping)
+            , indent(pIndent)
+        {}
+
+        bool   isMapping;
+        size_t indent;
+    };
+
+    void parseLine(const std::string& line);
+    void parseNode(const std::string& line, size_t column);
+    void parseValue(const std::string& line, size_t i);
+    void parseFlow(const std::string& line, size_t& i);
+    std::string parseScalar(const std::string& line, size_t& i, const char* terminators);
+    void expectLineEnd(const std::string& line, size_t i);
+
+    bool isSequenceItem(const std::string& line, size_t column) const;
+    size_t findKeyEnd(const std::string& line, size_t column) const;
+    static size_t skipSpaces(const std::string& line, size_t i);
+
+    void closeBlocks(size_t indent, bool isSequenceItem);
+    void openBlock(bool isMapping, size_t indent);
+    void finish();
+    void push(Event event, const std::string& value = "");
+
+    // prevent copy
+    YamlReader(const YamlReader&);
+    YamlReader& operator = (const YamlReader&);
+
+    std::istream&      m_in;
+    size_t             m_lineNumber;
+    std::streamoff     m_lineOffset;
+    std::streamoff     m_nextLineOffset;
+    std::deque<Token>  m_tokens;
+    std::vector<Block> m_blocks;
+    std::string        m_value;
+    bool               m_isEnd;
+
+    // a key or sequence item without a value on its line, resolved by the next line
+    bool   m_hasPendingValue;
+    bool   m_isPendingKey;
+    size_t m_pendingIndent;
+};
+
+// Reading starts at the stream's current position. The line number is the number of lines before
+// that position, and is only used in error messages.
+inline YamlReader::YamlReader(std::istream& in, size_t lineNumber)
+    : m_in(in)
+    , m_lineNumber(lineNumber)
+    , m_lineOffset(0)
+    , m_nextLineOffset(0)
+    , m_isEnd(false)
+    , m_hasPendingValue(false)
+    , m_isPendingKey(false)
+    , m_pendingIndent(0)
+{
+    std::streampos position = m_in.tellg();
+    if ( position != std::streampos(-1) )
+        m_nextLineOffset = position;
+    m_lineOffset = m_nextLineOffset;
+}
+
+inline YamlReader::Event YamlReader::next(){
+    while ( m_tokens.empty() ){
+        if ( m_isEnd ){
+            m_value.clear();
+            return DOCUMENT_END;
+        }
+
+        std::string line;
+        if ( std::getline(m_in, line) ){
+            ++m_lineNumber;
+            m_lineOffset      = m_nextLineOffset;
+            m_nextLineOffset += static_cast<std::streamoff>(line.size() + 1);
+            if ( !line.empty() && line[line.size() - 1] == '\r' )
+                line.erase(line.size() - 1);
+            parseLine(line);
+        } else {
+            finish();
+        }
+    }
+
+    Event event = m_tokens.front().event;
+    m_value.swap(m_tokens.front().value);
+    m_tokens.pop_front();
+    return event;
+}
+
+inline const std::string& YamlReader::value() const{
+    return m_value;
+}
+
+inline size_t YamlReader::lineNumber() const{
+    return m_lineNumber;
+}
+
+// Stream position of the line the last event was read from
+inline std::streamoff YamlReader::lineOffset() const{
+    return m_lineOffset;
+}
+
+// Skips the value that starts with the given event
+inline void YamlReader::skip(Event event){
+    size_t depth = (event == MAPPING_START || event == SEQUENCE_START) ? 1 : 0;
+    while ( depth > 0 ){
+        switch( next() ){
+        case MAPPING_START:
+        case SEQUENCE_START: ++depth; break;
+        case MAPPING_END:
+        case SEQUENCE_END: --depth; break;
+        case DOCUMENT_END: error("Unexpected end of document."); break;
+        case SCALAR: break;
+        }
+    }
+}
+
+inline std::string YamlReader::readScalar(const std::string& name){
+    if ( next() != SCALAR )
+        error("\'" + name + "\' is not a scalar.");
+    return m_value;
+}
+
+inline double YamlReader::readNumber(const std::string& name){
+    std::string number = readScalar(name);
+    const char* begin  = number.c_str();
+    char* end          = 0;
+    double result      = std::strtod(begin, &end);
+    if ( number.empty() || *end != '\0' )
+        error("\'" + name + "\' is not a number: " + number);
+    return result;
+}
+
+inline void YamlReader::error(const std::string& message) const{
+    std::stringstream errorStream;
+    errorStream << "Yaml error at line " << m_lineNumber << ": " << message;
+    throw Exception(errorStream.str());
+}
+
+inline void YamlReader::parseLine(const std::string& line){
+    size_t indent = line.find_first_not_of(' ');
+    if ( indent == std::string::npos || line[indent] == '#' )
+        return;
+
+    // directives and document markers
+
+    if ( indent == 0 ){
+        if ( line[0] == '%' )
+            return;
+        if ( line.compare(0, 3, "---") == 0 || line.compare(0, 3, "...") == 0 ){
+            if ( skipSpaces(line, 3) == line.size() )
+                return;
+        }
+    }
+    if ( line[indent] == '\t' )
+        error("Tabs are not allowed for indentation.");
+
+    bool isItem = isSequenceItem(line, indent);
+
+    if ( m_hasPendingValue ){
+        m_hasPendingValue = false;
+        bool isNested = indent > m_pendingIndent || (isItem && m_isPendingKey && indent == m_pendingIndent);
+        if ( isNested && isItem ){
+            openBlock(false, indent);
+        } else if ( isNested && findKeyEnd(line, indent) != std::string::npos ){
+            openBlock(true, indent);
+        } else if ( isNested ){
+            parseValue(line, indent);
+            return;
+        } else {
+            push(SCALAR);
+        }
+    }
+
+    closeBlocks(indent, isItem);
+    parseNode(line, indent);
+}
+
+inline void YamlReader::parseNode(const std::string& line, size_t column){
+    if ( isSequenceItem(line, column) ){
+        if ( m_blocks.empty() || m_blocks.back().indent < column ){
+            openBlock(false, column);
+        } else if ( m_blocks.back().isMapping ){
+            error("Unexpected sequence item.");
+        }
+
+        size_t next = skipSpaces(line, column + 1);
+        if ( next == line.size() || line[next] == '#' ){
+            m_hasPendingValue = true;
+            m_isPendingKey    = false;
+            m_pendingIndent   = column;
+            return;
+        }
+        parseNode(line, next);
+        return;
+    }
+
+    size_t keyEnd = findKeyEnd(line, column);
+    if ( keyEnd == std::string::npos ){
+        if ( !m_blocks.empty() && m_blocks.back().indent >= column )
+            error("Expected a key or a sequence item.");
+        parseValue(line, column);
+        return;
+    }
+
+    if ( m_blocks.empty() || m_blocks.back().indent < column ){
+        if ( !m_blocks.empty() && m_blocks.back().isMapping )
+            error("Unexpected indentation.");
+        openBlock(true, column);
+    } else if ( !m_blocks.back().isMapping ){
+        error("Unexpected key in sequence.");
+    }
+
+    if ( line[column] == '\"' || line[column] == '\'' ){
+        size_t i = column;
+        push(SCALAR, parseScalar(line, i, ""));
+    } else {
+        size_t keyLast = keyEnd > column ? line.find_last_not_of(' ', keyEnd - 1) : std::string::npos;
+        push(SCALAR, keyLast < column || keyLast == std::string::npos ? "" : line.substr(column, keyLast - column + 1));
+    }
+
+    size_t next = skipSpaces(line, keyEnd + 1);
+    if ( next == line.size() || line[next] == '#' ){
+        m_hasPendingValue = true;
+        m_isPendingKey    = true;
+        m_pendingIndent   = column;
+        return;
+    }
+    parseValue(line, next);
+}
+
+inline void YamlReader::parseValue(const std::string& line, size_t i){
+    if ( line[i] == '[' || line[i] == '{' ){
+        parseFlow(line, i);
+    } else {
+        push(SCALAR, parseScalar(line, i, ""));
+    }
+    expectLineEnd(line, i);
+}
+
+inline void YamlReader::parseFlow(const std::string& line, size_t& i){
+    bool isMapping = line[i] == '{';
+    char close     = isMapping ? '}' : ']';
+    push(isMapping ? MAPPING_START : SEQUENCE_START);
+    ++i;
+
+    while ( true ){
+        i = skipSpaces(line, i);
+        if ( i == line.size() )
+            error("Flow collections spanning multiple lines are not supported.");
+        if ( line[i] == close ){
+            ++i;
+            push(isMapping ? MAPPING_END : SEQUENCE_END);
+            return;
+        }
+
+        if ( isMapping ){
+            push(SCALAR, parseScalar(line, i, ":,}"));
+            i = skipSpaces(line, i);
+            if ( i == line.size() || line[i] != ':' )
+                error("Expected \':\' in flow mapping.");
+            i = skipSpaces(line, i + 1);
+        }
+
+        if ( i < line.size() && (line[i] == '[' || line[i] == '{') )
+            parseFlow(line, i);
+        else
+            push(SCALAR, parseScalar(line, i, isMapping ? ",}" : ",]"));
+
+        i = skipSpaces(line, i);
+        if ( i < line.size() && line[i] == ',' )
+            ++i;
+        else if ( i == line.size() || line[i] != close )
+            error("Expected \',\' in flow collection.");
+    }
+}
+
+// Reads a quoted or plain scalar starting at i. Plain scalars end at any of the terminators, at a
+// comment or at the end of the line.
+inline std::string YamlReader::parseScalar(const std::string& line, size_t& i, const char* terminators){
+    std::string result;
+
+    if ( i < line.size() && line[i] == '\"' ){
+        for ( ++i; i < line.size() && line[i] != '\"'; ++i ){
+            if ( line[i] != '\\' ){
+                result += line[i];
+                continue;
+            }
+            if ( ++i == line.size() )
+                break;
+            switch( line[i] ){
+            case 'n':  result += '\n'; break;
+            case 't':  result += '\t'; break;
+            case 'r':  result += '\r'; break;
+            case '0':  result += '\0'; break;
+            case 'x':
+                if ( i + 2 < line.size() ){
+                    result += (char)std::strtol(line.substr(i + 1, 2).c_str(), 0, 16);
+                    i += 2;
+                }
+                break;
+            default:   result += line[i]; break;
+            }
+        }
+        if ( i >= line.size() )
+            error("Unterminated quoted scalar.");
+        ++i;
+        return result;
+    }
+
+    if ( i < line.size() && line[i] == '\'' ){
+        for ( ++i; i < line.size(); ++i ){
+            if ( line[i] == '\'' ){
+                if ( i + 1 < line.size() && line[i + 1] == '\'' ){
+                    result += '\'';
+                    ++i;
+                    continue;
+                }
+                break;
+            }
+            result += line[i];
+        }
+        if ( i >= line.size() )
+            error("Unterminated quoted scalar.");
+        ++i;
+        return result;
+    }
+
+    size_t start = i;
+    while ( i < line.size() ){
+        if ( std::strchr(terminators, line[i]) != 0 )
+            break;
+        if ( line[i] == '#' && i > start && line[i - 1] == ' ' )
+            break;
+        ++i;
+    }
+    if ( i == start )
+        return result;
+    size_t end = line.find_last_not_of(' ', i - 1);
+    if ( end == std::string::npos || end < start )
+        return result;
+    return line.substr(start, end - start + 1);
+}
+
+inline void YamlReader::expectLineEnd(const std::string& line, size_t i){
+    i = skipSpaces(line, i);
+    if ( i < line.size() && line[i] != '#' )
+        error("Unexpected characters after value: " + line.substr(i));
+}
+
+inline bool YamlReader::isSequenceItem(const std::string& line, size_t column) const{
+    return line[column] == '-' && (column + 1 == line.size() || line[column + 1] == ' ');
+}
+
+// Returns the position of the ':' ending the key that starts at column, or npos if the line has
+// no key
+inline size_t YamlReader::findKeyEnd(const std::string& line, size_t column) const{
+    size_t i = column;
+    if ( line[i] == '[' || line[i] == '{' )
+        return std::string::npos;
+
+    if ( line[i] == '\"' || line[i] == '\'' ){
+        char quote = line[i];
+        for ( ++i; i < line.size() && line[i] != quote; ++i ){
+            if ( quote == '\"' && line[i] == '\\' )
+                ++i;
+        }
+        i = skipSpaces(line, i + 1);
+        if ( i < line.size() && line[i] == ':' && (i + 1 == line.size() || line[i + 1] == ' ') )
+            return i;
+        return std::string::npos;
+    }
+
+    for ( ; i < line.size(); ++i ){
+        if ( line[i] == '#' && i > column && line[i - 1] == ' ' )
+            return std::string::npos;
+        if ( line[i] == ':' && (i + 1 == line.size() || line[i + 1] == ' ') )
+            return i;
+    }
+    return std::string::npos;
+}
+
+inline size_t YamlReader::skipSpaces(const std::string& line, size_t i){
+    while ( i < line.size() && line[i] == ' ' )
+        ++i;
+    return i;
+}
+
+// Closes the blocks nested deeper than the indent. A sequence on the same indent as its parent's
+// key is closed by the next line that is not one of its items.
+inline void YamlReader::closeBlocks(size_t indent, bool isSequenceItem){
+    while ( !m_blocks.empty() ){
+        const Block& block = m_blocks.back();
+        if ( block.indent < indent )
+            break;
+        if ( block.indent == indent && (block.isMapping || isSequenceItem) )
+            break;
+        push(block.isMapping ? MAPPING_END : SEQUENCE_END);
+        m_blocks.pop_back();
+    }
+}
+
+inline void YamlReader::openBlock(bool isMapping, size_t indent){
+    push(isMapping ? MAPPING_START : SEQUENCE_START);
+    m_blocks.push_back(Block(isMapping, indent));
+}
+
+inline void YamlReader::finish(){
+    if ( m_hasPendingValue ){
+        m_hasPendingValue = false;
+        push(SCALAR);
+    }
+    while ( !m_blocks.empty() ){
+        push(m_blocks.back().isMapping ? MAPPING_END : SEQUENCE_END);
+        m_blocks.pop_back();
+    }
+    m_isEnd = true;
+}
+
+inline void YamlReader::push(Event event, const std::string& value){
+    m_tokens.push_back(Token(event, value));
+}
+
+} // namespace
+
+#endif // TGYAMLREADER_H
@@ -0,0 +1,176 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef TGYAMLWRITER_H
+#define TGYAMLWRITER_H
+
+#include "tgglobal.h"
+#include <ostream>
+#include <vector>
+#include <cstdio>
+
+namespace tg{
+
+// Writes yaml in the block layout used by cv::FileStorage directly to a stream, keeping only the
+// nesting of the open collections in memory. Values inside a mapping are written with a key, and
+// values inside a sequence without one. The document root is a mapping.
+class YamlWriter{
+
+public:
+    YamlWriter(std::ostream& out);
+    ~YamlWriter(){}
+
+    void startMapping(const std::string& key = "");
+    void endMapping();
+    void startSequence(const std::string& key = "");
+    void endSequence();
+
+    void write(const std::string& key, const std::string& value);
+    void write(const std::string& key, VideoTime value);
+
+    static std::string quote(const std::string& value);
+
+private:
+    class Block{
+    public:
+        Block(bool pIsMapping)
+            : isMapping(pIsMapping)
+            , isEmpty(true)
+        {}
+
+        bool isMapping;
+        bool isEmpty;
+    };
+
+    void writeKey(const std::string& key);
+    void endBlock(bool isMapping);
+
+    // prevent copy
+    YamlWriter(const YamlWriter&);
+    YamlWriter& operator = (const YamlWriter&);
+
+    std::ostream&      m_out;
+    std::vector<Block> m_blocks;
+};
+
+inline YamlWriter::YamlWriter(std::ostream& out)
+    : m_out(out)
+{
+    m_out << "%YAML:1.0\n";
+    m_blocks.push_back(Block(true));
+    m_blocks.back().isEmpty = false;
+}
+
+inline void YamlWriter::startMapping(const std::string& key){
+    writeKey(key);
+    m_blocks.push_back(Block(true));
+}
+
+inline void YamlWriter::endMapping(){
+    endBlock(true);
+}
+
+inline void YamlWriter::startSequence(const std::string& key){
+    writeKey(key);
+    m_blocks.push_back(Block(false));
+}
+
+inline void YamlWriter::endSequence(){
+    endBlock(false);
+}
+
+inline void YamlWriter::write(const std::string& key, const std::string& value){
+    writeKey(key);
+    m_out << ' ' << quote(value) << '\n';
+}
+
+inline void YamlWriter::write(const std::string& key, VideoTime value){
+    writeKey(key);
+    m_out << ' ' << value << '\n';
+}
+
+// Returns the value as a plain scalar if it cannot be read as anything else, otherwise as a
+// double quoted scalar
+inline std::string YamlWriter::quote(const std::string& value){
+    bool isPlain = !value.empty() &&
+        ((value[0] >= 'a' && value[0] <= 'z') || (value[0] >= 'A' && value[0] <= 'Z') ||
+         value[0] == '_' || value[0] == '/') &&
+        value[value.size() - 1] != ' ';
+    for ( size_t i = 0; isPlain && i < value.size(); ++i ){
+        char c = value[i];
+        isPlain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                  c == '_' || c == '-' || c == '.' || c == '/' || c == ' ';
+    }
+    if ( isPlain )
+        return value;
+
+    std::string result = "\"";
+    for ( size_t i = 0; i < value.size(); ++i ){
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        switch( c ){
+        case '\"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\t': result += "\\t"; break;
+        case '\r': result += "\\r"; break;
+        default:
+            if ( c < 0x20 ){
+                char escaped[8];
+                std::sprintf(escaped, "\\x%02x", c);
+                result += escaped;
+            } else {
+                result += static_cast<char>(c);
+            }
+        }
+    }
+    result += '\"';
+    return result;
+}
+
+// Starts a new line for a value, which is keyed in mappings and an item in sequences
+inline void YamlWriter::writeKey(const std::string& key){
+    Block& block = m_blocks.back();
+    if ( block.isMapping && key.empty() )
+        throw Exception("Yaml writer: values inside a mapping need a key.");
+    if ( !block.isMapping && !key.empty() )
+        throw Exception("Yaml writer: values inside a sequence cannot have a key: " + key);
+
+    if ( block.isEmpty ){
+        m_out << '\n';
+        block.isEmpty = false;
+    }
+
+    m_out << std::string(3 * (m_blocks.size() - 1), ' ');
+    if ( block.isMapping )
+        m_out << quote(key) << ':';
+    else
+        m_out << '-';
+}
+
+inline void YamlWriter::endBlock(bool isMapping){
+    if ( m_blocks.size() < 2 || m_blocks.back().isMapping != isMapping )
+        throw Exception(isMapping ? "Yaml writer: no mapping to end." : "Yaml writer: no sequence to end.");
+
+    if ( m_blocks.back().isEmpty )
+        m_out << (isMapping ? " {}\n" : " []\n");
+    m_blocks.pop_back();
+}
+
+} // namespace
+
+#endif // TGYAMLWRITER_H
@@ -0,0 +1,283 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#include "catch.hpp"
+#include "datafiletestfixture.h"
+
+#include "tgdatafile.h"
+#include "tgsegment.h"
+#include "tgsegmenttrack.h"
+
+#include <sstream>
+#include <cstdio>
+
+using namespace tg;
+using namespace tgdatafile_test;
+
+namespace tgdatafilebinary_test{
+
+void createBinaryDataFile(DataFile& dfile){
+    createDataFile(dfile)->createSegment(20, 10, "second");
+    segmentTrack(dfile, 1, 1)->createSegment(1500, 500, "last");
+}
+
+// Counts the segments of every track from several threads, loading the sequences on first access
+class ConcurrentTrackAccess : public cv::ParallelLoopBody{
+
+public:
+    ConcurrentTrackAccess(const DataFile& dfile, std::vector<size_t>& totals)
+        : m_dfile(dfile)
+        , m_totals(totals)
+    {}
+
+    void operator()(const cv::Range& range) const{
+        for ( int i = range.start; i < range.end; ++i ){
+            for ( size_t s = 0; s < m_dfile.sequenceCount(); ++s )
+                for ( size_t t = 0; t < m_dfile.trackCount(); ++t )
+                    m_totals[i] += segmentTrack(m_dfile, s, t)->totalSegments();
+        }
+    }
+
+private:
+    const DataFile&      m_dfile;
+    std::vector<size_t>& m_totals;
+};
+
+TEST_CASE("Teground DataFile Binary Test", "[datafilebinarytestcase]"){
+
+    SECTION("Stream Round Trip"){
+        DataFile expected;
+        createBinaryDataFile(expected);
+
+        std::stringstream stream;
+        expected.writeBinary(stream);
+        std::string buffer = stream.str();
+
+        DataFile dfile;
+        dfile.readBinary(buffer.data(), buffer.size());
+        requireEqual(dfile, expected);
+    }
+
+    SECTION("File Round Trip"){
+        DataFile expected;
+        createBinaryDataFile(expected);
+
+        std::string path = std::string("tgdatafilebinarytest") + DataFile::binaryExtension();
+        REQUIRE(expected.writeTo(path));
+
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(path));
+        requireEqual(dfile, expected);
+
+        DataFile dfileBinary;
+        REQUIRE(dfileBinary.readFrom(path, DataFile::FORMAT_BINARY));
+        requireEqual(dfileBinary, expected);
+
+        std::remove(path.c_str());
+        REQUIRE_FALSE(dfile.readFrom(path));
+    }
+
+    SECTION("Lazy Loading"){
+        DataFile expected;
+        createBinaryDataFile(expected);
+
+        std::string path = std::string("tgdatafilebinarylazytest") + DataFile::binaryExtension();
+        REQUIRE(expected.writeTo(path));
+
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(path, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        REQUIRE(dfile.sequenceCount() == 2);
+        REQUIRE(dfile.sequenceAt(1)->path() == "sequence2");
+        REQUIRE_FALSE(dfile.sequenceAt(0)->isLoaded());
+        REQUIRE_FALSE(dfile.sequenceAt(1)->isLoaded());
+
+        dfile.buildIndexes();
+        REQUIRE_FALSE(dfile.sequenceAt(1)->isLoaded());
+
+        const SegmentTrack* track = static_cast<const SegmentTrack*>(
+            dfile.sequenceFrom("sequence2")->track(dfile.trackAt(1))
+        );
+        REQUIRE(track->totalSegments() == 1);
+        REQUIRE((*track->begin())->data() == "last");
+        REQUIRE(dfile.sequenceAt(1)->isLoaded());
+        REQUIRE_FALSE(dfile.sequenceAt(0)->isLoaded());
+
+        requireEqual(dfile, expected);
+
+        Sequence* taken = dfile.takeSequence(dfile.sequenceAt(0));
+        REQUIRE(dfile.readFrom(path, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        REQUIRE(taken->totalTracks() == 2);
+        taken->clearTracks();
+        delete taken;
+
+        dfile.appendTrack("Segment", "Track3");
+        REQUIRE(dfile.sequenceAt(0)->totalTracks() == 3);
+        REQUIRE(static_cast<const SegmentTrack*>(dfile.sequenceAt(0)->track(dfile.trackAt(0)))->totalSegments() == 3);
+
+        std::remove(path.c_str());
+    }
+
+    SECTION("Lazy Loading - Write To Same Path"){
+        DataFile expected;
+        createBinaryDataFile(expected);
+
+        std::string path = std::string("tgdatafilebinarysamepathtest") + DataFile::binaryExtension();
+        REQUIRE(expected.writeTo(path));
+
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(path, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        REQUIRE_FALSE(dfile.sequenceAt(0)->isLoaded());
+        REQUIRE(dfile.writeTo(path));
+        requireEqual(dfile, expected);
+
+        DataFile result;
+        REQUIRE(result.readFrom(path, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        requireEqual(result, expected);
+
+        std::remove(path.c_str());
+    }
+
+    SECTION("Parallel Loading"){
+        DataFile expected;
+        createBinaryDataFile(expected);
+
+        std::string path = std::string("tgdatafilebinaryparalleltest") + DataFile::binaryExtension();
+        REQUIRE(expected.writeTo(path));
+
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(path, DataFile::FORMAT_AUTO, DataFile::LOAD_PARALLEL));
+        REQUIRE(dfile.sequenceAt(0)->isLoaded());
+        REQUIRE(dfile.sequenceAt(1)->isLoaded());
+        std::remove(path.c_str());
+
+        requireEqual(dfile, expected);
+    }
+
+    SECTION("Concurrent Lazy Loading"){
+        DataFile expected;
+        createBinaryDataFile(expected);
+
+        std::string path = std::string("tgdatafilebinaryconcurrenttest") + DataFile::binaryExtension();
+        REQUIRE(expected.writeTo(path));
+
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(path, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        REQUIRE_FALSE(dfile.sequenceAt(0)->isLoaded());
+
+        std::vector<size_t> totals(8, 0);
+        cv::parallel_for_(cv::Range(0, 8), ConcurrentTrackAccess(dfile, totals));
+        for ( size_t i = 0; i < totals.size(); ++i )
+            REQUIRE(totals[i] == 4);
+
+        requireEqual(dfile, expected);
+        std::remove(path.c_str());
+    }
+
+    SECTION("Corrupted Data"){
+        DataFile expected;
+        createBinaryDataFile(expected);
+
+        std::stringstream stream;
+        expected.writeBinary(stream);
+        std::string buffer = stream.str();
+
+        DataFile dfile;
+        REQUIRE_THROWS_AS(dfile.readBinary(buffer.data(), buffer.size() - 1), tg::Exception);
+        REQUIRE_THROWS_AS(dfile.readBinary(buffer.data(), 4), tg::Exception);
+
+        std::string corrupted = buffer;
+        BinaryFormat::FileHeader* header = reinterpret_cast<BinaryFormat::FileHeader*>(&corrupted[0]);
+        header->tracksOffset = buffer.size();
+        REQUIRE_THROWS_AS(dfile.readBinary(corrupted.data(), corrupted.size()), tg::Exception);
+
+        corrupted = buffer;
+        header = reinterpret_cast<BinaryFormat::FileHeader*>(&corrupted[0]);
+        header->version = BinaryFormat::VERSION + 1;
+        REQUIRE_THROWS_AS(dfile.readBinary(corrupted.data(), corrupted.size()), tg::Exception);
+    }
+
+    SECTION("Compressed Round Trip"){
+        DataFile expected;
+        createBinaryDataFile(expected);
+
+        std::stringstream stream;
+        expected.writeCompressed(stream);
+        std::string buffer = stream.str();
+
+        DataFile dfile;
+        dfile.readCompressed(buffer.data(), buffer.size());
+        requireEqual(dfile, expected);
+
+        std::string path = std::string("tgdatafilecompressedtest") + DataFile::compressedExtension();
+        REQUIRE(expected.writeTo(path));
+
+        DataFile dfileAuto;
+        REQUIRE(dfileAuto.readFrom(path));
+        requireEqual(dfileAuto, expected);
+
+        DataFile dfileCompressed;
+        REQUIRE(dfileCompressed.readFrom(path, DataFile::FORMAT_COMPRESSED, DataFile::LOAD_LAZY));
+        requireEqual(dfileCompressed, expected);
+        REQUIRE_THROWS_AS(dfileCompressed.readFrom(path, DataFile::FORMAT_BINARY), tg::Exception);
+
+        std::remove(path.c_str());
+    }
+
+    SECTION("Compressed Size"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track1");
+        Sequence* seq = new Sequence("sequence1", "StandardVideoDecoder", Sequence::Video, 100000);
+        dfile.appendSequence(seq);
+
+        SegmentTrack* track = static_cast<SegmentTrack*>(seq->track(theader));
+        for ( VideoTime i = 0; i < 1000; ++i )
+            track->createSegment(i * 10, 5, i % 2 ? "person" : "car");
+
+        std::stringstream binaryStream;
+        dfile.writeBinary(binaryStream);
+        std::stringstream compressedStream;
+        dfile.writeCompressed(compressedStream);
+        REQUIRE(compressedStream.str().size() * 10 < binaryStream.str().size());
+
+        DataFile decoded;
+        std::string buffer = compressedStream.str();
+        decoded.readCompressed(buffer.data(), buffer.size());
+        requireEqual(decoded, dfile);
+    }
+
+    SECTION("Compressed Corrupted Data"){
+        DataFile expected;
+        createBinaryDataFile(expected);
+
+        std::stringstream stream;
+        expected.writeCompressed(stream);
+        std::string buffer = stream.str();
+
+        DataFile dfile;
+        REQUIRE_THROWS_AS(dfile.readCompressed(buffer.data(), buffer.size() - 1), tg::Exception);
+        REQUIRE_THROWS_AS(dfile.readCompressed(buffer.data(), 4), tg::Exception);
+        REQUIRE_THROWS_AS(dfile.readCompressed((buffer + '\0').data(), buffer.size() + 1), tg::Exception);
+
+        std::string corrupted = buffer;
+        corrupted[CompressedFormat::MAGIC_SIZE] = static_cast<char>(CompressedFormat::VERSION + 1);
+        REQUIRE_THROWS_AS(dfile.readCompressed(corrupted.data(), corrupted.size()), tg::Exception);
+    }
+
+}
+
+} // namespace
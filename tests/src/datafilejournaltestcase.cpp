@@ -0,0 +1,220 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#include "catch.hpp"
+#include "datafiletestfixture.h"
+
+#include "tgdatafile.h"
+#include "tgjournalformat.h"
+#include "tgsegment.h"
+#include "tgsegmenttrack.h"
+
+#include <sstream>
+#include <cstdio>
+
+using namespace tg;
+using namespace tgdatafile_test;
+
+namespace tgdatafilejournal_test{
+
+// Makes one edit of each kind through the tracks and the file
+void editDataFile(DataFile& dfile){
+    SegmentTrack* track = segmentTrack(dfile, 0, 0);
+    track->createSegment(100, 10, "with space\nand %");
+    track->createSegment(5, 5, "");
+    track->removeSegment(track->begin() + 1);
+    track->assignSegmentCoords(track->begin(), 500, 20);
+    track->assignSegmentCoords(track->begin() + 1, 21, 50);
+    track->assignSegmentData(track->begin() + 1, "renamed label");
+
+    SegmentTrack* track2 = segmentTrack(dfile, 1, 1);
+    track2->createSegment(1500, 500, "last");
+    track2->clearSegments();
+
+    TrackHeader* theader = dfile.appendTrack("Segment", "Track 3");
+    static_cast<SegmentTrack*>(dfile.sequenceAt(1)->track(theader))->createSegment(0, 2000, "all");
+    dfile.removeTrack(dfile.trackAt(1));
+
+    dfile.appendSequence(new Sequence("/data/sequence 3.avi", "", Sequence::Video, 300));
+    dfile.moveSequence(dfile.sequenceAt(2), 0);
+    dfile.removeSequence(dfile.sequenceAt(2));
+    SegmentTrack* track3 = static_cast<SegmentTrack*>(dfile.sequenceAt(0)->track(theader));
+    track3->createSegment(1, 2);
+    track3->assignSegmentData(track3->begin(), "moved");
+}
+
+TEST_CASE("Teground DataFile Journal Test", "[datafilejournaltestcase]"){
+
+    std::string path        = std::string("tgdatafilejournaltest") + DataFile::binaryExtension();
+    std::string journalPath = path + JournalFormat::extension();
+
+    DataFile dfile;
+    createDataFile(dfile);
+    REQUIRE(dfile.writeTo(path));
+    std::remove(journalPath.c_str());
+
+    SECTION("Replay"){
+        REQUIRE(dfile.openJournal(path));
+        editDataFile(dfile);
+        dfile.closeJournal();
+        REQUIRE(readFile(journalPath).find(JournalFormat::header()) == 0);
+
+        DataFile expected;
+        createDataFile(expected);
+        editDataFile(expected);
+        requireEqual(dfile, expected);
+
+        DataFile replayed;
+        REQUIRE(replayed.readFrom(path));
+        requireEqual(replayed, expected);
+
+        DataFile replayedLazy;
+        REQUIRE(replayedLazy.readFrom(path, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        requireEqual(replayedLazy, expected);
+
+        // edits are recorded after the replayed ones
+        REQUIRE(replayed.openJournal(path));
+        replayed.clearSequences();
+        replayed.closeJournal();
+
+        DataFile cleared;
+        REQUIRE(cleared.readFrom(path));
+        REQUIRE(cleared.trackCount() == expected.trackCount());
+        REQUIRE(cleared.sequenceCount() == 0);
+    }
+
+    SECTION("Compaction"){
+        std::string yamlPath        = "tgdatafilejournaltest.yml";
+        std::string yamlJournalPath = yamlPath + JournalFormat::extension();
+        REQUIRE(dfile.writeTo(yamlPath));
+        std::remove(yamlJournalPath.c_str());
+
+        DataFile edited;
+        REQUIRE(edited.readFrom(yamlPath, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        REQUIRE(edited.openJournal(yamlPath));
+        editDataFile(edited);
+        std::string records = readFile(yamlJournalPath);
+
+        REQUIRE(edited.compactJournal());
+        REQUIRE(edited.isJournalOpen());
+        REQUIRE(readFile(yamlJournalPath) == std::string(JournalFormat::header()) + "\n");
+
+        DataFile expected;
+        createDataFile(expected);
+        editDataFile(expected);
+
+        DataFile compacted;
+        REQUIRE(compacted.readFrom(yamlPath));
+        requireEqual(compacted, expected);
+
+        // interrupted after the data file was replaced, the records before the marker are skipped
+        std::string contents = readFile(yamlPath);
+        std::stringstream marker;
+        marker << "K " << JournalFormat::hash(contents.data(), contents.size()) << "\n";
+        writeFile(yamlJournalPath, records + marker.str());
+        REQUIRE(compacted.readFrom(yamlPath));
+        requireEqual(compacted, expected);
+
+        // interrupted before the data file was replaced, all records are replayed
+        REQUIRE(dfile.writeTo(yamlPath));
+        REQUIRE(compacted.readFrom(yamlPath));
+        requireEqual(compacted, expected);
+
+        edited.closeJournal();
+        REQUIRE_FALSE(edited.compactJournal());
+
+        std::remove(yamlPath.c_str());
+        std::remove(yamlJournalPath.c_str());
+    }
+
+    SECTION("Save While Journaling"){
+        std::string yamlPath        = "tgdatafilejournalsavetest.yml";
+        std::string yamlJournalPath = yamlPath + JournalFormat::extension();
+        std::string paths[] = { path, yamlPath };
+
+        for ( size_t i = 0; i < 2; ++i ){
+            DataFile expected;
+            createDataFile(expected);
+            editDataFile(expected);
+
+            std::string savedJournalPath = paths[i] + JournalFormat::extension();
+            REQUIRE(dfile.writeTo(paths[i]));
+            std::remove(savedJournalPath.c_str());
+
+            DataFile edited;
+            REQUIRE(edited.readFrom(paths[i], DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+            REQUIRE(edited.openJournal(paths[i]));
+            editDataFile(edited);
+
+            // the saved file holds the edits, so they are not replayed again
+            REQUIRE(edited.writeTo(paths[i]));
+            REQUIRE(edited.isJournalOpen());
+            REQUIRE(readFile(savedJournalPath) == std::string(JournalFormat::header()) + "\n");
+
+            DataFile saved;
+            REQUIRE(saved.readFrom(paths[i]));
+            requireEqual(saved, expected);
+
+            // edits after saving are journaled on top of the saved file
+            SegmentTrack* editedTrack = segmentTrack(edited, 1, 0);
+            editedTrack->removeSegment(editedTrack->begin());
+            segmentTrack(expected, 1, 0)->removeSegment(segmentTrack(expected, 1, 0)->begin());
+            edited.closeJournal();
+            REQUIRE(saved.readFrom(paths[i]));
+            REQUIRE(segmentTrack(saved, 1, 0)->totalSegments() == 2);
+            requireEqual(saved, expected);
+        }
+
+        // saving elsewhere keeps the journal of the file
+        REQUIRE(dfile.openJournal(path));
+        segmentTrack(dfile, 0, 0)->createSegment(0, 1);
+        REQUIRE(dfile.writeTo(yamlPath));
+        REQUIRE(readFile(journalPath) != std::string(JournalFormat::header()) + "\n");
+        dfile.closeJournal();
+
+        std::remove(yamlPath.c_str());
+        std::remove(yamlJournalPath.c_str());
+    }
+
+    SECTION("Interrupted Records"){
+        REQUIRE(dfile.openJournal(path));
+        segmentTrack(dfile, 1, 1)->createSegment(0, 10);
+        dfile.closeJournal();
+
+        std::string records = readFile(journalPath);
+        writeFile(journalPath, records + "I 1 1 20 10 torn");
+
+        DataFile replayed;
+        REQUIRE(replayed.readFrom(path));
+        requireEqual(replayed, dfile);
+
+        writeFile(journalPath, records + "I 1 2 20 10 %\n");
+        REQUIRE_THROWS_AS(replayed.readFrom(path), tg::Exception);
+        writeFile(journalPath, records + "R 1 1 1\n");
+        REQUIRE_THROWS_AS(replayed.readFrom(path), tg::Exception);
+        writeFile(journalPath, records + "I 1 1 20 10 %2\n");
+        REQUIRE_THROWS_AS(replayed.readFrom(path), tg::Exception);
+        writeFile(journalPath, std::string("tgjournal 0\n"));
+        REQUIRE_THROWS_AS(replayed.readFrom(path), tg::Exception);
+    }
+
+    std::remove(path.c_str());
+    std::remove(journalPath.c_str());
+}
+
+} // namespace
@@ -0,0 +1,196 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#include "catch.hpp"
+#include "datafiletestfixture.h"
+
+#include "tgdatafile.h"
+#include "tgjournalformat.h"
+#include "tgsegment.h"
+#include "tgsegmenttrack.h"
+
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace tg;
+using namespace tgdatafile_test;
+
+namespace tgdatafileshard_test{
+
+void makeDirectory(const std::string& path){
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0777);
+#endif
+}
+
+void removeDirectory(const std::string& path){
+    std::remove((path + "/" + DataFile::manifestName()).c_str());
+#ifdef _WIN32
+    _rmdir(path.c_str());
+#else
+    rmdir(path.c_str());
+#endif
+}
+
+std::string shardPath(const std::string& directory, const std::string& sequencePath){
+    std::stringstream result;
+    result << directory << "/" << std::hex << std::setw(16) << std::setfill('0')
+           << JournalFormat::hash(sequencePath.data(), sequencePath.size()) << ".yml";
+    return result.str();
+}
+
+bool fileExists(const std::string& path){
+    return std::ifstream(path.c_str()).is_open();
+}
+
+TEST_CASE("Teground DataFile Shard Test", "[datafileshardtestcase]"){
+
+    std::string directory = "tgdatafileshardtest";
+    makeDirectory(directory);
+    std::remove((directory + "/" + DataFile::manifestName()).c_str());
+
+    DataFile missing;
+    REQUIRE_FALSE(missing.readFrom(directory, DataFile::FORMAT_SHARDED));
+
+    DataFile expected;
+    createDataFile(expected, 1000, 2000, "/data/sequence 2.avi");
+    segmentTrack(expected, 1, 1)->createSegment(1500, 500, "last: \"quoted\"");
+    REQUIRE(expected.writeTo(directory, DataFile::FORMAT_SHARDED));
+    REQUIRE(expected.shardDirectory() == directory);
+    REQUIRE(fileExists(directory + "/" + DataFile::manifestName()));
+    REQUIRE(fileExists(shardPath(directory, "sequence1")));
+    REQUIRE(fileExists(shardPath(directory, "/data/sequence 2.avi")));
+
+    SECTION("Round Trip"){
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(directory));
+        REQUIRE(dfile.sequenceAt(0)->isLoaded());
+        requireEqual(dfile, expected);
+
+        DataFile dfileLazy;
+        REQUIRE(dfileLazy.readFrom(directory, DataFile::FORMAT_SHARDED, DataFile::LOAD_LAZY));
+        REQUIRE_FALSE(dfileLazy.sequenceAt(0)->isLoaded());
+        REQUIRE_FALSE(dfileLazy.sequenceAt(1)->isLoaded());
+        REQUIRE(segmentTrack(dfileLazy, 1, 1)->totalSegments() == 1);
+        REQUIRE_FALSE(dfileLazy.sequenceAt(0)->isLoaded());
+        requireEqual(dfileLazy, expected);
+
+        DataFile dfileParallel;
+        REQUIRE(dfileParallel.readFrom(directory, DataFile::FORMAT_AUTO, DataFile::LOAD_PARALLEL));
+        requireEqual(dfileParallel, expected);
+    }
+
+    SECTION("Dirty Shards"){
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(directory, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        segmentTrack(dfile, 0, 1)->createSegment(0, 5, "new");
+
+        // a clean shard is neither loaded nor written again
+        std::string cleanShard = shardPath(directory, "/data/sequence 2.avi");
+        {
+            std::ofstream out(cleanShard.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            out << "Tracks:\n"
+                << "   - { Header: 0, Children: [] }\n"
+                << "   - { Header: 1, Children: [ { Pos: 7, Length: 8, Data: edited } ] }\n";
+        }
+        REQUIRE(dfile.writeTo(directory));
+        REQUIRE_FALSE(dfile.sequenceAt(1)->isLoaded());
+
+        DataFile result;
+        REQUIRE(result.readFrom(directory));
+        REQUIRE(segmentTrack(result, 0, 1)->totalSegments() == 1);
+        REQUIRE((*segmentTrack(result, 0, 1)->begin())->data() == "new");
+        REQUIRE(segmentTrack(result, 1, 1)->segmentPosition(0) == 7);
+
+        // edits the file is not notified of
+        (*segmentTrack(dfile, 1, 1)->begin())->setData("set");
+        REQUIRE(dfile.writeTo(directory));
+        REQUIRE(result.readFrom(directory));
+        REQUIRE((*segmentTrack(result, 1, 1)->begin())->data() == "edited");
+
+        dfile.markShardDirty(dfile.sequenceAt(1));
+        REQUIRE(dfile.writeTo(directory));
+        REQUIRE(result.readFrom(directory));
+        REQUIRE((*segmentTrack(result, 1, 1)->begin())->data() == "set");
+
+        // track edits change every shard
+        dfile.appendTrack("Segment", "Track3");
+        REQUIRE(dfile.writeTo(directory));
+        REQUIRE(result.readFrom(directory));
+        requireEqual(result, dfile);
+    }
+
+    SECTION("Sequence Edits"){
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(directory, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        dfile.removeSequence(dfile.sequenceAt(0));
+        dfile.appendSequence(new Sequence("sequence3", "", Sequence::Video, 100));
+        dfile.appendSequence(new Sequence("sequence3", "", Sequence::Video, 200));
+        segmentTrack(dfile, 2, 0)->createSegment(0, 200);
+        dfile.moveSequence(dfile.sequenceAt(2), 0);
+        REQUIRE(dfile.writeTo(directory));
+
+        REQUIRE_FALSE(fileExists(shardPath(directory, "sequence1")));
+        REQUIRE(fileExists(shardPath(directory, "sequence3")));
+
+        DataFile result;
+        REQUIRE(result.readFrom(directory));
+        requireEqual(result, dfile);
+        REQUIRE(result.sequenceAt(0)->length() == 200);
+
+        // another directory gets every shard
+        std::string copyDirectory = directory + "copy";
+        makeDirectory(copyDirectory);
+        REQUIRE(result.writeTo(copyDirectory, DataFile::FORMAT_SHARDED));
+        DataFile copy;
+        REQUIRE(copy.readFrom(copyDirectory, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        requireEqual(copy, dfile);
+        copy.clearSequences();
+        REQUIRE(copy.writeTo(copyDirectory));
+        REQUIRE_FALSE(fileExists(shardPath(copyDirectory, "sequence3")));
+        removeDirectory(copyDirectory);
+
+        dfile.clearSequences();
+        REQUIRE(dfile.writeTo(directory));
+    }
+
+    SECTION("Missing Shard"){
+        std::remove(shardPath(directory, "sequence1").c_str());
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(directory, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        REQUIRE_THROWS_AS(dfile.sequenceAt(0)->totalTracks(), tg::Exception);
+        REQUIRE_THROWS_AS(dfile.readFrom(directory), tg::Exception);
+    }
+
+    expected.clearSequences();
+    REQUIRE(expected.writeTo(directory));
+    removeDirectory(directory);
+}
+
+} // namespace
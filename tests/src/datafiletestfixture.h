@@ -0,0 +1,108 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#ifndef DATAFILETESTFIXTURE_H
+#define DATAFILETESTFIXTURE_H
+
+#include "catch.hpp"
+
+#include "tgdatafile.h"
+#include "tgsegment.h"
+#include "tgsegmenttrack.h"
+
+#include <sstream>
+#include <fstream>
+
+namespace tgdatafile_test{
+
+inline tg::SegmentTrack* segmentTrack(tg::DataFile& dfile, size_t sequence, size_t track){
+    return static_cast<tg::SegmentTrack*>(dfile.sequenceAt(sequence)->track(dfile.trackAt(track)));
+}
+
+inline const tg::SegmentTrack* segmentTrack(const tg::DataFile& dfile, size_t sequence, size_t track){
+    return static_cast<const tg::SegmentTrack*>(dfile.sequenceAt(sequence)->track(dfile.trackAt(track)));
+}
+
+// Appends the segment tracks "Track1" and "Track2", a video and an image sequence, and the
+// segments shared by the data file tests to "Track1" of the first sequence, which is returned for
+// the segments of each test
+inline tg::SegmentTrack* createDataFile(
+        tg::DataFile& dfile,
+        tg::VideoTime length = 1000,
+        tg::VideoTime length2 = 2000,
+        const std::string& path2 = "sequence2")
+{
+    dfile.appendTrack("Segment", "Track1");
+    dfile.appendTrack("Segment", "Track2");
+    dfile.appendSequence(new tg::Sequence("sequence1", "StandardVideoDecoder", tg::Sequence::Video, length));
+    dfile.appendSequence(new tg::Sequence(path2, "ImageDecoder", tg::Sequence::Image, length2));
+
+    tg::SegmentTrack* track = segmentTrack(dfile, 0, 0);
+    track->createSegment(20, 50, "first");
+    track->createSegment(10, 30);
+    return track;
+}
+
+inline void requireEqual(const tg::DataFile& dfile, const tg::DataFile& expected){
+    REQUIRE(dfile.trackCount() == expected.trackCount());
+    for ( size_t i = 0; i < expected.trackCount(); ++i ){
+        REQUIRE(dfile.trackAt(i)->name() == expected.trackAt(i)->name());
+        REQUIRE(dfile.trackAt(i)->type() == expected.trackAt(i)->type());
+    }
+
+    REQUIRE(dfile.sequenceCount() == expected.sequenceCount());
+    for ( size_t i = 0; i < expected.sequenceCount(); ++i ){
+        const tg::Sequence* seq         = dfile.sequenceAt(i);
+        const tg::Sequence* expectedSeq = expected.sequenceAt(i);
+        REQUIRE(seq->path() == expectedSeq->path());
+        REQUIRE(seq->decoder() == expectedSeq->decoder());
+        REQUIRE(seq->type() == expectedSeq->type());
+        REQUIRE(seq->length() == expectedSeq->length());
+
+        for ( size_t t = 0; t < expected.trackCount(); ++t ){
+            const tg::SegmentTrack* track         = segmentTrack(dfile, i, t);
+            const tg::SegmentTrack* expectedTrack = segmentTrack(expected, i, t);
+            REQUIRE(track->totalSegments() == expectedTrack->totalSegments());
+            for ( size_t s = 0; s < expectedTrack->totalSegments(); ++s ){
+                const tg::Segment* segm         = *(track->begin() + s);
+                const tg::Segment* expectedSegm = *(expectedTrack->begin() + s);
+                REQUIRE(segm->position() == expectedSegm->position());
+                REQUIRE(segm->length() == expectedSegm->length());
+                REQUIRE(segm->data() == expectedSegm->data());
+                REQUIRE(track->segmentPosition(s) == segm->position());
+                REQUIRE(track->segmentLength(s) == segm->length());
+            }
+        }
+    }
+}
+
+inline std::string readFile(const std::string& path){
+    std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+    std::stringstream stream;
+    stream << in.rdbuf();
+    return stream.str();
+}
+
+inline void writeFile(const std::string& path, const std::string& contents){
+    std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out << contents;
+}
+
+} // namespace
+
+#endif // DATAFILETESTFIXTURE_H
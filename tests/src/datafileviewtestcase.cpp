@@ -0,0 +1,182 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#include "catch.hpp"
+#include "datafiletestfixture.h"
+
+#include "tgdatafile.h"
+#include "tgdatafileview.h"
+#include "tgsegmenttrack.h"
+#include "tgsegmenttracktest.h"
+
+#include <sstream>
+#include <cstdio>
+
+using namespace tg;
+using namespace tgdatafile_test;
+
+namespace tgdatafileview_test{
+
+std::vector<size_t> segmentIndexes(const SegmentTrack* track, const std::vector<Segment*>& segments){
+    std::vector<size_t> result;
+    for ( std::vector<Segment*>::const_iterator it = segments.begin(); it != segments.end(); ++it )
+        result.push_back(track->findSegment(*it) - track->begin());
+    return result;
+}
+
+void evaluateDetections(SegmentTrackTest& test){
+    SegmentTrackTest::OverlapParameters params;
+    params.minOverlapLength = 5;
+
+    test.singleStamp(25);
+    test.multiStamp(25);
+    test.singleOverlap(55, 20, params);
+    test.singleStamp(90);
+    test.advanceCursorSequence(1);
+    test.multiOverlap(35, 10, params);
+    test.advanceCursorSequence(2);
+}
+
+TEST_CASE("Teground DataFile View Test", "[datafileviewtestcase]"){
+
+    DataFile dfile;
+    SegmentTrack* track = createDataFile(dfile, 200, 100);
+    track->createSegment(20, 10, "second");
+    track->createSegment(60, 5);
+    track->createSegment(120, 40, "third");
+    segmentTrack(dfile, 1, 0)->createSegment(30, 20);
+    segmentTrack(dfile, 1, 1)->createSegment(50, 50, "last");
+
+    std::stringstream stream;
+    dfile.writeBinary(stream);
+    std::string buffer = stream.str();
+
+    SECTION("Tables"){
+        DataFileView view;
+        REQUIRE_FALSE(view.isOpen());
+        view.assign(buffer.data(), buffer.size());
+        REQUIRE(view.isOpen());
+
+        REQUIRE(view.trackCount() == 2);
+        REQUIRE(view.trackName(1) == "Track2");
+        REQUIRE(view.trackType(1) == "Segment");
+        REQUIRE(view.trackIndex("Track2") == 1);
+        REQUIRE(view.trackIndex("Track3") == 2);
+
+        REQUIRE(view.sequenceCount() == 2);
+        REQUIRE(view.sequenceAt(1).path() == "sequence2");
+        REQUIRE(view.sequenceAt(1).decoder() == "ImageDecoder");
+        REQUIRE(view.sequenceAt(1).type() == Sequence::Image);
+        REQUIRE(view.sequenceAt(1).length() == 100);
+
+        SegmentTrackView trackView = view.sequenceAt(0).track(0);
+        REQUIRE(trackView.totalSegments() == 5);
+        REQUIRE(trackView.segmentPosition(1) == 20);
+        REQUIRE(trackView.segmentLength(1) == 10);
+        REQUIRE(trackView.segmentData(1) == "second");
+        REQUIRE(trackView.segment(1) == 0);
+        REQUIRE(view.sequenceAt(1).track(1).segmentData(0) == "last");
+
+        view.close();
+        REQUIRE_FALSE(view.isOpen());
+        REQUIRE(view.sequenceCount() == 0);
+    }
+
+    SECTION("Track Queries"){
+        DataFileView view;
+        view.assign(buffer.data(), buffer.size());
+
+        const SegmentTrack* track = static_cast<const SegmentTrack*>(dfile.sequenceAt(0)->track(dfile.trackAt(0)));
+        SegmentTrackView trackView = view.sequenceAt(0).track(0);
+        SegmentTrackView memoryView = track->view();
+        REQUIRE(memoryView.segment(2) == *(track->begin() + 2));
+
+        for ( VideoTime position = 0; position < 200; position += 5 ){
+            REQUIRE(trackView.segmentIndexFrom(position) == (size_t)(track->segmentFrom(position) - track->begin()));
+
+            std::vector<Segment*> covering;
+            std::vector<size_t> coveringIndexes;
+            track->segmentsCovering(position, covering);
+            trackView.segmentsCovering(position, coveringIndexes);
+            REQUIRE(coveringIndexes == segmentIndexes(track, covering));
+
+            std::vector<Segment*> overlapping;
+            std::vector<size_t> overlappingIndexes;
+            track->segmentsOverlapping(position, 15, overlapping);
+            trackView.segmentsOverlapping(position, 15, overlappingIndexes);
+            REQUIRE(overlappingIndexes == segmentIndexes(track, overlapping));
+        }
+
+        REQUIRE(trackView.segmentIndexFrom(20, 50) == 2);
+        REQUIRE(trackView.segmentIndexFrom(20, 40) == trackView.totalSegments());
+    }
+
+    SECTION("Segment Track Test"){
+        DataFileView view;
+        view.assign(buffer.data(), buffer.size());
+
+        SegmentTrackTest expected(&dfile, dfile.trackAt(0));
+        evaluateDetections(expected);
+
+        SegmentTrackTest test(&view, 0);
+        evaluateDetections(test);
+        REQUIRE(test.isEnd());
+
+        REQUIRE(test.countAssertions(SegmentAssertion::MATCH) == expected.countAssertions(SegmentAssertion::MATCH));
+        REQUIRE(test.countAssertions(SegmentAssertion::MISS) == expected.countAssertions(SegmentAssertion::MISS));
+        REQUIRE(test.countAssertions(SegmentAssertion::UNMARKED) == expected.countAssertions(SegmentAssertion::UNMARKED));
+        REQUIRE(expected.countAssertions(SegmentAssertion::MATCH) == 4);
+        REQUIRE(expected.countAssertions(SegmentAssertion::MISS) == 1);
+        REQUIRE(expected.countAssertions(SegmentAssertion::UNMARKED) == 2);
+
+        REQUIRE_THROWS_AS(SegmentTrackTest(&view, 2), tg::Exception);
+        DataFileView closedView;
+        REQUIRE_THROWS_AS(SegmentTrackTest(&closedView, 0), tg::Exception);
+    }
+
+    SECTION("Mapped File"){
+        std::string path = std::string("tgdatafileviewtest") + DataFile::binaryExtension();
+        REQUIRE(dfile.writeTo(path));
+
+        DataFileView view;
+        REQUIRE(view.open(path));
+        REQUIRE(view.sequenceCount() == 2);
+        REQUIRE(view.sequenceAt(0).track(0).segmentData(4) == "third");
+        view.close();
+
+        std::remove(path.c_str());
+        REQUIRE_FALSE(view.open(path));
+    }
+
+    SECTION("Corrupted Data"){
+        DataFileView view;
+        REQUIRE_THROWS_AS(view.assign(buffer.data(), buffer.size() - 1), tg::Exception);
+        REQUIRE_FALSE(view.isOpen());
+
+        std::string corrupted = buffer;
+        const BinaryFormat::FileHeader* header = reinterpret_cast<const BinaryFormat::FileHeader*>(buffer.data());
+        BinaryFormat::SegmentTrackEntry* entry = reinterpret_cast<BinaryFormat::SegmentTrackEntry*>(
+            &corrupted[0] + header->segmentTracksOffset
+        );
+        entry->count = 1000;
+        REQUIRE_THROWS_AS(view.assign(corrupted.data(), corrupted.size()), tg::Exception);
+    }
+
+}
+
+} // namespace
@@ -0,0 +1,555 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 Everseen Ltd.
+**
+** Concept, design and implementation by Dinu SV
+** (contact: mail@dinusv.com)
+** This file is part of Teground library.
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+****************************************************************************/
+
+#include "catch.hpp"
+
+#include "tgdatafile.h"
+#include "tgyamlreader.h"
+#include "tgyamlwriter.h"
+#include "tgsegmenttrack.h"
+
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+
+using namespace tg;
+
+namespace tgdatafileyaml_test{
+
+// layout written by cv::FileStorage for DataFile::write
+const char* dataFileYaml =
+    "%YAML:1.0\n"
+    "TeGround:\n"
+    "   Tracks:\n"
+    "      -\n"
+    "         Name: Track1\n"
+    "         Type: Segment\n"
+    "      -\n"
+    "         Name: \"Track 2\"\n"
+    "         Type: Segment\n"
+    "   Sequences:\n"
+    "      -\n"
+    "         Path: \"/data/sequence1.avi\"\n"
+    "         Type: Video\n"
+    "         Length: 1000.\n"
+    "         Decoder: StandardVideoDecoder\n"
+    "         Tracks:\n"
+    "            -\n"
+    "               Header: 0.\n"
+    "               Children:\n"
+    "                  -\n"
+    "                     Pos: 20.\n"
+    "                     Length: 50.\n"
+    "                     Data: first\n"
+    "                  -\n"
+    "                     Pos: 10.\n"
+    "                     Length: 30.\n"
+    "                     Data: \"\"\n"
+    "            -\n"
+    "               Header: 1.\n"
+    "               Children: []\n"
+    "      -\n"
+    "         Path: sequence2\n"
+    "         Type: Image\n"
+    "         Length: 2.0000000000000000e+03\n"
+    "         Decoder: ImageDecoder\n"
+    "         Tracks:\n"
+    "            -\n"
+    "               Header: 1.\n"
+    "               Children:\n"
+    "                  -\n"
+    "                     Pos: 1500.\n"
+    "                     Length: 500.\n"
+    "                     Data: \"last: \\\"quoted\\\"\"\n";
+
+// track type the streaming reader does not support, loaded through cv::FileStorage
+class LabelTrack : public Track{
+
+public:
+    LabelTrack(TrackHeader* header, VideoTime length) : Track(header, length){}
+
+    void write(cv::FileStorage& fs, size_t headerIndex) const{
+        fs << "{" << "Header" << (double)headerIndex << "Label" << label << "}";
+    }
+    void read(const cv::FileNode& node){
+        label = (std::string)node["Label"];
+    }
+
+    std::string label;
+};
+
+void readDataFile(DataFile& dfile, const std::string& yaml){
+    std::stringstream stream(yaml);
+    dfile.readYaml(stream);
+}
+
+std::vector<YamlReader::Event> readEvents(const std::string& yaml, std::vector<std::string>& scalars){
+    std::stringstream stream(yaml);
+    YamlReader reader(stream);
+
+    std::vector<YamlReader::Event> events;
+    YamlReader::Event event;
+    while ( (event = reader.next()) != YamlReader::DOCUMENT_END ){
+        events.push_back(event);
+        if ( event == YamlReader::SCALAR )
+            scalars.push_back(reader.value());
+    }
+    return events;
+}
+
+TEST_CASE("Teground Yaml Reader Test", "[datafileyamltestcase]"){
+
+    SECTION("Block Collections"){
+        std::vector<std::string> scalars;
+        std::vector<YamlReader::Event> events = readEvents(
+            "%YAML 1.0\n"
+            "---\n"
+            "a: 1\n"
+            "b:\n"
+            "- x # comment\n"
+            "- 'it''s'\n"
+            "c:\n"
+            "   -\n"
+            "      d: \"tab\\tend\"\n"
+            "   - e: f\n"
+            "     g:\n",
+            scalars
+        );
+
+        YamlReader::Event expected[] = {
+            YamlReader::MAPPING_START,
+                YamlReader::SCALAR, YamlReader::SCALAR,
+                YamlReader::SCALAR, YamlReader::SEQUENCE_START,
+                    YamlReader::SCALAR, YamlReader::SCALAR,
+                YamlReader::SEQUENCE_END,
+                YamlReader::SCALAR, YamlReader::SEQUENCE_START,
+                    YamlReader::MAPPING_START, YamlReader::SCALAR, YamlReader::SCALAR, YamlReader::MAPPING_END,
+                    YamlReader::MAPPING_START,
+                        YamlReader::SCALAR, YamlReader::SCALAR, YamlReader::SCALAR, YamlReader::SCALAR,
+                    YamlReader::MAPPING_END,
+                YamlReader::SEQUENCE_END,
+            YamlReader::MAPPING_END
+        };
+        REQUIRE(events == std::vector<YamlReader::Event>(expected, expected + sizeof(expected) / sizeof(expected[0])));
+
+        const char* expectedScalars[] = { "a", "1", "b", "x", "it's", "c", "d", "tab\tend", "e", "f", "g", "" };
+        REQUIRE(scalars == std::vector<std::string>(expectedScalars, expectedScalars + 12));
+    }
+
+    SECTION("Flow Collections"){
+        std::vector<std::string> scalars;
+        std::vector<YamlReader::Event> events = readEvents("a: [ 1, { b:2, c: \"3, 4\" }, [] ]\n", scalars);
+
+        YamlReader::Event expected[] = {
+            YamlReader::MAPPING_START,
+                YamlReader::SCALAR, YamlReader::SEQUENCE_START,
+                    YamlReader::SCALAR,
+                    YamlReader::MAPPING_START,
+                        YamlReader::SCALAR, YamlReader::SCALAR, YamlReader::SCALAR, YamlReader::SCALAR,
+                    YamlReader::MAPPING_END,
+                    YamlReader::SEQUENCE_START, YamlReader::SEQUENCE_END,
+                YamlReader::SEQUENCE_END,
+            YamlReader::MAPPING_END
+        };
+        REQUIRE(events == std::vector<YamlReader::Event>(expected, expected + sizeof(expected) / sizeof(expected[0])));
+
+        const char* expectedScalars[] = { "a", "1", "b", "2", "c", "3, 4" };
+        REQUIRE(scalars == std::vector<std::string>(expectedScalars, expectedScalars + 6));
+    }
+
+    SECTION("Errors"){
+        std::vector<std::string> scalars;
+        REQUIRE_THROWS_AS(readEvents("a: \"open\n", scalars), tg::Exception);
+        REQUIRE_THROWS_AS(readEvents("a: [ 1, 2\n", scalars), tg::Exception);
+        REQUIRE_THROWS_AS(readEvents("a: 1\n   b: 2\n", scalars), tg::Exception);
+        REQUIRE_THROWS_AS(readEvents("a: 1\n- b\n", scalars), tg::Exception);
+    }
+
+}
+
+TEST_CASE("Teground DataFile Yaml Test", "[datafileyamltestcase]"){
+
+    SECTION("Written Layout"){
+        DataFile dfile;
+        readDataFile(dfile, dataFileYaml);
+
+        REQUIRE(dfile.trackCount() == 2);
+        REQUIRE(dfile.trackAt(0)->name() == "Track1");
+        REQUIRE(dfile.trackAt(1)->name() == "Track 2");
+        REQUIRE(dfile.trackAt(1)->type() == "Segment");
+
+        REQUIRE(dfile.sequenceCount() == 2);
+        const Sequence* seq = dfile.sequenceAt(0);
+        REQUIRE(seq->path() == "/data/sequence1.avi");
+        REQUIRE(seq->type() == Sequence::Video);
+        REQUIRE(seq->length() == 1000);
+        REQUIRE(seq->decoder() == "StandardVideoDecoder");
+
+        const SegmentTrack* track = static_cast<const SegmentTrack*>(seq->track(dfile.trackAt(0)));
+        REQUIRE(track->totalSegments() == 2);
+        REQUIRE((*track->begin())->position() == 10);
+        REQUIRE((*track->begin())->length() == 30);
+        REQUIRE((*track->begin())->data() == "");
+        REQUIRE((*(track->begin() + 1))->data() == "first");
+        REQUIRE(static_cast<const SegmentTrack*>(seq->track(dfile.trackAt(1)))->totalSegments() == 0);
+
+        const Sequence* seq2 = dfile.sequenceAt(1);
+        REQUIRE(seq2->type() == Sequence::Image);
+        REQUIRE(seq2->length() == 2000);
+        const SegmentTrack* track2 = static_cast<const SegmentTrack*>(seq2->track(dfile.trackAt(1)));
+        REQUIRE(track2->totalSegments() == 1);
+        REQUIRE((*track2->begin())->position() == 1500);
+        REQUIRE((*track2->begin())->data() == "last: \"quoted\"");
+
+        readDataFile(dfile, dataFileYaml);
+        REQUIRE(dfile.trackCount() == 2);
+        REQUIRE(dfile.sequenceCount() == 2);
+    }
+
+    SECTION("Compact Layout"){
+        DataFile dfile;
+        readDataFile(
+            dfile,
+            "%YAML 1.0\n"
+            "---\n"
+            "TeGround:\n"
+            "  Tracks:\n"
+            "  - Name: Track1\n"
+            "    Type: Segment\n"
+            "  Sequences:\n"
+            "  - Path: sequence1\n"
+            "    Length: 100\n"
+            "    Tracks:\n"
+            "    - { Header: 0, Children: [ { Pos: 10, Length: 5, Data: a } ] }\n"
+        );
+
+        REQUIRE(dfile.sequenceCount() == 1);
+        const SegmentTrack* track = static_cast<const SegmentTrack*>(dfile.sequenceAt(0)->track(dfile.trackAt(0)));
+        REQUIRE(track->totalSegments() == 1);
+        REQUIRE((*track->begin())->position() == 10);
+        REQUIRE((*track->begin())->data() == "a");
+    }
+
+    SECTION("Lazy Loading"){
+        std::string path = "tgdatafileyamllazytest.yml";
+        std::string compactYaml =
+            "TeGround:\n"
+            "   Tracks:\n"
+            "      - { Name: Track1, Type: Segment }\n"
+            "      - { Name: \"Track 2\", Type: Segment }\n"
+            "   Sequences:\n"
+            "      - { Path: sequence1, Length: 10, Tracks: [ { Header: 1, Children: [ { Pos: 1, Length: 2 } ] } ] }\n"
+            "      - Path: sequence2\n"
+            "        Length: 10\n"
+            "        Tracks: [ { Header: 0, Children: [ { Pos: 5, Length: 3 } ] } ]\n";
+
+        const char* layouts[] = { dataFileYaml, compactYaml.c_str() };
+        for ( size_t i = 0; i < 2; ++i ){
+            {
+                std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+                out << layouts[i];
+            }
+
+            DataFile expected;
+            readDataFile(expected, layouts[i]);
+
+            DataFile dfile;
+            REQUIRE(dfile.readFrom(path, DataFile::FORMAT_YAML, DataFile::LOAD_LAZY));
+            REQUIRE(dfile.trackCount() == 2);
+            REQUIRE(dfile.sequenceCount() == 2);
+            REQUIRE_FALSE(dfile.sequenceAt(0)->isLoaded());
+
+            DataFile dfileParallel;
+            REQUIRE(dfileParallel.readFrom(path, DataFile::FORMAT_YAML, DataFile::LOAD_PARALLEL));
+            REQUIRE(dfileParallel.sequenceAt(0)->isLoaded());
+            REQUIRE(dfileParallel.sequenceAt(1)->isLoaded());
+            REQUIRE(dfileParallel.sequenceAt(1)->path() == expected.sequenceAt(1)->path());
+            REQUIRE(dfileParallel.sequenceAt(1)->totalTracks() == expected.sequenceAt(1)->totalTracks());
+
+            for ( size_t s = 2; s > 0; --s ){
+                const Sequence* seq         = dfile.sequenceAt(s - 1);
+                const Sequence* expectedSeq = expected.sequenceAt(s - 1);
+                REQUIRE(seq->path() == expectedSeq->path());
+                REQUIRE(seq->totalTracks() == expectedSeq->totalTracks());
+                REQUIRE(seq->isLoaded());
+
+                for ( size_t t = 0; t < 2; ++t ){
+                    const SegmentTrack* track = static_cast<const SegmentTrack*>(seq->track(dfile.trackAt(t)));
+                    const SegmentTrack* expectedTrack =
+                        static_cast<const SegmentTrack*>(expectedSeq->track(expected.trackAt(t)));
+                    REQUIRE((track == 0) == (expectedTrack == 0));
+                    if ( !track )
+                        continue;
+                    REQUIRE(track->totalSegments() == expectedTrack->totalSegments());
+                    for ( size_t k = 0; k < track->totalSegments(); ++k ){
+                        REQUIRE((*(track->begin() + k))->position() == (*(expectedTrack->begin() + k))->position());
+                        REQUIRE((*(track->begin() + k))->data() == (*(expectedTrack->begin() + k))->data());
+                    }
+                }
+            }
+        }
+
+        {
+            std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            out << "TeGround:\n"
+                   "   Tracks: []\n"
+                   "   Sequences:\n"
+                   "      - { Path: sequence1, Length: 10, Tracks: [ { Header: 3 } ] }\n";
+        }
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(path, DataFile::FORMAT_YAML, DataFile::LOAD_LAZY));
+        REQUIRE(dfile.sequenceFrom("sequence1") != 0);
+        REQUIRE_THROWS_AS(dfile.sequenceAt(0)->totalTracks(), tg::Exception);
+        REQUIRE_FALSE(dfile.sequenceAt(0)->isLoaded());
+        REQUIRE_THROWS_AS(dfile.readFrom(path, DataFile::FORMAT_YAML, DataFile::LOAD_PARALLEL), tg::Exception);
+
+        std::remove(path.c_str());
+    }
+
+    SECTION("Lazy Loading - Write To Same Path"){
+        std::string path = "tgdatafileyamlsamepathtest.yml";
+        {
+            std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            out << dataFileYaml;
+        }
+
+        DataFile expected;
+        readDataFile(expected, dataFileYaml);
+
+        DataFile dfile;
+        REQUIRE(dfile.readFrom(path, DataFile::FORMAT_YAML, DataFile::LOAD_LAZY));
+        REQUIRE_FALSE(dfile.sequenceAt(0)->isLoaded());
+        REQUIRE(dfile.writeTo(path));
+
+        DataFile result;
+        REQUIRE(result.readFrom(path, DataFile::FORMAT_YAML, DataFile::LOAD_LAZY));
+        REQUIRE(result.sequenceCount() == 2);
+        for ( size_t s = 0; s < 2; ++s ){
+            REQUIRE(result.sequenceAt(s)->path() == expected.sequenceAt(s)->path());
+            for ( size_t t = 0; t < 2; ++t ){
+                const SegmentTrack* track = static_cast<const SegmentTrack*>(result.sequenceAt(s)->track(result.trackAt(t)));
+                const SegmentTrack* expectedTrack =
+                    static_cast<const SegmentTrack*>(expected.sequenceAt(s)->track(expected.trackAt(t)));
+                REQUIRE((track == 0) == (expectedTrack == 0));
+                if ( !track )
+                    continue;
+                REQUIRE(track->totalSegments() == expectedTrack->totalSegments());
+                for ( size_t k = 0; k < track->totalSegments(); ++k ){
+                    REQUIRE((*(track->begin() + k))->position() == (*(expectedTrack->begin() + k))->position());
+                    REQUIRE((*(track->begin() + k))->data() == (*(expectedTrack->begin() + k))->data());
+                }
+            }
+        }
+
+        std::remove(path.c_str());
+    }
+
+    SECTION("Streaming Writer"){
+        DataFile dfile;
+        readDataFile(dfile, dataFileYaml);
+        static_cast<SegmentTrack*>(dfile.sequenceAt(1)->track(dfile.trackAt(1)))->createSegment(10, 5, "123");
+
+        std::stringstream stream;
+        dfile.writeYaml(stream);
+
+        std::string written = stream.str();
+        REQUIRE(written.compare(0, 10, "%YAML:1.0\n") == 0);
+        REQUIRE(written.find(
+            "         Tracks:\n"
+            "            -\n"
+            "               Header: 0\n"
+            "               Children:\n"
+            "                  -\n"
+            "                     Pos: 10\n"
+            "                     Length: 30\n"
+            "                     Data: \"\"\n"
+        ) != std::string::npos);
+        REQUIRE(written.find("               Children: []\n") != std::string::npos);
+        REQUIRE(written.find("Data: \"123\"\n") != std::string::npos);
+        REQUIRE(written.find("Data: \"last: \\\"quoted\\\"\"\n") != std::string::npos);
+
+        DataFile result;
+        readDataFile(result, written);
+        REQUIRE(result.trackCount() == 2);
+        REQUIRE(result.trackAt(1)->name() == "Track 2");
+        REQUIRE(result.sequenceCount() == 2);
+        const SegmentTrack* track = static_cast<const SegmentTrack*>(result.sequenceAt(1)->track(result.trackAt(1)));
+        REQUIRE(track->totalSegments() == 2);
+        REQUIRE((*track->begin())->data() == "123");
+        REQUIRE((*(track->begin() + 1))->data() == "last: \"quoted\"");
+
+        std::string path = "tgdatafileyamlwritertest.yml";
+        REQUIRE(dfile.writeTo(path));
+        DataFile fileResult;
+        REQUIRE(fileResult.readFrom(path));
+        REQUIRE(fileResult.sequenceAt(0)->length() == 1000);
+        std::remove(path.c_str());
+
+        REQUIRE(YamlWriter::quote("Track 2") == "Track 2");
+        REQUIRE(YamlWriter::quote("a: b") == "\"a: b\"");
+        REQUIRE(YamlWriter::quote(std::string("x\ty\x01", 4)) == "\"x\\ty\\x01\"");
+
+        std::stringstream invalidStream;
+        YamlWriter writer(invalidStream);
+        REQUIRE_THROWS_AS(writer.write("", 1), tg::Exception);
+        REQUIRE_THROWS_AS(writer.endSequence(), tg::Exception);
+        writer.startSequence("Items");
+        REQUIRE_THROWS_AS(writer.write("Key", 1), tg::Exception);
+        REQUIRE_THROWS_AS(writer.endMapping(), tg::Exception);
+    }
+
+    SECTION("Cache"){
+        std::string path = "tgdatafileyamlcachetest.yml";
+
+        // snapshots need every track in every sequence
+        DataFile dfile;
+        readDataFile(dfile, dataFileYaml);
+        REQUIRE(dfile.writeTo(path));
+        dfile.setCacheDirectory(".");
+        std::string snapshotPath = dfile.cachePath(path);
+        REQUIRE(dfile.readFrom(path));
+        REQUIRE(dfile.sequenceCount() == 2);
+        REQUIRE_FALSE(std::ifstream(snapshotPath.c_str()).is_open());
+
+        dfile.sequenceAt(1)->appendTrack(dfile.trackAt(0));
+        dfile.setCacheDirectory("");
+        REQUIRE(dfile.cachePath(path) == "");
+        REQUIRE(dfile.writeTo(path));
+        dfile.setCacheDirectory(".");
+        snapshotPath = dfile.cachePath(path);
+        REQUIRE(snapshotPath != "");
+        std::remove(snapshotPath.c_str());
+
+        REQUIRE(dfile.readFrom(path));
+        REQUIRE(dfile.sequenceCount() == 2);
+        REQUIRE(static_cast<const SegmentTrack*>(dfile.sequenceAt(0)->track(dfile.trackAt(0)))->totalSegments() == 2);
+
+        DataFile snapshot;
+        REQUIRE(snapshot.readFrom(snapshotPath, DataFile::FORMAT_BINARY));
+        REQUIRE(snapshot.sequenceCount() == 2);
+        REQUIRE(snapshot.sequenceAt(1)->path() == "sequence2");
+
+        // snapshots are read instead of the yaml file
+        snapshot.removeSequence(snapshot.sequenceAt(0));
+        REQUIRE(snapshot.writeTo(snapshotPath, DataFile::FORMAT_BINARY));
+        DataFile cached;
+        cached.setCacheDirectory(".");
+        REQUIRE(cached.readFrom(path, DataFile::FORMAT_AUTO, DataFile::LOAD_LAZY));
+        REQUIRE(cached.sequenceCount() == 1);
+        REQUIRE(cached.sequenceAt(0)->path() == "sequence2");
+
+        // unreadable snapshots are replaced
+        {
+            std::ofstream out(snapshotPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            out << "TEGROUND";
+        }
+        REQUIRE(cached.readFrom(path));
+        REQUIRE(cached.sequenceCount() == 2);
+        REQUIRE(snapshot.readFrom(snapshotPath, DataFile::FORMAT_BINARY));
+        REQUIRE(snapshot.sequenceCount() == 2);
+
+        // edited files are read again
+        {
+            std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+            out << "Other: 1\n";
+        }
+        REQUIRE(cached.cachePath(path) != snapshotPath);
+        std::remove(snapshotPath.c_str());
+        snapshotPath = cached.cachePath(path);
+        REQUIRE(cached.readFrom(path));
+        REQUIRE(cached.sequenceCount() == 2);
+        REQUIRE(snapshot.readFrom(snapshotPath));
+
+        std::remove(snapshotPath.c_str());
+        std::remove(path.c_str());
+        REQUIRE_FALSE(cached.readFrom(path));
+    }
+
+    SECTION("Invalid Layout"){
+        DataFile dfile;
+        REQUIRE_THROWS_AS(readDataFile(dfile, ""), tg::Exception);
+        REQUIRE_THROWS_AS(readDataFile(dfile, "Other: 1\n"), tg::Exception);
+        REQUIRE_THROWS_AS(readDataFile(dfile, "TeGround:\n   Sequences: []\n   Tracks: []\n"), tg::Exception);
+        REQUIRE_THROWS_AS(readDataFile(dfile, "TeGround:\n   Tracks: []\n"), tg::Exception);
+        REQUIRE_THROWS_AS(
+            readDataFile(dfile, "TeGround:\n   Tracks: []\n   Sequences:\n      - { Length: 10, Tracks: [ { Header: 0 } ] }\n"),
+            tg::Exception
+        );
+        REQUIRE_THROWS_AS(
+            readDataFile(
+                dfile,
+                "TeGround:\n"
+                "   Tracks:\n"
+                "      - { Name: Track1, Type: Segment }\n"
+                "   Sequences:\n"
+                "      - { Length: 10, Tracks: [ { Children: [], Header: 0 } ] }\n"
+            ),
+            tg::Exception
+        );
+        REQUIRE_THROWS_AS(
+            readDataFile(
+                dfile,
+                "TeGround:\n"
+                "   Tracks:\n"
+                "      - { Name: Track1, Type: Segment }\n"
+                "   Sequences:\n"
+                "      - { Length: 10, Tracks: [ { Header: 0, Children: [ { Pos: 5, Length: 10 } ] } ] }\n"
+            ),
+            tg::Exception
+        );
+    }
+
+    SECTION("Unsupported Layout"){
+        std::string path = "tgdatafileyamlunsupportedtest.yml";
+        TrackHeader::registerType<LabelTrack>("Label");
+        {
+            std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            out << "%YAML:1.0\n"
+                   "TeGround:\n"
+                   "   Tracks:\n"
+                   "      - { Name: Labels, Type: Label }\n"
+                   "   Sequences:\n"
+                   "      - { Path: sequence1, Type: Video, Length: 10., Decoder: StandardVideoDecoder,\n"
+                   "          Tracks: [ { Header: 0., Label: first } ] }\n";
+        }
+
+        // files the streaming reader rejects are read through cv::FileStorage in every mode
+        const DataFile::LoadMode modes[] = {
+            DataFile::LOAD_ALL, DataFile::LOAD_STREAMING, DataFile::LOAD_LAZY, DataFile::LOAD_PARALLEL
+        };
+        for ( size_t i = 0; i < 4; ++i ){
+            DataFile dfile;
+            REQUIRE(dfile.readFrom(path, DataFile::FORMAT_YAML, modes[i]));
+            REQUIRE(dfile.trackAt(0)->type() == "Label");
+            REQUIRE(dfile.sequenceCount() == 1);
+            REQUIRE(dfile.sequenceAt(0)->isLoaded());
+            REQUIRE(static_cast<LabelTrack*>(dfile.sequenceAt(0)->track("Labels"))->label == "first");
+        }
+
+        {
+            DataFile streamed;
+            std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+            REQUIRE_THROWS_AS(streamed.readYaml(in), tg::Exception);
+        }
+
+        std::remove(path.c_str());
+    }
+
+}
+
+} // namespace
@@ -36,6 +36,26 @@ inline bool matchSegmentCoords(SegmentTrack& t, size_t index, VideoTime pos, Vid
     return (segm->position() == pos && (length == -1 || segm->length() == length));
 }
 
+class ConcurrentCoveringQuery : public cv::ParallelLoopBody{
+
+public:
+    ConcurrentCoveringQuery(const SegmentTrack& track, std::vector<size_t>& results)
+        : m_track(track)
+        , m_results(results)
+    {}
+
+    void operator()(const cv::Range& range) const{
+        for ( int i = range.start; i < range.end; ++i ){
+            std::vector<Segment*> covering;
+            m_results[i] = m_track.segmentsCovering(i * 10, covering);
+        }
+    }
+
+private:
+    const SegmentTrack&  m_track;
+    std::vector<size_t>& m_results;
+};
+
 TEST_CASE("Teground Segment Test", "[segmenttracktestcase]"){
 
     SECTION("Ascending Insertion"){
@@ -245,6 +265,147 @@ TEST_CASE("Teground Segment Test", "[segmenttracktestcase]"){
         REQUIRE(matchSegmentCoords(t, 2, 20, 5));
     }
 
+    SECTION("Segment Keys Follow Segments"){
+        SegmentTrack t(0, 100);
+        t.insertSegment(new Segment(1, 5));
+        Segment* inserted = new Segment(10, 5);
+        t.insertSegment(inserted);
+        t.insertSegment(new Segment(20, 5));
+        t.assignSegmentCoords(t.begin(), 30, 2);
+
+        // segments given to the track are taken back as they are
+        Segment* taken = t.takeSegment(t.begin());
+        REQUIRE(taken == inserted);
+        REQUIRE(taken->position() == 10);
+        delete taken;
+
+        REQUIRE(t.totalSegments() == 2);
+        for ( size_t i = 0; i < t.totalSegments(); ++i ){
+            REQUIRE(t.segmentPosition(i) == getSegment(t, i)->position());
+            REQUIRE(t.segmentLength(i) == getSegment(t, i)->length());
+        }
+        REQUIRE(t.segmentPosition(1) == 30);
+    }
+
+    SECTION("Created Segments"){
+        SegmentTrack t(0, 1000);
+        for ( VideoTime i = 0; i < 600; ++i )
+            t.createSegment(599 - i, 10, "created");
+        t.insertSegment(new Segment(5, 1));
+
+        REQUIRE(t.totalSegments() == 601);
+        REQUIRE(matchSegmentCoords(t, 0, 0, 10));
+        REQUIRE(getSegment(t, 0)->data() == "created");
+        REQUIRE_THROWS_AS(t.createSegment(995, 10), tg::Exception);
+
+        // segments created by the track are taken back at the address found through the track
+        t.removeSegment(t.begin());
+        Segment* found = getSegment(t, 0);
+        REQUIRE(*t.findSegment(found) == found);
+        Segment* taken = t.takeSegment(t.begin());
+        REQUIRE(taken == found);
+        REQUIRE(taken->position() == 1);
+        REQUIRE(taken->data() == "created");
+        REQUIRE(t.findSegment(taken) == t.end());
+        delete taken;
+
+        REQUIRE(t.totalSegments() == 599);
+        t.clearSegments();
+        REQUIRE(t.totalSegments() == 0);
+    }
+
+    SECTION("Concurrent Queries Build The Index Once"){
+        SegmentTrack t(0, 2000);
+        for ( VideoTime i = 0; i < 100; ++i )
+            t.createSegment(i * 10, 15);
+
+        std::vector<size_t> results(8, 0);
+        cv::parallel_for_(cv::Range(0, 8), ConcurrentCoveringQuery(t, results));
+
+        REQUIRE(results[0] == 1);
+        for ( size_t i = 1; i < results.size(); ++i )
+            REQUIRE(results[i] == 2);
+    }
+
+    SECTION("Covering And Overlapping Segments"){
+        SegmentTrack t(0, 100);
+        t.insertSegment(new Segment(0, 90));
+        t.insertSegment(new Segment(10, 5));
+        t.insertSegment(new Segment(12, 30));
+        t.insertSegment(new Segment(20, 5));
+        t.insertSegment(new Segment(50, 10));
+
+        std::vector<Segment*> result;
+        REQUIRE(t.segmentsCovering(22, result) == 3);
+        REQUIRE(result[0]->position() == 0);
+        REQUIRE(result[1]->position() == 12);
+        REQUIRE(result[2]->position() == 20);
+
+        result.clear();
+        REQUIRE(t.segmentsCovering(95, result) == 0);
+
+        result.clear();
+        REQUIRE(t.segmentsOverlapping(14, 8, result) == 4);
+        REQUIRE(result[1]->position() == 10);
+        REQUIRE(result[3]->position() == 20);
+
+        REQUIRE(t.nextSegmentCovering(t.begin() + 1, 11) == t.begin() + 1);
+        REQUIRE(t.nextSegmentCovering(t.begin() + 2, 11) == t.end());
+        REQUIRE(t.nextSegmentOverlapping(t.begin() + 1, 45, 10) == t.begin() + 4);
+
+        // an empty range overlaps the segments strictly containing its position
+        result.clear();
+        REQUIRE(t.segmentsOverlapping(14, 0, result) == 3);
+        result.clear();
+        REQUIRE(t.segmentsOverlapping(12, 0, result) == 2);
+        REQUIRE(result[1]->position() == 10);
+
+        t.assignSegmentCoords(t.begin(), 60, 30);
+        t.removeSegment(t.begin());
+
+        result.clear();
+        REQUIRE(t.segmentsCovering(22, result) == 2);
+        REQUIRE(result[0]->position() == 12);
+        REQUIRE(result[1]->position() == 20);
+
+        result.clear();
+        REQUIRE(t.segmentsCovering(65, result) == 1);
+        REQUIRE(result[0]->position() == 60);
+    }
+
+    SECTION("Index Follows Edits"){
+        SegmentTrack t(0, 1000);
+        for ( VideoTime i = 0; i < 5; ++i )
+            t.createSegment(i * 100, 50);
+        t.buildIndex();
+
+        unsigned int seed = 7;
+        for ( int edit = 0; edit < 300; ++edit ){
+            seed = seed * 1103515245 + 12345;
+            VideoTime position = (seed >> 8) % 900;
+            VideoTime length   = (seed >> 4) % 100;
+            size_t index       = t.totalSegments() > 0 ? (seed >> 12) % t.totalSegments() : 0;
+
+            if ( edit % 3 == 0 || t.totalSegments() == 0 )
+                t.createSegment(position, length);
+            else if ( edit % 3 == 1 )
+                t.assignSegmentCoords(t.begin() + index, position, length);
+            else if ( edit % 5 == 0 )
+                t.removeSegment(t.begin() + index);
+
+            for ( VideoTime from = 0; from < 1000; from += 90 ){
+                size_t expected = 0;
+                for ( size_t i = 0; i < t.totalSegments(); ++i ){
+                    Segment* segm = getSegment(t, i);
+                    if ( segm->position() < from + 40 && segm->position() + segm->length() > from )
+                        ++expected;
+                }
+                std::vector<Segment*> result;
+                REQUIRE(t.segmentsOverlapping(from, 40, result) == expected);
+            }
+        }
+    }
+
 }
 
 }// namespace
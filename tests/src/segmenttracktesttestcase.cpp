@@ -17,13 +17,42 @@
 ****************************************************************************/
 
 #include "catch.hpp"
+#include "datafiletestfixture.h"
 
 #include "tgdatafile.h"
 #include "tgsegment.h"
 #include "tgsegmenttrack.h"
 #include "tgsegmenttracktest.h"
+#include "tgtestsuite.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// the SIMD test targets must select the kernel they are built for
+#if defined(TG_TEST_OVERLAP_KERNEL_AVX2) && !defined(TG_OVERLAP_KERNEL_AVX2)
+#error "The AVX2 overlap kernel is not enabled."
+#endif
+#if defined(TG_TEST_OVERLAP_KERNEL_SSE4) && !defined(TG_OVERLAP_KERNEL_SSE4)
+#error "The SSE4.2 overlap kernel is not enabled."
+#endif
+
+namespace tg{
+
+// matcher that fails on segments starting at 50, for evaluation errors
+template<> class OverlapMatcher<0x80000000u>{
+
+public:
+    bool isMatch(VideoTime, VideoTime, VideoTime segmPos, VideoTime, VideoTime&, VideoTime&, VideoTime&) const{
+        if ( segmPos == 50 )
+            throw Exception("Overlap matcher failed.");
+        return true;
+    }
+};
+
+} // namespace
 
 using namespace tg;
+using namespace tgdatafile_test;
 
 namespace tgsegmenttracktest_test{
 
@@ -45,6 +74,53 @@ private:
 
 };
 
+size_t countOccurrences(const std::string& str, const std::string& value){
+    size_t total = 0;
+    for ( size_t pos = str.find(value); pos != std::string::npos; pos = str.find(value, pos + 1) )
+        ++total;
+    return total;
+}
+
+bool isDetectionBefore(const SegmentTrackTest::Detection& first, const SegmentTrackTest::Detection& second){
+    return first.position < second.position;
+}
+
+// Stamps and overlaps the current sequence while advancing the cursor through it
+void runDetections(SegmentTrackTest& test, VideoTime length){
+    SegmentTrackTest::OverlapParameters overlapParams;
+    overlapParams.minOverlapPercentToSegment = 0.5;
+
+    for ( VideoTime position = 1; position < length; position += 3 ){
+        // leaves some segments unmarked
+        if ( (position / 200) % 3 != 2 ){
+            if ( position % 9 == 1 )
+                test.singleStamp(position);
+            else if ( position % 9 == 4 )
+                test.multiStamp(position, "multi");
+            else if ( position + 4 < length )
+                test.multiOverlap(position, 4, overlapParams);
+        }
+        if ( position % 50 == 0 )
+            test.advanceCursorPosition(position);
+    }
+}
+
+void requireEqualCounts(SegmentTrackTest& test, SegmentTrackTest& expected){
+    for ( int result = 0; result < SegmentAssertion::TOTAL_RESULT_TYPES; ++result ){
+        SegmentAssertion::ResultType resultType = static_cast<SegmentAssertion::ResultType>(result);
+        REQUIRE(test.countAssertions(resultType) == expected.countAssertions(resultType));
+        for ( int type = 0; type < SegmentAssertion::TOTAL_ASSERTION_TYPES; ++type ){
+            SegmentAssertion::AssertionType assertionType = static_cast<SegmentAssertion::AssertionType>(type);
+            REQUIRE(test.countAssertions(resultType, assertionType) == expected.countAssertions(resultType, assertionType));
+            for ( size_t i = 0; i < test.data()->sequenceCount(); ++i ){
+                REQUIRE(test.assertionCounts(i).count(resultType, assertionType) ==
+                        expected.assertionCounts(i).count(resultType, assertionType));
+            }
+        }
+    }
+    REQUIRE(test.assertionCounts().total() == expected.assertionCounts().total());
+}
+
 TEST_CASE("Teground SegmentTrackTest Test", "[segmenttracktesttestcase]"){
 
     SECTION("Null sequences"){
@@ -359,6 +435,159 @@ TEST_CASE("Teground SegmentTrackTest Test", "[segmenttracktesttestcase]"){
         REQUIRE(testsuite.countAssertions(SegmentAssertion::MATCH) == 4);
     }
 
+    SECTION("Single Sequence - Multi Segment - Single And Multi Stamps"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        Sequence* seq = new Sequence("test1", "StandardVideoDecoder", Sequence::Video, 100);
+        dfile.appendSequence(seq);
+
+        SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+        track->insertSegment(new Segment(20, 30));
+        track->insertSegment(new Segment(60, 10));
+
+        AssertionSubscriberMock assertionSubscriber;
+        SegmentTrackTest testsuite(&dfile, theader);
+        testsuite.addAssertionSubscriber(&assertionSubscriber);
+
+        testsuite.singleStamp(25);
+        testsuite.multiStamp(30);
+        testsuite.multiStamp(62);
+        testsuite.multiStamp(63);
+        testsuite.singleStamp(64);
+        REQUIRE(assertionSubscriber.totalAssertions() == 5);
+        REQUIRE(assertionSubscriber.assertionAt(0)->result() == SegmentAssertion::MATCH);
+        REQUIRE(assertionSubscriber.assertionAt(1)->result() == SegmentAssertion::MISS);
+        REQUIRE(assertionSubscriber.assertionAt(2)->result() == SegmentAssertion::MATCH);
+        REQUIRE(assertionSubscriber.assertionAt(3)->result() == SegmentAssertion::MATCH);
+        REQUIRE(assertionSubscriber.assertionAt(3)->segment() == assertionSubscriber.assertionAt(2)->segment());
+        REQUIRE(assertionSubscriber.assertionAt(4)->result() == SegmentAssertion::MISS);
+
+        assertionSubscriber.removeAssertions();
+        testsuite.advanceCursorPosition(90);
+        REQUIRE(assertionSubscriber.totalAssertions() == 0);
+    }
+
+    SECTION("Single Sequence - Multi Segment - Batch Evaluation"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        Sequence* seq = new Sequence("test1", "StandardVideoDecoder", Sequence::Video, 100);
+        dfile.appendSequence(seq);
+
+        SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+        track->insertSegment(new Segment(20, 50));
+        track->insertSegment(new Segment(25, 30));
+        track->insertSegment(new Segment(50, 10));
+        track->insertSegment(new Segment(75, 10));
+
+        SegmentTrackTest::OverlapParameters overlapParams;
+        overlapParams.minOverlapPercentToSegment = 0.5;
+
+        std::vector<SegmentTrackTest::Detection> detections;
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 52));
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 26));
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::MULTI_STAMP, 26));
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_OVERLAP, 70, 15, overlapParams));
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 10));
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 26));
+
+        AssertionSubscriberMock expectedSubscriber;
+        SegmentTrackTest expectedTest(&dfile, theader);
+        expectedTest.addAssertionSubscriber(&expectedSubscriber);
+        expectedTest.singleStamp(10);
+        expectedTest.singleStamp(26);
+        expectedTest.multiStamp(26);
+        expectedTest.singleStamp(26);
+        expectedTest.singleStamp(52);
+        expectedTest.singleOverlap(70, 15, overlapParams);
+
+        AssertionSubscriberMock assertionSubscriber;
+        SegmentTrackTest testsuite(&dfile, theader);
+        testsuite.addAssertionSubscriber(&assertionSubscriber);
+        testsuite.evaluate(detections);
+
+        REQUIRE(assertionSubscriber.totalAssertions() == expectedSubscriber.totalAssertions());
+        for ( size_t i = 0; i < assertionSubscriber.totalAssertions(); ++i ){
+            REQUIRE(assertionSubscriber.assertionAt(i)->position() == expectedSubscriber.assertionAt(i)->position());
+            REQUIRE(assertionSubscriber.assertionAt(i)->result() == expectedSubscriber.assertionAt(i)->result());
+            REQUIRE(assertionSubscriber.assertionAt(i)->segment() == expectedSubscriber.assertionAt(i)->segment());
+        }
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MATCH) == 4);
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MISS) == 2);
+
+        assertionSubscriber.removeAssertions();
+        testsuite.advanceCursorPosition(90);
+        REQUIRE(assertionSubscriber.totalAssertions() == 0);
+
+        detections.clear();
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 100));
+        REQUIRE_THROWS_AS(testsuite.evaluate(detections), tg::Exception);
+    }
+
+    SECTION("Single Sequence - Nested Segments - Batch Evaluation"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        Sequence* seq = new Sequence("test1", "StandardVideoDecoder", Sequence::Video, 2000);
+        dfile.appendSequence(seq);
+
+        // long segments span many short ones, so segments ending early follow ones ending late
+        SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+        unsigned int random = 7;
+        for ( VideoTime position = 0; position < 1800; position += 10 ){
+            random = random * 1103515245 + 12345;
+            VideoTime length = (random >> 16) % 8 == 0 ? 100 + (random >> 8) % 200 : 1 + (random >> 8) % 15;
+            track->insertSegment(new Segment(position + (random >> 20) % 10, length));
+        }
+
+        SegmentTrackTest::OverlapParameters overlapParams;
+        overlapParams.minOverlapPercentToSegment = 0.3;
+        overlapParams.maxUnmarkedLength          = 40;
+
+        std::vector<SegmentTrackTest::Detection> detections;
+        for ( int d = 0; d < 400; ++d ){
+            random = random * 1103515245 + 12345;
+            SegmentAssertion::AssertionType type = static_cast<SegmentAssertion::AssertionType>((random >> 4) % 4);
+            detections.push_back(SegmentTrackTest::Detection(
+                type,
+                (random >> 8) % 1950,
+                1 + (random >> 16) % 50,
+                d % 2 ? overlapParams : SegmentTrackTest::OverlapParameters()
+            ));
+        }
+
+        std::vector<SegmentTrackTest::Detection> sorted(detections);
+        std::stable_sort(sorted.begin(), sorted.end(), &isDetectionBefore);
+
+        AssertionSubscriberMock expectedSubscriber;
+        SegmentTrackTest expectedTest(&dfile, theader);
+        expectedTest.addAssertionSubscriber(&expectedSubscriber);
+        for ( size_t d = 0; d < sorted.size(); ++d ){
+            const SegmentTrackTest::Detection& detection = sorted[d];
+            if ( detection.type == SegmentAssertion::SINGLE_STAMP )
+                expectedTest.singleStamp(detection.position);
+            else if ( detection.type == SegmentAssertion::MULTI_STAMP )
+                expectedTest.multiStamp(detection.position);
+            else if ( detection.type == SegmentAssertion::SINGLE_OVERLAP )
+                expectedTest.singleOverlap(detection.position, detection.length, detection.overlapParams);
+            else
+                expectedTest.multiOverlap(detection.position, detection.length, detection.overlapParams);
+        }
+
+        AssertionSubscriberMock assertionSubscriber;
+        SegmentTrackTest testsuite(&dfile, theader);
+        testsuite.addAssertionSubscriber(&assertionSubscriber);
+        testsuite.evaluate(detections);
+
+        REQUIRE(assertionSubscriber.totalAssertions() == detections.size());
+        REQUIRE(assertionSubscriber.totalAssertions() == expectedSubscriber.totalAssertions());
+        for ( size_t i = 0; i < assertionSubscriber.totalAssertions(); ++i ){
+            REQUIRE(assertionSubscriber.assertionAt(i)->position() == expectedSubscriber.assertionAt(i)->position());
+            REQUIRE(assertionSubscriber.assertionAt(i)->result() == expectedSubscriber.assertionAt(i)->result());
+            REQUIRE(assertionSubscriber.assertionAt(i)->segment() == expectedSubscriber.assertionAt(i)->segment());
+        }
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MATCH) == expectedTest.countAssertions(SegmentAssertion::MATCH));
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MATCH) > 100);
+    }
+
     SECTION("Multi Sequence - Divided Segments - No Match"){
         DataFile dfile;
         TrackHeader* theader = dfile.appendTrack("Segment", "Track");
@@ -437,6 +666,801 @@ TEST_CASE("Teground SegmentTrackTest Test", "[segmenttracktesttestcase]"){
         REQUIRE(assertionSubscriber.assertionAt(1)->result() == SegmentAssertion::UNMARKED);
     }
 
+    SECTION("Multi Sequence - Divided Segments - Sequence Evaluation"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        Sequence* seq  = new Sequence("test1", "StandardVideoDecoder", Sequence::Video, 100);
+        Sequence* seq2 = new Sequence("test2", "StandardVideoDecoder", Sequence::Video, 100);
+        Sequence* seq3 = new Sequence("test3", "StandardVideoDecoder", Sequence::Video, 100);
+        dfile.appendSequence(seq);
+        dfile.appendSequence(seq2);
+        dfile.appendSequence(seq3);
+
+        SegmentTrack* track  = static_cast<SegmentTrack*>(seq->track("Track"));
+        track->insertSegment(new Segment(20, 50));
+        track->insertSegment(new Segment(30, 30));
+        SegmentTrack* track2 = static_cast<SegmentTrack*>(seq2->track("Track"));
+        track2->insertSegment(new Segment(10, 10));
+        track2->insertSegment(new Segment(25, 20));
+        SegmentTrack* track3 = static_cast<SegmentTrack*>(seq3->track("Track"));
+        track3->insertSegment(new Segment(5, 10));
+
+        std::vector<std::vector<SegmentTrackTest::Detection> > detections(3);
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 30));
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 80));
+        detections[1].push_back(SegmentTrackTest::Detection(SegmentAssertion::MULTI_STAMP, 12));
+        detections[1].push_back(SegmentTrackTest::Detection(SegmentAssertion::MULTI_STAMP, 11));
+
+        AssertionSubscriberMock expectedSubscriber;
+        SegmentTrackTest expectedTest(&dfile, theader);
+        expectedTest.addAssertionSubscriber(&expectedSubscriber);
+        expectedTest.singleStamp(30);
+        expectedTest.singleStamp(80);
+        expectedTest.advanceCursorSequence(dfile.sequencesBegin() + 1);
+        expectedTest.multiStamp(11);
+        expectedTest.multiStamp(12);
+        expectedTest.advanceCursorSequence(dfile.sequencesBegin() + 2);
+        expectedTest.advanceCursorSequence(dfile.sequencesEnd());
+
+        AssertionSubscriberMock assertionSubscriber;
+        SegmentTrackTest testsuite(&dfile, theader);
+        testsuite.addAssertionSubscriber(&assertionSubscriber);
+        testsuite.evaluateSequences(detections, "evaluate.cpp", 42);
+        REQUIRE(testsuite.isEnd());
+
+        REQUIRE(assertionSubscriber.totalAssertions() == 7);
+        REQUIRE(assertionSubscriber.totalAssertions() == expectedSubscriber.totalAssertions());
+        for ( size_t i = 0; i < assertionSubscriber.totalAssertions(); ++i ){
+            REQUIRE(assertionSubscriber.assertionAt(i)->position() == expectedSubscriber.assertionAt(i)->position());
+            REQUIRE(assertionSubscriber.assertionAt(i)->result() == expectedSubscriber.assertionAt(i)->result());
+            REQUIRE(assertionSubscriber.assertionAt(i)->segment() == expectedSubscriber.assertionAt(i)->segment());
+            if ( assertionSubscriber.assertionAt(i)->result() == SegmentAssertion::UNMARKED ){
+                REQUIRE(assertionSubscriber.assertionAt(i)->file() == "evaluate.cpp");
+                REQUIRE(assertionSubscriber.assertionAt(i)->lineNumber() == 42);
+            }
+        }
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::UNMARKED) == 3);
+        REQUIRE(testsuite.assertionCounts().total() == 7);
+        REQUIRE(testsuite.assertionCounts(0).count(SegmentAssertion::MATCH, SegmentAssertion::SINGLE_STAMP) == 1);
+        REQUIRE(testsuite.assertionCounts(0).count(SegmentAssertion::MISS, SegmentAssertion::SINGLE_STAMP) == 1);
+        REQUIRE(testsuite.assertionCounts(0).count(SegmentAssertion::UNMARKED) == 1);
+        REQUIRE(testsuite.assertionCounts(1).count(SegmentAssertion::MATCH, SegmentAssertion::MULTI_STAMP) == 2);
+        REQUIRE(testsuite.assertionCounts(1).count(SegmentAssertion::UNMARKED) == 1);
+        REQUIRE(testsuite.assertionCounts(2).total() == 1);
+        REQUIRE(expectedTest.assertionCounts(1).count(SegmentAssertion::MATCH) == 2);
+        REQUIRE(expectedTest.assertionCounts().count(SegmentAssertion::UNMARKED, SegmentAssertion::UNMARKED_SEGMENT) == 3);
+        REQUIRE_THROWS_AS(testsuite.assertionCounts(3), tg::Exception);
+        REQUIRE_THROWS_AS(testsuite.evaluateSequences(detections), tg::Exception);
+    }
+
+    SECTION("Multi Sequence - Divided Segments - Sequence Evaluation - Matcher Error"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        for ( int i = 0; i < 3; ++i ){
+            Sequence* seq = new Sequence("test", "StandardVideoDecoder", Sequence::Video, 100);
+            dfile.appendSequence(seq);
+            static_cast<SegmentTrack*>(seq->track("Track"))->insertSegment(new Segment(i == 1 ? 50 : 10, 10));
+        }
+
+        std::vector<std::vector<SegmentTrackTest::Detection> > detections(3);
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_OVERLAP, 10, 10));
+        detections[1].push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_OVERLAP, 50, 10));
+        detections[2].push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_OVERLAP, 10, 10));
+
+        // the sequences before the failing one are complete, the others are left unevaluated
+        AssertionSubscriberMock assertionSubscriber;
+        SegmentTrackTest testsuite(&dfile, theader);
+        testsuite.addAssertionSubscriber(&assertionSubscriber);
+        OverlapMatcher<0x80000000u> failingMatcher;
+        REQUIRE_THROWS_AS(testsuite.evaluateSequences(detections, failingMatcher), tg::Exception);
+        REQUIRE_FALSE(testsuite.isEnd());
+        REQUIRE(assertionSubscriber.totalAssertions() == 1);
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MATCH) == 1);
+        REQUIRE(testsuite.assertionCounts().total() == 1);
+        REQUIRE(testsuite.assertionCounts(0).total() == 1);
+        REQUIRE(testsuite.assertionCounts(1).total() == 0);
+        REQUIRE(testsuite.assertionCounts(2).total() == 0);
+        REQUIRE(testsuite.metrics().truePositives() == 1);
+
+        // retrying from the failing sequence adds each assertion once
+        detections[0].clear();
+        testsuite.evaluateSequences(detections);
+        REQUIRE(testsuite.isEnd());
+        REQUIRE(assertionSubscriber.totalAssertions() == 3);
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MATCH) == 3);
+        REQUIRE(testsuite.assertionCounts().total() == 3);
+        for ( size_t i = 0; i < 3; ++i )
+            REQUIRE(testsuite.assertionCounts(i).count(SegmentAssertion::MATCH) == 1);
+        REQUIRE(testsuite.metrics().matchedSegments() == 3);
+
+        // a failing cursor sequence is left as it was
+        SegmentTrackTest cursorTest(&dfile, theader);
+        cursorTest.advanceCursorSequence(1);
+        REQUIRE_THROWS_AS(cursorTest.evaluateSequences(detections, failingMatcher), tg::Exception);
+        REQUIRE(cursorTest.assertionCounts().total() == 1);
+        REQUIRE(cursorTest.assertionCounts(1).total() == 0);
+        cursorTest.evaluateSequences(detections);
+        REQUIRE(cursorTest.assertionCounts().total() == 3);
+        REQUIRE(cursorTest.countAssertions(SegmentAssertion::MATCH) == 2);
+    }
+
+    SECTION("Multi Sequence - Divided Segments - Result Stream"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        Sequence* seq  = new Sequence("test1", "StandardVideoDecoder", Sequence::Video, 100);
+        Sequence* seq2 = new Sequence("test2", "StandardVideoDecoder", Sequence::Video, 100);
+        Sequence* seq3 = new Sequence("test3", "StandardVideoDecoder", Sequence::Video, 100);
+        dfile.appendSequence(seq);
+        dfile.appendSequence(seq2);
+        dfile.appendSequence(seq3);
+
+        SegmentTrack* track  = static_cast<SegmentTrack*>(seq->track("Track"));
+        track->insertSegment(new Segment(20, 50));
+        track->insertSegment(new Segment(30, 30));
+        SegmentTrack* track2 = static_cast<SegmentTrack*>(seq2->track("Track"));
+        track2->insertSegment(new Segment(10, 10));
+        track2->insertSegment(new Segment(25, 20));
+        SegmentTrack* track3 = static_cast<SegmentTrack*>(seq3->track("Track"));
+        track3->insertSegment(new Segment(5, 10));
+
+        std::vector<std::vector<SegmentTrackTest::Detection> > detections(3);
+        detections[2].push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 7, 1,
+            SegmentTrackTest::OverlapParameters(), "last", "file.cpp", 10));
+
+        std::string streamedPath = "tgsegmenttrackteststream.yml";
+        std::string writtenPath  = "tgsegmenttracktestwrite.yml";
+
+        SegmentTrackTest streamed(&dfile, theader);
+        REQUIRE(streamed.openResultStream(streamedPath));
+        REQUIRE(streamed.isResultStreamOpen());
+        streamed.singleStamp(30, "first");
+        streamed.singleStamp(80);
+        streamed.advanceCursorSequence(1);
+        REQUIRE(streamed.countAssertions(SegmentAssertion::MATCH) == 1);
+        REQUIRE(streamed.countAssertions(SegmentAssertion::MISS) == 1);
+        REQUIRE(streamed.countAssertions(SegmentAssertion::UNMARKED) == 1);
+        REQUIRE(readFile(streamedPath).find("Index: 0") != std::string::npos);
+        REQUIRE(readFile(streamedPath).find("Index: 1") == std::string::npos);
+
+        streamed.multiStamp(11);
+        streamed.evaluateSequences(detections);
+        REQUIRE(streamed.isEnd());
+        REQUIRE(streamed.closeResultStream());
+        REQUIRE_FALSE(streamed.isResultStreamOpen());
+
+        // the same results written at once
+        SegmentTrackTest written(&dfile, theader);
+        written.singleStamp(30, "first");
+        written.singleStamp(80);
+        written.advanceCursorSequence(1);
+        written.multiStamp(11);
+        written.evaluateSequences(detections);
+        REQUIRE(written.countAssertions(SegmentAssertion::UNMARKED) == 2);
+        REQUIRE(written.openResultStream(writtenPath));
+        REQUIRE(written.closeResultStream());
+
+        std::string results = readFile(streamedPath);
+        REQUIRE(results == readFile(writtenPath));
+        REQUIRE(countOccurrences(results, "Index:") == 3);
+        REQUIRE(countOccurrences(results, "Result: Match") == 3);
+        REQUIRE(countOccurrences(results, "Result: Miss") == 1);
+        REQUIRE(countOccurrences(results, "Result: Unmarked") == 2);
+        REQUIRE(results.find("Info: first") != std::string::npos);
+        REQUIRE(results.find("FileLine: 10") != std::string::npos);
+
+        for ( int i = 0; i < 3; ++i ){
+            SegmentAssertion::ResultType result = static_cast<SegmentAssertion::ResultType>(i);
+            REQUIRE(streamed.countAssertions(result) == written.countAssertions(result));
+        }
+
+        // results freed by the stream are not written with the suite
+        TestSuite suite(&dfile, "Test");
+        SegmentTrackTest* suiteTest = new SegmentTrackTest(&dfile, theader);
+        suite.addTest(suiteTest);
+        REQUIRE(suite.writeTo(writtenPath));
+        REQUIRE(suiteTest->openResultStream(streamedPath));
+        suiteTest->advanceCursorSequence(1);
+        REQUIRE_THROWS_AS(suite.writeTo(writtenPath), tg::Exception);
+        REQUIRE(suiteTest->closeResultStream());
+        REQUIRE_THROWS_AS(suite.writeTo(writtenPath), tg::Exception);
+
+        std::remove(streamedPath.c_str());
+        std::remove(writtenPath.c_str());
+    }
+
+    SECTION("Multi Sequence - Online Evaluation"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        for ( int i = 0; i < 2; ++i ){
+            Sequence* seq = new Sequence("test", "StandardVideoDecoder", Sequence::Video, 2000);
+            dfile.appendSequence(seq);
+            SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+            for ( VideoTime position = 0; position + 20 < 2000; position += 16 ){
+                track->insertSegment(new Segment(position, 5));
+                if ( position % 64 == 0 )
+                    track->insertSegment(new Segment(position + 2, 12));
+            }
+        }
+
+        AssertionSubscriberMock expectedSubscriber;
+        SegmentTrackTest expected(&dfile, theader);
+        expected.addAssertionSubscriber(&expectedSubscriber);
+
+        AssertionSubscriberMock assertionSubscriber;
+        SegmentTrackTest online(&dfile, theader);
+        online.addAssertionSubscriber(&assertionSubscriber);
+        online.setOnline(true);
+        REQUIRE(online.isOnline());
+        REQUIRE_THROWS_AS(online.openResultStream("tgsegmenttracktestonline.yml"), tg::Exception);
+
+        runDetections(expected, 2000);
+        runDetections(online, 2000);
+        REQUIRE(assertionSubscriber.totalAssertions() == expectedSubscriber.totalAssertions());
+        requireEqualCounts(online, expected);
+
+        expected.advanceCursorSequence(1);
+        online.advanceCursorSequence(1);
+        requireEqualCounts(online, expected);
+
+        runDetections(expected, 2000);
+        runDetections(online, 2000);
+        expected.advanceCursorSequence(2);
+        online.advanceCursorSequence(2);
+        REQUIRE(assertionSubscriber.totalAssertions() == expectedSubscriber.totalAssertions());
+        requireEqualCounts(online, expected);
+        REQUIRE(online.countAssertions(SegmentAssertion::MATCH, SegmentAssertion::MULTI_STAMP) > 0);
+        REQUIRE(online.countAssertions(SegmentAssertion::UNMARKED, SegmentAssertion::UNMARKED_SEGMENT) > 0);
+
+        // assertions freed in online mode are not written once it is turned off
+        std::string path = "tgsegmenttracktestonline.yml";
+        TestSuite suite(&dfile, "Test");
+        SegmentTrackTest* suiteTest = new SegmentTrackTest(&dfile, theader);
+        suite.addTest(suiteTest);
+        suiteTest->setOnline(true);
+        suiteTest->multiStamp(1);
+        suiteTest->advanceCursorPosition(100);
+        suiteTest->setOnline(false);
+        REQUIRE(suiteTest->countAssertions(SegmentAssertion::MATCH) == 1);
+        REQUIRE_THROWS_AS(suite.writeTo(path), tg::Exception);
+        std::remove(path.c_str());
+    }
+
+    SECTION("Multi Sequence - Overlap Parameter Sweep"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        std::vector<std::vector<SegmentTrackTest::Detection> > detections(3);
+
+        unsigned int random = 7;
+        for ( size_t i = 0; i < 3; ++i ){
+            Sequence* seq = new Sequence("test", "StandardVideoDecoder", Sequence::Video, 1000);
+            dfile.appendSequence(seq);
+            SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+            for ( VideoTime position = 0; position < 900; position += 25 ){
+                random = random * 1103515245 + 12345;
+                track->insertSegment(new Segment(position + (random >> 16) % 10, 5 + (random >> 8) % 40));
+            }
+
+            for ( int d = 0; d < 150; ++d ){
+                random = random * 1103515245 + 12345;
+                VideoTime position = (random >> 8) % 950;
+                SegmentAssertion::AssertionType type = static_cast<SegmentAssertion::AssertionType>((random >> 4) % 4);
+                detections[i].push_back(SegmentTrackTest::Detection(type, position, 1 + (random >> 16) % 45));
+            }
+        }
+
+        std::vector<SegmentTrackTest::OverlapParameters> overlapParams(6);
+        overlapParams[1].minOverlapPercentToSegment   = 0.5;
+        overlapParams[2].maxMissedPercent             = 0.3;
+        overlapParams[3].minOverlapLength             = 10;
+        overlapParams[3].maxUnmarkedLength            = 15;
+        overlapParams[4].minOverlapPercentToAssertion = 0.8;
+        overlapParams[4].maxUnmarkedPercent           = 0.4;
+        overlapParams[5].maxMissedLength              = 5;
+
+        SegmentTrackTest testsuite(&dfile, theader);
+        std::vector<SegmentAssertionCounts> counts;
+        testsuite.sweep(detections, overlapParams, counts);
+        REQUIRE(counts.size() == overlapParams.size());
+        REQUIRE(testsuite.assertionCounts().total() == 0);
+
+        for ( size_t p = 0; p < overlapParams.size(); ++p ){
+            std::vector<std::vector<SegmentTrackTest::Detection> > paramDetections = detections;
+            for ( size_t i = 0; i < paramDetections.size(); ++i )
+                for ( size_t d = 0; d < paramDetections[i].size(); ++d )
+                    paramDetections[i][d].overlapParams = overlapParams[p];
+
+            SegmentTrackTest expected(&dfile, theader);
+            expected.evaluateSequences(paramDetections);
+            for ( int result = 0; result < SegmentAssertion::TOTAL_RESULT_TYPES; ++result ){
+                for ( int type = 0; type < SegmentAssertion::TOTAL_ASSERTION_TYPES; ++type ){
+                    SegmentAssertion::ResultType resultType       = static_cast<SegmentAssertion::ResultType>(result);
+                    SegmentAssertion::AssertionType assertionType = static_cast<SegmentAssertion::AssertionType>(type);
+                    REQUIRE(counts[p].count(resultType, assertionType) == expected.countAssertions(resultType, assertionType));
+                }
+            }
+        }
+        REQUIRE(counts[0].count(SegmentAssertion::MATCH) > counts[1].count(SegmentAssertion::MATCH));
+
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 1000));
+        REQUIRE_THROWS_AS(testsuite.sweep(detections, overlapParams, counts), tg::Exception);
+    }
+
+    SECTION("Single Sequence - Zero Length Overlap"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        Sequence* seq = new Sequence("test", "StandardVideoDecoder", Sequence::Video, 100);
+        dfile.appendSequence(seq);
+
+        SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+        track->insertSegment(new Segment(20, 10));
+        track->insertSegment(new Segment(50, 10));
+        track->insertSegment(new Segment(70, 10));
+
+        // a detection without length matches the segments strictly containing its position
+        SegmentTrackTest::OverlapParameters overlapParams;
+        overlapParams.minOverlapPercentToAssertion = 0.5;
+        overlapParams.maxMissedPercent             = 0.5;
+        OverlapMatcher<OverlapKernel::MIN_OVERLAP_PERCENT_TO_ASSERTION | OverlapKernel::MAX_MISSED_PERCENT> matcher;
+        matcher.minOverlapPercentToAssertion = 0.5;
+        matcher.maxMissedPercent             = 0.5;
+
+        SegmentTrackTest testsuite(&dfile, theader);
+        testsuite.singleOverlap(20, 0, overlapParams);
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MISS) == 1);
+        testsuite.singleOverlap(25, 0, overlapParams);
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MATCH) == 1);
+        testsuite.singleOverlap(55, 0, matcher);
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MATCH) == 2);
+
+        SegmentTrackTest::OverlapParameters minLength;
+        minLength.minOverlapLength = 1;
+        testsuite.singleOverlap(75, 0, minLength);
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MISS) == 2);
+
+        std::vector<SegmentTrackTest::Detection> detections;
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_OVERLAP, 20, 0, overlapParams));
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_OVERLAP, 25, 0, overlapParams));
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_OVERLAP, 55, 0, overlapParams));
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_OVERLAP, 75, 0, minLength));
+        SegmentTrackTest batch(&dfile, theader);
+        batch.evaluate(detections);
+        requireEqualCounts(batch, testsuite);
+
+        std::vector<std::vector<SegmentTrackTest::Detection> > sequenceDetections(1, detections);
+        std::vector<SegmentTrackTest::OverlapParameters> sweepParams(1, overlapParams);
+        std::vector<SegmentAssertionCounts> counts;
+        SegmentTrackTest sweep(&dfile, theader);
+        sweep.sweep(sequenceDetections, sweepParams, counts);
+        REQUIRE(counts[0].count(SegmentAssertion::MATCH) == 3);
+    }
+
+    SECTION("Single Sequence - Compile Time Overlap Matcher"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        Sequence* seq = new Sequence("test", "StandardVideoDecoder", Sequence::Video, 1000);
+        dfile.appendSequence(seq);
+
+        unsigned int random = 5;
+        SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+        for ( VideoTime position = 0; position < 900; position += 25 ){
+            random = random * 1103515245 + 12345;
+            track->insertSegment(new Segment(position + (random >> 16) % 10, 5 + (random >> 8) % 40));
+        }
+
+        SegmentTrackTest::OverlapParameters overlapParams;
+        overlapParams.minOverlapPercentToSegment = 0.5;
+        overlapParams.maxMissedLength            = 5;
+
+        OverlapMatcher<OverlapKernel::MIN_OVERLAP_PERCENT_TO_SEGMENT | OverlapKernel::MAX_MISSED_LENGTH> matcher;
+        matcher.minOverlapPercentToSegment = 0.5;
+        matcher.maxMissedLength            = 5;
+
+        SegmentTrackTest testsuite(&dfile, theader);
+        SegmentTrackTest expected(&dfile, theader);
+        std::vector<SegmentTrackTest::Detection> detections;
+        for ( VideoTime position = 0; position < 950; position += 3 ){
+            random = random * 1103515245 + 12345;
+            VideoTime length = 1 + (random >> 16) % 45;
+            if ( (random >> 8) % 2 ){
+                testsuite.singleOverlap(position, length, matcher);
+                expected.singleOverlap(position, length, overlapParams);
+                detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_OVERLAP, position, length));
+            } else {
+                testsuite.multiOverlap(position, length, matcher);
+                expected.multiOverlap(position, length, overlapParams);
+                detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::MULTI_OVERLAP, position, length));
+            }
+        }
+        testsuite.advanceCursorPosition(999);
+        expected.advanceCursorPosition(999);
+        requireEqualCounts(testsuite, expected);
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MATCH) > 0);
+        REQUIRE(testsuite.countAssertions(SegmentAssertion::MISS) > 0);
+
+        // the batch entry points test the overlap detections with the matcher instead of their own
+        // parameters, which are left to the defaults here
+        SegmentTrackTest batch(&dfile, theader);
+        batch.evaluate(detections, matcher);
+        batch.advanceCursorPosition(999);
+        requireEqualCounts(batch, expected);
+
+        std::vector<std::vector<SegmentTrackTest::Detection> > sequenceDetections(1, detections);
+        SegmentTrackTest sequences(&dfile, theader);
+        sequences.evaluateSequences(sequenceDetections, matcher);
+        requireEqualCounts(sequences, expected);
+
+        std::vector<SegmentTrackTest::OverlapParameters> sweepParams(2, overlapParams);
+        sweepParams[1].maxMissedLength = 0;
+        std::vector<OverlapMatcher<OverlapKernel::MIN_OVERLAP_PERCENT_TO_SEGMENT | OverlapKernel::MAX_MISSED_LENGTH> >
+            sweepMatchers(2, matcher);
+        sweepMatchers[1].maxMissedLength = 0;
+
+        std::vector<SegmentAssertionCounts> paramCounts, matcherCounts;
+        SegmentTrackTest sweep(&dfile, theader);
+        sweep.sweep(sequenceDetections, sweepParams, paramCounts);
+        sweep.sweep(sequenceDetections, sweepMatchers, matcherCounts);
+        REQUIRE(matcherCounts.size() == 2);
+        REQUIRE(matcherCounts[0].count(SegmentAssertion::MATCH) == expected.countAssertions(SegmentAssertion::MATCH));
+        for ( size_t p = 0; p < sweepParams.size(); ++p ){
+            for ( int result = 0; result < SegmentAssertion::TOTAL_RESULT_TYPES; ++result ){
+                SegmentAssertion::ResultType resultType = static_cast<SegmentAssertion::ResultType>(result);
+                REQUIRE(matcherCounts[p].count(resultType) == paramCounts[p].count(resultType));
+            }
+        }
+        REQUIRE(matcherCounts[1].count(SegmentAssertion::MATCH) > matcherCounts[0].count(SegmentAssertion::MATCH));
+
+        // selected thresholds left at 0 are not applied, as in OverlapParameters
+        const unsigned int allCriteria =
+            OverlapKernel::MIN_OVERLAP_LENGTH | OverlapKernel::MAX_MISSED_LENGTH | OverlapKernel::MAX_UNMARKED_LENGTH |
+            OverlapKernel::MIN_OVERLAP_PERCENT_TO_SEGMENT | OverlapKernel::MIN_OVERLAP_PERCENT_TO_ASSERTION |
+            OverlapKernel::MAX_MISSED_PERCENT | OverlapKernel::MAX_UNMARKED_PERCENT;
+
+        for ( int config = 0; config < 4; ++config ){
+            OverlapMatcher<allCriteria> zeroMatcher;
+            SegmentTrackTest::OverlapParameters zeroParams;
+            if ( config & 1 ){
+                zeroMatcher.maxMissedLength = zeroParams.maxMissedLength = 3;
+                zeroMatcher.minOverlapPercentToSegment = zeroParams.minOverlapPercentToSegment = 0.5;
+            }
+            if ( config & 2 ){
+                zeroMatcher.minOverlapLength   = zeroParams.minOverlapLength   = 2;
+                zeroMatcher.maxUnmarkedPercent = zeroParams.maxUnmarkedPercent = 0.4;
+            }
+
+            VideoTime overlapLength, missedLength, unmarkedLength;
+            for ( VideoTime position = 0; position < 30; ++position ){
+                for ( VideoTime length = 1; length < 15; ++length ){
+                    REQUIRE(
+                        zeroMatcher.isMatch(position, length, 12, 10, overlapLength, missedLength, unmarkedLength) ==
+                        zeroParams.isMatch(position, length, 12, 10, overlapLength, missedLength, unmarkedLength)
+                    );
+                }
+            }
+        }
+
+        VideoTime overlapLength, missedLength, unmarkedLength;
+        OverlapMatcher<OverlapKernel::MAX_MISSED_LENGTH> unsetMissed;
+        REQUIRE(unsetMissed.isMatch(10, 10, 12, 10, overlapLength, missedLength, unmarkedLength));
+        unsetMissed.maxMissedLength = 1;
+        REQUIRE_FALSE(unsetMissed.isMatch(10, 10, 12, 10, overlapLength, missedLength, unmarkedLength));
+    }
+
+    SECTION("Multi Sequence - Metrics"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        Sequence* seq  = new Sequence("test1", "StandardVideoDecoder", Sequence::Video, 200);
+        Sequence* seq2 = new Sequence("test2", "StandardVideoDecoder", Sequence::Video, 100);
+        dfile.appendSequence(seq);
+        dfile.appendSequence(seq2);
+
+        SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+        track->insertSegment(new Segment(20, 10));
+        track->insertSegment(new Segment(50, 10));
+        track->insertSegment(new Segment(80, 10));
+        static_cast<SegmentTrack*>(seq2->track("Track"))->insertSegment(new Segment(10, 10));
+
+        TestSuite suite(&dfile, "Test");
+        SegmentTrackTest* testsuite = new SegmentTrackTest(&dfile, theader);
+        suite.addTest(testsuite);
+        REQUIRE(testsuite->metrics().precision() == 0);
+        REQUIRE(testsuite->metrics().frameRecall() == 0);
+
+        testsuite->singleOverlap(15, 10, SegmentTrackTest::OverlapParameters());
+        testsuite->singleStamp(55);
+        testsuite->singleStamp(100);
+        testsuite->advanceCursorSequence(dfile.sequencesBegin() + 1);
+        testsuite->multiStamp(12);
+        testsuite->advanceCursorPosition(99);
+
+        const SegmentMetrics& first = testsuite->metrics(0);
+        REQUIRE(first.truePositives() == 2);
+        REQUIRE(first.falsePositives() == 1);
+        REQUIRE(first.falseNegatives() == 1);
+        REQUIRE(first.truePositiveFrames() == 6);
+        REQUIRE(first.falsePositiveFrames() == 6);
+        REQUIRE(first.falseNegativeFrames() == 24);
+        REQUIRE(first.precision() == Approx(2.0 / 3));
+        REQUIRE(first.recall() == Approx(2.0 / 3));
+        REQUIRE(first.f1Score() == Approx(2.0 / 3));
+        REQUIRE(first.missRate() == Approx(1.0 / 3));
+        REQUIRE(first.framePrecision() == Approx(0.5));
+        REQUIRE(first.frameRecall() == Approx(0.2));
+        REQUIRE(first.frameF1Score() == Approx(12.0 / 42));
+        REQUIRE(first.frameMissRate() == Approx(0.8));
+
+        const SegmentMetrics& total = testsuite->metrics();
+        REQUIRE(total.truePositives() == 3);
+        REQUIRE(total.falseNegatives() == 1);
+        REQUIRE(total.truePositiveFrames() == 7);
+        REQUIRE(total.falseNegativeFrames() == 33);
+        REQUIRE(total.recall() == Approx(0.75));
+        REQUIRE(testsuite->metrics(1).precision() == 1);
+        REQUIRE_THROWS_AS(testsuite->metrics(2), tg::Exception);
+
+        SegmentTrackTest* second = new SegmentTrackTest(&dfile, theader);
+        suite.addTest(second);
+        second->singleStamp(100);
+        REQUIRE(suite.segmentMetrics().falsePositives() == 2);
+        REQUIRE(suite.segmentMetrics().truePositives() == 3);
+        REQUIRE(suite.segmentMetrics().precision() == Approx(0.6));
+
+        // batch evaluation adds the same metrics
+        std::vector<std::vector<SegmentTrackTest::Detection> > detections(2);
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_OVERLAP, 15, 10));
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 55));
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 100));
+        detections[1].push_back(SegmentTrackTest::Detection(SegmentAssertion::MULTI_STAMP, 12));
+        SegmentTrackTest batch(&dfile, theader);
+        batch.evaluateSequences(detections);
+        REQUIRE(batch.metrics().truePositiveFrames() == total.truePositiveFrames());
+        REQUIRE(batch.metrics().falsePositiveFrames() == total.falsePositiveFrames());
+        REQUIRE(batch.metrics().falseNegativeFrames() == total.falseNegativeFrames());
+        REQUIRE(batch.metrics(0).falseNegatives() == 1);
+        REQUIRE(batch.metrics().recall() == Approx(0.75));
+    }
+
+    SECTION("Single Sequence - Metrics - Multiple Detections Per Segment"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        Sequence* seq = new Sequence("test1", "StandardVideoDecoder", Sequence::Video, 100);
+        dfile.appendSequence(seq);
+
+        SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+        track->insertSegment(new Segment(20, 20));
+        track->insertSegment(new Segment(60, 10));
+
+        SegmentTrackTest testsuite(&dfile, theader);
+        for ( VideoTime position = 38; position >= 29; --position )
+            testsuite.multiStamp(position);
+        testsuite.advanceCursorSequence(1);
+
+        const SegmentMetrics& metrics = testsuite.metrics();
+        REQUIRE(metrics.truePositives() == 10);
+        REQUIRE(metrics.matchedSegments() == 1);
+        REQUIRE(metrics.falseNegatives() == 1);
+        REQUIRE(metrics.precision() == 1);
+        REQUIRE(metrics.recall() == Approx(0.5));
+        REQUIRE(metrics.missRate() == Approx(0.5));
+        REQUIRE(metrics.f1Score() == Approx(2.0 / 3));
+        REQUIRE(metrics.truePositiveFrames() == 10);
+        REQUIRE(metrics.falsePositiveFrames() == 0);
+        REQUIRE(metrics.falseNegativeFrames() == 20);
+
+        // batch evaluation counts the segment once as well
+        std::vector<std::vector<SegmentTrackTest::Detection> > detections(1);
+        for ( VideoTime position = 29; position < 39; ++position )
+            detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::MULTI_STAMP, position));
+        SegmentTrackTest batch(&dfile, theader);
+        batch.evaluateSequences(detections);
+        REQUIRE(batch.metrics().truePositives() == 10);
+        REQUIRE(batch.metrics().matchedSegments() == 1);
+        REQUIRE(batch.metrics().recall() == Approx(0.5));
+        REQUIRE(batch.metrics().missRate() == Approx(0.5));
+        REQUIRE(batch.metrics().truePositiveFrames() == 10);
+        REQUIRE(batch.metrics().falseNegativeFrames() == 20);
+    }
+
+    SECTION("Single Sequence - Metrics - Overlapping And Split Detections"){
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        Sequence* seq = new Sequence("test1", "StandardVideoDecoder", Sequence::Video, 200);
+        dfile.appendSequence(seq);
+
+        SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+        track->insertSegment(new Segment(0, 100));
+        track->insertSegment(new Segment(150, 20));
+
+        // the segment is split between the first and third detections, the second and fourth
+        // overlap them, so only the last 10 frames of the fourth are not counted yet
+        SegmentTrackTest::OverlapParameters overlapParams;
+        SegmentTrackTest testsuite(&dfile, theader);
+        testsuite.multiOverlap(0, 50, overlapParams);
+        testsuite.multiOverlap(40, 30, overlapParams);
+        testsuite.multiOverlap(50, 50, overlapParams);
+        testsuite.multiOverlap(90, 20, overlapParams);
+        testsuite.advanceCursorSequence(1);
+
+        const SegmentMetrics& metrics = testsuite.metrics();
+        REQUIRE(metrics.truePositives() == 4);
+        REQUIRE(metrics.matchedSegments() == 1);
+        REQUIRE(metrics.falseNegatives() == 1);
+        REQUIRE(metrics.truePositiveFrames() == 100);
+        REQUIRE(metrics.falsePositiveFrames() == 10);
+        REQUIRE(metrics.falseNegativeFrames() == 20);
+        REQUIRE(metrics.framePrecision() == Approx(100.0 / 110));
+        REQUIRE(metrics.frameRecall() == Approx(100.0 / 120));
+
+        std::vector<std::vector<SegmentTrackTest::Detection> > detections(1);
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::MULTI_OVERLAP, 0, 50));
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::MULTI_OVERLAP, 40, 30));
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::MULTI_OVERLAP, 50, 50));
+        detections[0].push_back(SegmentTrackTest::Detection(SegmentAssertion::MULTI_OVERLAP, 90, 20));
+        SegmentTrackTest batch(&dfile, theader);
+        batch.setFrameBitmaps(true);
+        batch.evaluateSequences(detections);
+        REQUIRE(batch.metrics().truePositiveFrames() == 100);
+        REQUIRE(batch.metrics().falsePositiveFrames() == 10);
+        REQUIRE(batch.metrics().falseNegativeFrames() == 20);
+        REQUIRE(batch.frameMetrics().truePositiveFrames() == 100);
+        REQUIRE(batch.frameMetrics().falsePositiveFrames() == 10);
+        REQUIRE(batch.frameMetrics().falseNegativeFrames() == 20);
+    }
+
+    SECTION("Multi Sequence - Frame Bitmaps"){
+        FrameBitmap bitmap(200);
+        bitmap.set(60, 10);
+        bitmap.set(-5, 6);
+        bitmap.set(190, 20);
+        bitmap.set(64, 128);
+        REQUIRE(bitmap.words().size() == 4);
+        REQUIRE(bitmap.count() == 1 + 140);
+        REQUIRE(bitmap.test(0));
+        REQUIRE_FALSE(bitmap.test(1));
+        REQUIRE(bitmap.test(63));
+        REQUIRE(bitmap.test(191));
+        REQUIRE(bitmap.test(199));
+        REQUIRE_FALSE(bitmap.test(200));
+
+        FrameBitmap other(200);
+        other.set(100, 100);
+        REQUIRE(bitmap.countAnd(other) == 100);
+        REQUIRE(bitmap.countAndNot(other) == 41);
+        REQUIRE(other.countAndNot(bitmap) == 0);
+        REQUIRE_FALSE(bitmap.test(59));
+        REQUIRE_THROWS_AS(bitmap.countAnd(FrameBitmap(100)), tg::Exception);
+
+        DataFile dfile;
+        TrackHeader* theader = dfile.appendTrack("Segment", "Track");
+        std::vector<std::vector<SegmentTrackTest::Detection> > detections(2);
+
+        unsigned int random = 3;
+        for ( size_t i = 0; i < 2; ++i ){
+            Sequence* seq = new Sequence("test", "StandardVideoDecoder", Sequence::Video, 1000);
+            dfile.appendSequence(seq);
+            SegmentTrack* track = static_cast<SegmentTrack*>(seq->track("Track"));
+            for ( VideoTime position = 0; position < 900; position += 25 ){
+                random = random * 1103515245 + 12345;
+                track->insertSegment(new Segment(position + (random >> 16) % 10, 5 + (random >> 8) % 40));
+            }
+            for ( int d = 0; d < 150; ++d ){
+                random = random * 1103515245 + 12345;
+                SegmentAssertion::AssertionType type = static_cast<SegmentAssertion::AssertionType>((random >> 4) % 4);
+                detections[i].push_back(SegmentTrackTest::Detection(type, (random >> 8) % 950, 1 + (random >> 16) % 60));
+            }
+        }
+
+        SegmentTrackTest testsuite(&dfile, theader);
+        REQUIRE_THROWS_AS(testsuite.frameMetrics(0), tg::Exception);
+        testsuite.setFrameBitmaps(true);
+        testsuite.setOnline(true);
+        testsuite.evaluateSequences(detections);
+
+        SegmentMetrics total;
+        for ( size_t i = 0; i < 2; ++i ){
+            const SegmentTrack* track = static_cast<const SegmentTrack*>(dfile.sequenceAt(i)->track(theader));
+            std::vector<bool> truth(1000, false);
+            for ( size_t s = 0; s < track->totalSegments(); ++s )
+                for ( VideoTime f = track->segmentPosition(s); f < track->segmentPosition(s) + track->segmentLength(s); ++f )
+                    truth[(size_t)f] = true;
+
+            std::vector<bool> detected(1000, false);
+            for ( size_t d = 0; d < detections[i].size(); ++d ){
+                const SegmentTrackTest::Detection& detection = detections[i][d];
+                VideoTime length = detection.type == SegmentAssertion::SINGLE_STAMP ||
+                                   detection.type == SegmentAssertion::MULTI_STAMP ? 1 : detection.length;
+                for ( VideoTime f = detection.position; f < detection.position + length && f < 1000; ++f )
+                    detected[(size_t)f] = true;
+            }
+
+            VideoTime truePositives = 0, falsePositives = 0, falseNegatives = 0;
+            for ( size_t f = 0; f < 1000; ++f ){
+                truePositives  += detected[f] && truth[f];
+                falsePositives += detected[f] && !truth[f];
+                falseNegatives += !detected[f] && truth[f];
+            }
+
+            SegmentMetrics metrics = testsuite.frameMetrics(i);
+            REQUIRE(metrics.truePositiveFrames() == truePositives);
+            REQUIRE(metrics.falsePositiveFrames() == falsePositives);
+            REQUIRE(metrics.falseNegativeFrames() == falseNegatives);
+            REQUIRE(metrics.truePositives() == testsuite.metrics(i).truePositives());
+            REQUIRE(testsuite.metrics(i).truePositiveFrames() == truePositives);
+            REQUIRE(testsuite.metrics(i).falsePositiveFrames() == falsePositives);
+            REQUIRE(testsuite.metrics(i).falseNegativeFrames() == falseNegatives);
+            REQUIRE(testsuite.detectionFrames(i).count() == truePositives + falsePositives);
+            total.add(metrics);
+        }
+
+        SegmentMetrics metrics = testsuite.frameMetrics();
+        REQUIRE(metrics.truePositiveFrames() == total.truePositiveFrames());
+        REQUIRE(metrics.frameRecall() == Approx(total.frameRecall()));
+        REQUIRE(metrics.truePositiveFrames() == testsuite.metrics().truePositiveFrames());
+        REQUIRE(metrics.falsePositiveFrames() == testsuite.metrics().falsePositiveFrames());
+        REQUIRE(metrics.falseNegativeFrames() == testsuite.metrics().falseNegativeFrames());
+    }
+
+    SECTION("Overlap Parameters - Match Mask"){
+        std::vector<SegmentTrackTest::OverlapParameters> overlapParams(7);
+        overlapParams[1].minOverlapPercentToSegment   = 0.5;
+        overlapParams[2].maxMissedPercent             = 0.25;
+        overlapParams[3].minOverlapLength             = 10;
+        overlapParams[3].maxUnmarkedLength            = 15;
+        overlapParams[4].minOverlapPercentToAssertion = 0.8;
+        overlapParams[4].maxUnmarkedPercent           = 0.4;
+        overlapParams[5].maxMissedLength              = 5;
+        overlapParams[6].minOverlapPercentToSegment   = 0.2;
+        overlapParams[6].maxMissedPercent             = 0.5;
+        overlapParams[6].maxUnmarkedLength            = 20;
+
+        VideoTime segmPositions[64];
+        VideoTime segmLengths[64];
+        unsigned int random = 11;
+        for ( int block = 0; block < 200; ++block ){
+            random = random * 1103515245 + 12345;
+            size_t count     = 1 + (random >> 8) % 64;
+            VideoTime pos    = (random >> 16) % 100;
+            VideoTime length = (random >> 4) % 50;
+
+            // large and negative values take the scalar path
+            VideoTime offset = block % 10 == 9 ? (static_cast<VideoTime>(1) << 52) : block % 10 == 8 ? -50 : 0;
+            pos += offset;
+
+            for ( size_t i = 0; i < count; ++i ){
+                random = random * 1103515245 + 12345;
+                segmPositions[i] = offset + (random >> 16) % 150;
+                segmLengths[i]   = (random >> 8) % 50;
+            }
+
+            for ( size_t p = 0; p < overlapParams.size(); ++p ){
+                uint64_t mask = overlapParams[p].matchMask(pos, length, segmPositions, segmLengths, count);
+                for ( size_t i = 0; i < 64; ++i ){
+                    VideoTime overlapLength, missedLength, unmarkedLength;
+                    bool expected = i < count && overlapParams[p].isMatch(
+                        pos, length, segmPositions[i], segmLengths[i], overlapLength, missedLength, unmarkedLength
+                    );
+                    REQUIRE(((mask >> i) & 1) == static_cast<uint64_t>(expected));
+                }
+
+                // every kernel built in gives the same mask, whichever one matchMask() picked
+                OverlapKernel::Thresholds thresholds = overlapParams[p].thresholds();
+                REQUIRE(OverlapKernel::matchMaskScalar(thresholds, pos, length, segmPositions, segmLengths, count) == mask);
+#if defined(TG_OVERLAP_KERNEL_AVX2)
+                if ( OverlapKernel::hasAVX2() )
+                    REQUIRE(OverlapKernel::matchMaskAVX2(thresholds, pos, length, segmPositions, segmLengths, count) == mask);
+#endif
+#if defined(TG_OVERLAP_KERNEL_SSE4)
+                if ( OverlapKernel::hasSSE4() )
+                    REQUIRE(OverlapKernel::matchMaskSSE4(thresholds, pos, length, segmPositions, segmLengths, count) == mask);
+#endif
+            }
+        }
+
+        REQUIRE(OverlapKernel::lowestBit(0x50) == 4);
+        REQUIRE(OverlapKernel::lowestBit(1) == 0);
+        REQUIRE(OverlapKernel::lowestBit(0x8000000000000000ULL) == 63);
+        REQUIRE_THROWS_AS(overlapParams[0].matchMask(0, 10, segmPositions, segmLengths, 65), tg::Exception);
+    }
+
     SECTION("Multi Sequnce - Overlap - Exception"){
         DataFile dfile;
         TrackHeader* theader = dfile.appendTrack("Segment", "Track");
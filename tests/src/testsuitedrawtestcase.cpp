@@ -120,4 +120,53 @@ TEST_CASE("Teground tracktest Draw Test", "[tracktestdrawtestcase]"){
 
 }
 
+TEST_CASE("Teground TestSuite Evaluation Test", "[testsuiteevaluationtestcase]"){
+
+    SECTION("Parallel Track Evaluation"){
+        DataFile dfile;
+        TrackHeader* theader  = dfile.appendTrack("Segment", "Track");
+        TrackHeader* theader2 = dfile.appendTrack("Segment", "Track2");
+        Sequence* seq  = new Sequence("test1", "StandardVideoDecoder", Sequence::Video, 200);
+        Sequence* seq2 = new Sequence("test2", "StandardVideoDecoder", Sequence::Video, 200);
+        dfile.appendSequence(seq);
+        dfile.appendSequence(seq2);
+
+        SegmentTrack* track  = static_cast<SegmentTrack*>(seq->track("Track"));
+        track->insertSegment(new Segment(20, 50));
+        track->insertSegment(new Segment(80, 100));
+        SegmentTrack* track2 = static_cast<SegmentTrack*>(seq2->track("Track"));
+        track2->insertSegment(new Segment(10, 10));
+        SegmentTrack* track3 = static_cast<SegmentTrack*>(seq->track("Track2"));
+        track3->insertSegment(new Segment(0, 10));
+
+        std::vector<SegmentTrackTest::Detection> detections;
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 30));
+        detections.push_back(SegmentTrackTest::Detection(SegmentAssertion::SINGLE_STAMP, 75));
+
+        SegmentTrackTest* tracktest = new SegmentTrackTest(&dfile, theader);
+        tracktest->queueDetections(dfile.sequencesBegin(), detections);
+        SegmentTrackTest* tracktest2 = new SegmentTrackTest(&dfile, theader2);
+        tracktest2->queueDetections(dfile.sequencesBegin(), detections);
+
+        TestSuite testsuite(&dfile, "Test");
+        testsuite.addTest(tracktest);
+        testsuite.addTest(tracktest2);
+        testsuite.evaluate(TestSuite::PARALLEL);
+
+        REQUIRE(tracktest->isEnd());
+        REQUIRE(tracktest->countAssertions(SegmentAssertion::MATCH) == 1);
+        REQUIRE(tracktest->countAssertions(SegmentAssertion::MISS) == 1);
+        REQUIRE(tracktest->countAssertions(SegmentAssertion::UNMARKED) == 2);
+
+        REQUIRE(tracktest2->isEnd());
+        REQUIRE(tracktest2->countAssertions(SegmentAssertion::MATCH) == 0);
+        REQUIRE(tracktest2->countAssertions(SegmentAssertion::MISS) == 2);
+        REQUIRE(tracktest2->countAssertions(SegmentAssertion::UNMARKED) == 1);
+
+        tracktest->queueDetections(dfile.sequencesBegin(), detections);
+        REQUIRE_THROWS_AS(testsuite.evaluate(TestSuite::SERIAL), tg::Exception);
+    }
+
+}
+
 } // namespace